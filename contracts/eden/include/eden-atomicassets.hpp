@@ -29,6 +29,8 @@ namespace eden::atomicassets
    {
       std::string key;
       attribute_value value;
+
+      bool operator==(const attribute&) const = default;
    };
    EOSIO_REFLECT(attribute, key, value);
 
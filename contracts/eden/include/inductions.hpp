@@ -17,6 +17,8 @@ namespace eden
       std::string bio;
       std::string social;
       std::string attributions;  // may be empty
+
+      bool operator==(const new_member_profile&) const = default;
    };
    EOSIO_REFLECT(new_member_profile, name, img, bio, social, attributions)
 
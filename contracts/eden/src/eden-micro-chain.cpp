@@ -1,10 +1,15 @@
 #include <accounts.hpp>
+#include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/key.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index_container.hpp>
 #include <chainbase/chainbase.hpp>
+#include <chainbase/node_pool.hpp>
+#include <chainbase/snapshot.hpp>
 #include <clchain/crypto.hpp>
 #include <clchain/graphql_connection.hpp>
+#include <clchain/graphql_plan.hpp>
+#include <clchain/host_block_archive.hpp>
 #include <clchain/subchain.hpp>
 #include <eden.hpp>
 #include <eosio/abi.hpp>
@@ -104,6 +109,7 @@ namespace boost
 
 struct by_id;
 struct by_pk;
+struct by_pk_hash;
 struct by_invitee;
 struct by_group;
 struct by_round;
@@ -112,8 +118,9 @@ struct by_member;
 struct by_owner;
 
 template <typename T, typename... Indexes>
-using mic = boost::
-    multi_index_container<T, boost::multi_index::indexed_by<Indexes...>, chainbase::allocator<T>>;
+using mic = boost::multi_index_container<T,
+                                         boost::multi_index::indexed_by<Indexes...>,
+                                         chainbase::pool_allocator<T>>;
 
 template <typename T>
 using ordered_by_id = boost::multi_index::ordered_unique<  //
@@ -125,6 +132,25 @@ using ordered_by_pk = boost::multi_index::ordered_unique<  //
     boost::multi_index::tag<by_pk>,
     boost::multi_index::key<&T::by_pk>>;
 
+// B+tree variant of ordered_by_pk, for large tables which are mostly scanned in pages. Its
+// iterators are invalidated by changes to the table.
+template <typename T>
+using btree_by_pk = chainbase::btree_unique<  //
+    boost::multi_index::tag<by_pk>,
+    boost::multi_index::key<&T::by_pk>>;
+
+struct name_hash
+{
+   std::size_t operator()(eosio::name n) const { return std::hash<uint64_t>{}(n.value); }
+};
+
+// Point lookups on tables keyed by account. by_pk remains for range scans.
+template <typename T>
+using hashed_by_pk = boost::multi_index::hashed_unique<  //
+    boost::multi_index::tag<by_pk_hash>,
+    boost::multi_index::key<&T::by_pk>,
+    name_hash>;
+
 template <typename T>
 using ordered_by_invitee = boost::multi_index::ordered_unique<  //
     boost::multi_index::tag<by_invitee>,
@@ -179,6 +205,7 @@ enum tables
    distribution_fund_table,
    nft_table,
    encryption_key_table,
+   account_ref_table,
 };
 
 struct Induction;
@@ -233,12 +260,29 @@ struct status
    uint16_t numElectionParticipants = 0;
    uint16_t migrationIndex = 0;
 
+   bool operator==(const status&) const = default;
+
    template <typename T>
    bool isMigrationCompleted() const
    {
       return migrationIndex >= boost::mp11::mp_find<eden::migration_variant, T>::value;
    }
 };
+EOSIO_REFLECT(status,
+              active,
+              community,
+              communitySymbol,
+              minimumDonation,
+              initialMembers,
+              genesisVideo,
+              collectionAttributes,
+              auctionStartingBid,
+              auctionDuration,
+              memo,
+              nextElection,
+              electionThreshold,
+              numElectionParticipants,
+              migrationIndex)
 
 struct status_object : public chainbase::object<status_table, status_object>
 {
@@ -246,7 +290,10 @@ struct status_object : public chainbase::object<status_table, status_object>
 
    id_type id;
    status status;
+
+   bool operator==(const status_object&) const = default;
 };
+EOSIO_REFLECT(status_object, status)
 using status_index = mic<status_object, ordered_by_id<status_object>>;
 
 // Invariants:
@@ -266,8 +313,11 @@ struct balance_object : public chainbase::object<balance_table, balance_object>
 
    auto by_pk() const { return account; }
 };
-using balance_index =
-    mic<balance_object, ordered_by_id<balance_object>, ordered_by_pk<balance_object>>;
+EOSIO_REFLECT(balance_object, account, amount)
+using balance_index = mic<balance_object,
+                          ordered_by_id<balance_object>,
+                          ordered_by_pk<balance_object>,
+                          hashed_by_pk<balance_object>>;
 
 enum class history_desc
 {
@@ -322,9 +372,10 @@ struct balance_history_object
 
    balance_history_key by_pk() const { return {account, time, id._id}; }
 };
+EOSIO_REFLECT(balance_history_object, time, account, delta, new_amount, other_account, description)
 using balance_history_index = mic<balance_history_object,
                                   ordered_by_id<balance_history_object>,
-                                  ordered_by_pk<balance_history_object>>;
+                                  btree_by_pk<balance_history_object>>;
 
 using InductionEndorser = std::pair<eosio::name, bool>;
 
@@ -338,10 +389,12 @@ struct encryption_key_object : public chainbase::object<encryption_key_table, en
 
    eosio::name by_pk() const { return account; }
 };
+EOSIO_REFLECT(encryption_key_object, account, encryptionKey)
 
 using encryption_key_index = mic<encryption_key_object,
                                  ordered_by_id<encryption_key_object>,
-                                 ordered_by_pk<encryption_key_object>>;
+                                 ordered_by_pk<encryption_key_object>,
+                                 hashed_by_pk<encryption_key_object>>;
 
 struct induction
 {
@@ -352,6 +405,8 @@ struct induction
    eden::new_member_profile profile;
    std::string video;
    eosio::block_timestamp createdAt;
+
+   bool operator==(const induction&) const = default;
 };
 EOSIO_REFLECT(induction, id, inviter, invitee, witnesses, profile, video, createdAt)
 
@@ -364,10 +419,13 @@ struct induction_object : public chainbase::object<induction_table, induction_ob
    id_type id;
    induction induction;
 
+   bool operator==(const induction_object&) const = default;
+
    uint64_t by_pk() const { return induction.id; }
    std::pair<eosio::name, uint64_t> by_invitee() const { return {induction.invitee, induction.id}; }
    InductionCreatedAtKey by_createdAt() const { return {induction.createdAt, induction.id}; }
 };
+EOSIO_REFLECT(induction_object, induction)
 using induction_index = mic<induction_object,
                             ordered_by_id<induction_object>,
                             ordered_by_pk<induction_object>,
@@ -385,7 +443,17 @@ struct member
    std::string inductionVideo;
    bool participating = false;
    eosio::block_timestamp createdAt;
+
+   bool operator==(const member&) const = default;
 };
+EOSIO_REFLECT(member,
+              account,
+              inviter,
+              inductionWitnesses,
+              profile,
+              inductionVideo,
+              participating,
+              createdAt)
 
 struct member_object : public chainbase::object<member_table, member_object>
 {
@@ -394,13 +462,17 @@ struct member_object : public chainbase::object<member_table, member_object>
    id_type id;
    member member;
 
+   bool operator==(const member_object&) const = default;
+
    eosio::name by_pk() const { return member.account; }
    MemberCreatedAtKey by_createdAt() const { return {member.createdAt, member.account}; }
 };
+EOSIO_REFLECT(member_object, member)
 using member_index = mic<member_object,
                          ordered_by_id<member_object>,
                          ordered_by_pk<member_object>,
-                         ordered_by_createdAt<member_object>>;
+                         ordered_by_createdAt<member_object>,
+                         hashed_by_pk<member_object>>;
 
 using SessionKey = std::tuple<eosio::name, eosio::public_key>;
 
@@ -416,6 +488,7 @@ struct session_object : public chainbase::object<session_table, session_object>
 
    SessionKey by_pk() const { return {eden_account, key}; }
 };
+EOSIO_REFLECT(session_object, eden_account, key, expiration, description)
 using session_index =
     mic<session_object, ordered_by_id<session_object>, ordered_by_pk<session_object>>;
 
@@ -436,6 +509,16 @@ struct election_object : public chainbase::object<election_table, election_objec
 
    auto by_pk() const { return time; }
 };
+EOSIO_REFLECT(election_object,
+              time,
+              seeding,
+              results_available,
+              seeding_start_time,
+              seeding_end_time,
+              seed,
+              num_rounds,
+              num_participants,
+              final_group_id)
 using election_index =
     mic<election_object, ordered_by_id<election_object>, ordered_by_pk<election_object>>;
 
@@ -460,6 +543,18 @@ struct election_round_object : public chainbase::object<election_round_table, el
 
    ElectionRoundKey by_round() const { return {election_time, round}; }
 };
+EOSIO_REFLECT(election_round_object,
+              election_time,
+              round,
+              num_participants,
+              num_groups,
+              requires_voting,
+              groups_available,
+              voting_started,
+              voting_finished,
+              results_available,
+              voting_begin,
+              voting_end)
 using election_round_index = mic<election_round_object,
                                  ordered_by_id<election_round_object>,
                                  ordered_by_round<election_round_object>>;
@@ -480,6 +575,7 @@ struct election_group_object : public chainbase::object<election_group_table, el
    ElectionGroupKey by_pk() const { return {election_time, round, first_member}; }
    ElectionGroupByRoundKey by_round() const { return {election_time, round, id._id}; }
 };
+EOSIO_REFLECT(election_group_object, election_time, round, first_member, winner)
 using election_group_index = mic<election_group_object,
                                  ordered_by_id<election_group_object>,
                                  ordered_by_pk<election_group_object>,
@@ -497,9 +593,12 @@ struct vote_object : public chainbase::object<vote_table, vote_object>
    eosio::name candidate;
    std::string video;
 
+   bool operator==(const vote_object&) const = default;
+
    vote_key by_pk() const { return {voter, election_time, round}; }
    auto by_group() const { return std::tuple{group_id, voter}; }
 };
+EOSIO_REFLECT(vote_object, election_time, round, group_id, voter, candidate, video)
 using vote_index = mic<vote_object,
                        ordered_by_id<vote_object>,
                        ordered_by_pk<vote_object>,
@@ -515,8 +614,11 @@ struct distribution_object : public chainbase::object<distribution_table, distri
    std::optional<eosio::asset> target_amount;
    std::optional<std::vector<eosio::asset>> target_rank_distribution;
 
+   bool operator==(const distribution_object&) const = default;
+
    auto by_pk() const { return time; }
 };
+EOSIO_REFLECT(distribution_object, time, started, target_amount, target_rank_distribution)
 using distribution_index = mic<distribution_object,
                                ordered_by_id<distribution_object>,
                                ordered_by_pk<distribution_object>>;
@@ -537,6 +639,12 @@ struct distribution_fund_object
 
    distribution_fund_key by_pk() const { return {owner, distribution_time, rank}; }
 };
+EOSIO_REFLECT(distribution_fund_object,
+              owner,
+              distribution_time,
+              rank,
+              initial_balance,
+              current_balance)
 using distribution_fund_index = mic<distribution_fund_object,
                                     ordered_by_id<distribution_fund_object>,
                                     ordered_by_pk<distribution_fund_object>>;
@@ -559,12 +667,75 @@ struct nft_object : public chainbase::object<nft_table, nft_object>
    nft_account_key by_member() const { return {member, createdAt, assetId}; }
    nft_account_key by_owner() const { return {owner, createdAt, assetId}; }
 };
+EOSIO_REFLECT(nft_object, member, owner, templateId, assetId, templateMint, createdAt)
 using nft_index = mic<nft_object,
                       ordered_by_id<nft_object>,
                       ordered_by_pk<nft_object>,
                       ordered_by_member<nft_object>,
                       ordered_by_owner<nft_object>>;
 
+// undo_index only skips no-op modifies of objects it can compare. These are the ones which
+// handlers modify in bulk, e.g. clear_participating().
+static_assert(std::equality_comparable<status_object> &&
+              std::equality_comparable<induction_object> &&
+              std::equality_comparable<member_object> && std::equality_comparable<vote_object> &&
+              std::equality_comparable<distribution_object>);
+
+// The accounts each row mentions, for the tables which account_refs indexes. These cover the
+// fields which rename() updates.
+std::vector<eosio::name> account_refs(const balance_history_object& obj)
+{
+   return {obj.account, obj.other_account};
+}
+
+std::vector<eosio::name> account_refs(const induction_object& obj)
+{
+   std::vector<eosio::name> result{obj.induction.inviter.first};
+   for (auto& w : obj.induction.witnesses)
+      result.push_back(w.first);
+   return result;
+}
+
+std::vector<eosio::name> account_refs(const member_object& obj)
+{
+   std::vector<eosio::name> result{obj.member.account, obj.member.inviter};
+   result.insert(result.end(), obj.member.inductionWitnesses.begin(),
+                 obj.member.inductionWitnesses.end());
+   return result;
+}
+
+std::vector<eosio::name> account_refs(const election_group_object& obj)
+{
+   return {obj.winner};
+}
+
+std::vector<eosio::name> account_refs(const vote_object& obj)
+{
+   return {obj.voter, obj.candidate};
+}
+
+template <typename T>
+concept has_account_refs = requires(const T& obj) { account_refs(obj); };
+
+using account_ref_key = std::tuple<eosio::name, uint16_t, uint64_t>;
+
+// Reverse index from an account to the rows which mention it. table is the row's type_id.
+struct account_ref_object : public chainbase::object<account_ref_table, account_ref_object>
+{
+   CHAINBASE_DEFAULT_CONSTRUCTOR(account_ref_object)
+
+   id_type id;
+   eosio::name account;
+   uint16_t table = 0;
+   uint64_t ref_id = 0;
+
+   account_ref_key by_pk() const { return {account, table, ref_id}; }
+};
+EOSIO_REFLECT(account_ref_object, account, table, ref_id)
+using account_ref_index = mic<account_ref_object,
+                              ordered_by_id<account_ref_object>,
+                              ordered_by_pk<account_ref_object>>;
+
 struct database
 {
    chainbase::database db;
@@ -582,23 +753,96 @@ struct database
    chainbase::generic_index<distribution_index> distributions;
    chainbase::generic_index<distribution_fund_index> distribution_funds;
    chainbase::generic_index<nft_index> nfts;
+   chainbase::generic_index<account_ref_index> account_refs;
 
    database()
    {
-      db.add_index(status);
-      db.add_index(balances);
-      db.add_index(balance_history);
-      db.add_index(encryption_keys);
-      db.add_index(inductions);
-      db.add_index(members);
-      db.add_index(sessions);
-      db.add_index(elections);
-      db.add_index(election_rounds);
-      db.add_index(election_groups);
-      db.add_index(votes);
-      db.add_index(distributions);
-      db.add_index(distribution_funds);
-      db.add_index(nfts);
+      for_each_table([&](auto& table) { db.add_index(table); });
+   }
+
+   // Snapshots depend on this order
+   template <typename F>
+   void for_each_table(F&& f)
+   {
+      f(status);
+      f(balances);
+      f(balance_history);
+      f(encryption_keys);
+      f(inductions);
+      f(members);
+      f(sessions);
+      f(elections);
+      f(election_rounds);
+      f(election_groups);
+      f(votes);
+      f(distributions);
+      f(distribution_funds);
+      f(nfts);
+      f(account_refs);
+   }
+
+   // Use these instead of the tables' emplace, modify, and remove; they keep account_refs up
+   // to date.
+   template <typename Table, typename F>
+   const auto& emplace(Table& table, F&& f)
+   {
+      auto& obj = table.emplace(std::forward<F>(f));
+      if constexpr (has_account_refs<typename Table::value_type>)
+         for (auto account : ::account_refs(obj))
+            add_ref(obj, account);
+      return obj;
+   }
+
+   template <typename Table, typename F>
+   void modify(Table& table, const typename Table::value_type& obj, F&& f)
+   {
+      if constexpr (has_account_refs<typename Table::value_type>)
+      {
+         auto before = ::account_refs(obj);
+         table.modify(obj, std::forward<F>(f));
+         auto after = ::account_refs(obj);
+         for (auto account : before)
+            if (std::find(after.begin(), after.end(), account) == after.end())
+               remove_ref(obj, account);
+         for (auto account : after)
+            if (std::find(before.begin(), before.end(), account) == before.end())
+               add_ref(obj, account);
+      }
+      else
+      {
+         table.modify(obj, std::forward<F>(f));
+      }
+   }
+
+   template <typename Table>
+   void remove(Table& table, const typename Table::value_type& obj)
+   {
+      if constexpr (has_account_refs<typename Table::value_type>)
+         for (auto account : ::account_refs(obj))
+            remove_ref(obj, account);
+      table.remove(obj);
+   }
+
+  private:
+   template <typename T>
+   void add_ref(const T& obj, eosio::name account)
+   {
+      auto& idx = account_refs.get<by_pk>();
+      if (account.value && idx.find(account_ref_key{account, T::type_id, obj.id._id}) == idx.end())
+         account_refs.emplace([&](auto& ref) {
+            ref.account = account;
+            ref.table = T::type_id;
+            ref.ref_id = obj.id._id;
+         });
+   }
+
+   template <typename T>
+   void remove_ref(const T& obj, eosio::name account)
+   {
+      auto& idx = account_refs.get<by_pk>();
+      auto it = idx.find(account_ref_key{account, T::type_id, obj.id._id});
+      if (it != idx.end())
+         account_refs.remove(*it);
    }
 };
 database db;
@@ -609,9 +853,9 @@ void add_or_modify(Table& table, const Key& key, F&& f)
    auto& idx = table.template get<Tag>();
    auto it = idx.find(key);
    if (it != idx.end())
-      table.modify(*it, [&](auto& obj) { return f(false, obj); });
+      db.modify(table, *it, [&](auto& obj) { return f(false, obj); });
    else
-      table.emplace([&](auto& obj) { return f(true, obj); });
+      db.emplace(table, [&](auto& obj) { return f(true, obj); });
 }
 
 template <typename Tag, typename Table, typename Key, typename F>
@@ -620,8 +864,8 @@ void add_or_replace(Table& table, const Key& key, F&& f)
    auto& idx = table.template get<Tag>();
    auto it = idx.find(key);
    if (it != idx.end())
-      table.remove(*it);
-   table.emplace(f);
+      db.remove(table, *it);
+   db.emplace(table, f);
 }
 
 template <typename Tag, typename Table, typename Key, typename F>
@@ -630,7 +874,7 @@ void modify(Table& table, const Key& key, F&& f)
    auto& idx = table.template get<Tag>();
    auto it = idx.find(key);
    eosio::check(it != idx.end(), "missing record");
-   table.modify(*it, [&](auto& obj) { return f(obj); });
+   db.modify(table, *it, [&](auto& obj) { return f(obj); });
 }
 
 template <typename Tag, typename Table, typename Key>
@@ -639,7 +883,7 @@ void remove_if_exists(Table& table, const Key& key)
    auto& idx = table.template get<Tag>();
    auto it = idx.find(key);
    if (it != idx.end())
-      table.remove(*it);
+      db.remove(table, *it);
 }
 
 template <typename Tag, typename Table, typename Key>
@@ -711,7 +955,7 @@ using BalanceConnection = clchain::Connection<
 
 Balance get_balance(eosio::name account)
 {
-   if (auto* obj = get_ptr<by_pk>(db.balances, account))
+   if (auto* obj = get_ptr<by_pk_hash>(db.balances, account))
       return Balance{account, obj};
    else
       return Balance{account, nullptr};
@@ -777,7 +1021,7 @@ using EncryptionKeyConnection = clchain::Connection<
 
 EncryptionKey get_encryption_key(eosio::name account)
 {
-   if (auto* obj = get_ptr<by_pk>(db.encryption_keys, account))
+   if (auto* obj = get_ptr<by_pk_hash>(db.encryption_keys, account))
       return EncryptionKey{account, obj};
    else
       return EncryptionKey{account, nullptr};
@@ -857,7 +1101,7 @@ EOSIO_REFLECT2(
 
 std::optional<Member> get_member(eosio::name account, bool allow_lsb)
 {
-   if (auto* member_object = get_ptr<by_pk>(db.members, account))
+   if (auto* member_object = get_ptr<by_pk_hash>(db.members, account))
       return Member{account, &member_object->member};
    else if (account.value && (!(account.value & 0x0f) || allow_lsb))
       return Member{account, nullptr};
@@ -936,6 +1180,30 @@ struct Induction
 };
 EOSIO_REFLECT2(Induction, id, inviteeAccount, inviter, witnesses, profile, video, createdAt)
 
+// Undo stack memory held for one table by one reversible block. Bytes count the copies the
+// undo stack keeps, not memory the objects own.
+struct UndoSessionStats
+{
+   uint32_t revision = 0;
+   uint64_t oldValues = 0;
+   uint64_t oldValueBytes = 0;
+   uint64_t removedValues = 0;
+   uint64_t removedValueBytes = 0;
+};
+EOSIO_REFLECT2(UndoSessionStats,
+               revision,
+               oldValues,
+               oldValueBytes,
+               removedValues,
+               removedValueBytes)
+
+struct TableUndoStats
+{
+   std::string table;
+   std::vector<UndoSessionStats> sessions;
+};
+EOSIO_REFLECT2(TableUndoStats, table, sessions)
+
 struct Status
 {
    const status* status;
@@ -952,6 +1220,21 @@ struct Status
    const eosio::block_timestamp& nextElection() const { return status->nextElection; }
    uint16_t electionThreshold() const { return status->electionThreshold; }
    uint16_t numElectionParticipants() const { return status->numElectionParticipants; }
+
+   // Per table, oldest reversible block first
+   std::vector<TableUndoStats> undoStats() const
+   {
+      std::vector<TableUndoStats> result;
+      for (auto& t : db.db.undo_stats())
+      {
+         auto& table = result.emplace_back();
+         table.table = t.type_name;
+         for (auto& s : t.sessions)
+            table.sessions.push_back({uint32_t(s.revision), s.old_values, s.old_value_bytes,
+                                      s.removed_values, s.removed_value_bytes});
+      }
+      return result;
+   }
 };
 EOSIO_REFLECT2(Status,
                active,
@@ -962,7 +1245,8 @@ EOSIO_REFLECT2(Status,
                memo,
                nextElection,
                electionThreshold,
-               numElectionParticipants)
+               numElectionParticipants,
+               undoStats)
 
 struct ElectionRound;
 constexpr const char ElectionRoundConnection_name[] = "ElectionRoundConnection";
@@ -1241,7 +1525,7 @@ DistributionFundConnection Member::distributionFunds(std::optional<eosio::block_
 
 void add_genesis_member(const status& status, eosio::name member)
 {
-   db.inductions.emplace([&](auto& obj) {
+   db.emplace(db.inductions, [&](auto& obj) {
       obj.induction.id = available_pk(db.inductions, 1);
       obj.induction.inviter = {eden_account, false};
       obj.induction.invitee = member;
@@ -1359,6 +1643,7 @@ void clearall()
    clear_table(db.distribution_funds);
    clear_table(db.nfts);
    clear_table(db.encryption_keys);
+   clear_table(db.account_refs);
 }
 
 void delsession(eosio::name eden_account, const eosio::public_key& key)
@@ -1369,7 +1654,7 @@ void delsession(eosio::name eden_account, const eosio::public_key& key)
 eosio::asset add_balance(eosio::name account, const eosio::asset& delta)
 {
    eosio::asset result;
-   add_or_modify<by_pk>(db.balances, account, [&](bool is_new, auto& a) {
+   add_or_modify<by_pk_hash>(db.balances, account, [&](bool is_new, auto& a) {
       if (is_new)
       {
          a.account = account;
@@ -1390,7 +1675,7 @@ void transfer_funds(eosio::block_timestamp time,
 {
    auto new_from = add_balance(from, -amount);
    auto new_to = add_balance(to, amount);
-   db.balance_history.emplace([&](auto& h) {
+   db.emplace(db.balance_history, [&](auto& h) {
       h.time = time;
       h.account = from;
       h.delta = -amount;
@@ -1398,7 +1683,7 @@ void transfer_funds(eosio::block_timestamp time,
       h.other_account = to;
       h.description = description;
    });
-   db.balance_history.emplace([&](auto& h) {
+   db.emplace(db.balance_history, [&](auto& h) {
       h.time = time;
       h.account = to;
       h.delta = amount;
@@ -1520,7 +1805,7 @@ void addtogenesis(eosio::name new_genesis_member)
    db.status.modify(get_status(),
                     [&](auto& obj) { obj.status.initialMembers.push_back(new_genesis_member); });
    for (auto& obj : db.inductions)
-      db.inductions.modify(obj, [&](auto& obj) {
+      db.modify(db.inductions, obj, [&](auto& obj) {
          obj.induction.witnesses.push_back({new_genesis_member, false});
       });
    add_genesis_member(status.status, new_genesis_member);
@@ -1600,7 +1885,7 @@ void inductdonate(const action_context& context,
 {
    auto& induction = get<by_pk>(db.inductions, id);
 
-   auto& member = db.members.emplace([&](auto& obj) {
+   auto& member = db.emplace(db.members, [&](auto& obj) {
       obj.member.account = induction.induction.invitee;
       obj.member.inviter = induction.induction.inviter.first;
 
@@ -1627,7 +1912,7 @@ void inductdonate(const action_context& context,
    {
       auto next = it;
       ++next;
-      db.inductions.remove(*it);
+      db.remove(db.inductions, *it);
       it = next;
    }
 }
@@ -1659,7 +1944,7 @@ void inductendors(const action_context& context,
 
 void resign(eosio::name account)
 {
-   remove_if_exists<by_pk>(db.members, account);
+   remove_if_exists<by_pk_hash>(db.members, account);
 }
 
 void rename(eosio::name old_account, eosio::name new_account)
@@ -1672,46 +1957,67 @@ void rename(eosio::name old_account, eosio::name new_account)
       std::replace(vec.begin(), vec.end(), old_account, new_account);
    };
 
-   db.status.modify(get_status(), [&](auto& status) { update_vec(status.status.initialMembers); });
+   auto& initialMembers = get_status().status.initialMembers;
+   if (std::find(initialMembers.begin(), initialMembers.end(), old_account) != initialMembers.end())
+      db.status.modify(get_status(),
+                       [&](auto& status) { update_vec(status.status.initialMembers); });
 
-   if (auto* obj = get_ptr<by_pk>(db.balances, old_account))
+   if (auto* obj = get_ptr<by_pk_hash>(db.balances, old_account))
       db.balances.modify(*obj, [&](auto& obj) { obj.account = new_account; });
 
-   for (auto& obj : db.balance_history)
-      db.balance_history.modify(obj, [&](auto& obj) {
-         update(obj.account);
-         update(obj.other_account);
-      });
-
-   if (auto* obj = get_ptr<by_pk>(db.encryption_keys, old_account))
+   if (auto* obj = get_ptr<by_pk_hash>(db.encryption_keys, old_account))
       db.encryption_keys.modify(*obj, [&](auto& obj) { obj.account = new_account; });
 
-   for (auto& obj : db.inductions)
-      db.inductions.modify(obj, [&](auto& obj) {
-         update(obj.induction.inviter.first);
-         for (auto& w : obj.induction.witnesses)
-            update(w.first);
-      });
-
-   for (auto& obj : db.members)
-      db.members.modify(obj, [&](auto& obj) {
-         update(obj.member.account);
-         update(obj.member.inviter);
-         update_vec(obj.member.inductionWitnesses);
-      });
-
-   for (auto& obj : db.election_groups)
-      db.election_groups.modify(obj, [&](auto& obj) {
-         // first_member is kept as is since it's only used by events
-         // which have already occurred, and it isn't exposed to the UI
-         update(obj.winner);
-      });
-
-   for (auto& obj : db.votes)
-      db.votes.modify(obj, [&](auto& obj) {
-         update(obj.voter);
-         update(obj.candidate);
-      });
+   // Visit only the rows which mention old_account. Modifying them changes account_refs, so
+   // collect them first.
+   std::vector<std::pair<uint16_t, uint64_t>> refs;
+   {
+      auto& idx = db.account_refs.get<by_pk>();
+      for (auto it = idx.lower_bound(account_ref_key{old_account, 0, 0});
+           it != idx.end() && it->account == old_account; ++it)
+         refs.emplace_back(it->table, it->ref_id);
+   }
+   auto modify_row = [&](auto& table, uint64_t id, auto&& f) {
+      using T = typename std::decay_t<decltype(table)>::value_type;
+      modify<by_id>(table, typename T::id_type(id), f);
+   };
+   for (auto [table, id] : refs)
+   {
+      switch (table)
+      {
+         case balance_history_table:
+            modify_row(db.balance_history, id, [&](auto& obj) {
+               update(obj.account);
+               update(obj.other_account);
+            });
+            break;
+         case induction_table:
+            modify_row(db.inductions, id, [&](auto& obj) {
+               update(obj.induction.inviter.first);
+               for (auto& w : obj.induction.witnesses)
+                  update(w.first);
+            });
+            break;
+         case member_table:
+            modify_row(db.members, id, [&](auto& obj) {
+               update(obj.member.account);
+               update(obj.member.inviter);
+               update_vec(obj.member.inductionWitnesses);
+            });
+            break;
+         case election_group_table:
+            // first_member is kept as is since it's only used by events
+            // which have already occurred, and it isn't exposed to the UI
+            modify_row(db.election_groups, id, [&](auto& obj) { update(obj.winner); });
+            break;
+         case vote_table:
+            modify_row(db.votes, id, [&](auto& obj) {
+               update(obj.voter);
+               update(obj.candidate);
+            });
+            break;
+      }
+   }
 
    {
       auto& idx = db.distribution_funds.get<by_pk>();
@@ -1755,13 +2061,14 @@ void clear_participating()
    auto& idx = db.members.template get<by_pk>();
    for (auto it = idx.begin(); it != idx.end(); ++it)
       if (it->member.participating)
-         db.members.modify(*it, [](auto& obj) { obj.member.participating = false; });
+         db.modify(db.members, *it, [](auto& obj) { obj.member.participating = false; });
    db.status.modify(get_status(), [&](auto& status) { status.status.numElectionParticipants = 0; });
 }
 
 void electopt(eosio::name voter, bool participating)
 {
-   modify<by_pk>(db.members, voter, [&](auto& obj) { obj.member.participating = participating; });
+   modify<by_pk_hash>(db.members, voter,
+                      [&](auto& obj) { obj.member.participating = participating; });
    db.status.modify(get_status(), [&](auto& status) {
       status.status.numElectionParticipants += participating ? 1 : -1;
    });
@@ -1773,7 +2080,7 @@ void electvote(uint8_t round, eosio::name voter, eosio::name candidate)
    eosio::check(!election_idx.empty(), "electvote without any elections");
    auto& election = *--election_idx.end();
    auto& vote = get<by_pk>(db.votes, std::tuple{voter, election.time, round});
-   db.votes.modify(vote, [&](auto& vote) { vote.candidate = candidate; });
+   db.modify(db.votes, vote, [&](auto& vote) { vote.candidate = candidate; });
 }
 
 void electmeeting(eosio::name account,
@@ -1792,12 +2099,12 @@ void electvideo(uint8_t round, eosio::name voter, const std::string& video)
    auto& election = *--election_idx.end();
    auto* vote = get_ptr<by_pk>(db.votes, std::tuple{voter, election.time, round});
    if (vote)
-      db.votes.modify(*vote, [&](auto& vote) { vote.video = video; });
+      db.modify(db.votes, *vote, [&](auto& vote) { vote.video = video; });
 }
 
 void setencpubkey(eosio::name member, eosio::public_key key)
 {
-   add_or_modify<by_pk>(db.encryption_keys, member, [&](bool is_new, auto& row) {
+   add_or_modify<by_pk_hash>(db.encryption_keys, member, [&](bool is_new, auto& row) {
       row.account = member;
       row.encryptionKey = key;
    });
@@ -1882,7 +2189,7 @@ void handle_event(const eden::election_event_schedule& event)
    });
    for (auto& member : db.members)
    {
-      db.members.modify(member, [&](auto& member) { member.member.participating = false; });
+      db.modify(db.members, member, [&](auto& member) { member.member.participating = false; });
    }
 }
 
@@ -1932,14 +2239,14 @@ void handle_event(const eden::election_event_create_round& event)
 void handle_event(const eden::election_event_create_group& event)
 {
    eosio::check(!event.voters.empty(), "group has no voters");
-   auto& group = db.election_groups.emplace([&](auto& group) {
+   auto& group = db.emplace(db.election_groups, [&](auto& group) {
       group.election_time = event.election_time;
       group.round = event.round;
       group.first_member = *std::min_element(event.voters.begin(), event.voters.end());
    });
    for (auto voter : event.voters)
    {
-      db.votes.emplace([&](auto& vote) {
+      db.emplace(db.votes, [&](auto& vote) {
          vote.election_time = group.election_time;
          vote.round = event.round;
          vote.group_id = group.id._id;
@@ -1974,11 +2281,11 @@ void handle_event(const eden::election_event_report_group& event)
        })->voter;
    auto& group = get<by_pk>(db.election_groups,
                             ElectionGroupKey{event.election_time, event.round, first_member});
-   db.election_groups.modify(group, [&](auto& group) { group.winner = event.winner; });
+   db.modify(db.election_groups, group, [&](auto& group) { group.winner = event.winner; });
    for (auto& v : event.votes)
    {
       auto& vote = get<by_pk>(db.votes, std::tuple{v.voter, event.election_time, event.round});
-      db.votes.modify(vote, [&](auto& vote) { vote.candidate = v.candidate; });
+      db.modify(db.votes, vote, [&](auto& vote) { vote.candidate = v.candidate; });
    }
 }
 
@@ -2115,7 +2422,7 @@ void remove_expired_inductions(const eosio::time_point& block_time, const status
    {
       auto next = it;
       ++next;
-      db.inductions.remove(*it);
+      db.remove(db.inductions, *it);
       it = next;
    }
 }
@@ -2253,79 +2560,221 @@ void filter_block(const subchain::eosio_block& block)
    }  // for(trx)
 }  // filter_block
 
-std::vector<subchain::transaction> ship_to_eden_transactions(
-    std::vector<eosio::ship_protocol::transaction_trace>& traces)
+// Fields of an action trace needed to decide whether to keep it. data still refers to the
+// ship message; it's only copied if the action is kept.
+struct ship_action
 {
-   std::vector<subchain::transaction> transactions;
+   uint32_t creator_action_ordinal = 0;
+   std::optional<uint64_t> global_sequence;
+   eosio::name receiver;
+   eosio::name account;
+   eosio::name name;
+   eosio::input_stream data;
+};
 
-   for (const auto& transaction_trace : traces)
-   {
-      std::visit(
-          [&](const auto& trx_trace) {
-             subchain::transaction transaction{
-                 .id = trx_trace.id,
-             };
-
-             for (const auto& action_trace : trx_trace.action_traces)
-             {
-                std::visit(
-                    [&](const auto& act_trace) {
-                       std::optional<subchain::creator_action> creatorAction;
-                       if (act_trace.creator_action_ordinal.value > 0)
-                       {
-                          std::visit(
-                              [&](const auto& creator_action_trace) {
-                                 std::visit(
-                                     [&](const auto& receipt) {
-                                        creatorAction = subchain::creator_action{
-                                            .seq = receipt.global_sequence,
-                                            .receiver = creator_action_trace.receiver,
-                                        };
-                                     },
-                                     *creator_action_trace.receipt);
-                              },
-                              trx_trace.action_traces[act_trace.creator_action_ordinal.value - 1]);
-                       }
-
-                       std::vector<char> data(act_trace.act.data.pos, act_trace.act.data.end);
-                       eosio::bytes hexData{data};
-
-                       std::visit(
-                           [&](const auto& receipt) {
-                              subchain::action action{
-                                  .seq = receipt.global_sequence,
-                                  .firstReceiver = act_trace.act.account,
-                                  .receiver = act_trace.receiver,
-                                  .name = act_trace.act.name,
-                                  .creatorAction = creatorAction,
-                                  .hexData = std::move(hexData),
-                              };
-
-                              transaction.actions.push_back(std::move(action));
-                           },
-                           *act_trace.receipt);
-                    },
-                    action_trace);
-             }
-
-             transactions.push_back(std::move(transaction));
-          },
-          transaction_trace);
+bool read_bool(eosio::input_stream& s)
+{
+   bool result;
+   eosio::from_bin(result, s);
+   return result;
+}
+
+void skip_bytes(eosio::input_stream& s)
+{
+   s.skip(eosio::varuint32_from_bin(s));
+}
+
+void skip_array(eosio::input_stream& s, size_t element_size)
+{
+   auto size = eosio::varuint32_from_bin(s);
+   eosio::check(size <= s.remaining() / element_size,
+                eosio::convert_stream_error(eosio::stream_error::overrun));
+   s.skip(size * element_size);
+}
+
+// Reads an action_trace without decoding the parts filter_block doesn't use
+void scan_action_trace(eosio::input_stream& s, ship_action& action)
+{
+   auto version = eosio::varuint32_from_bin(s);
+   eosio::check(version <= 1, "unsupported action_trace version");
+   eosio::varuint32_from_bin(s);  // action_ordinal
+   action.creator_action_ordinal = eosio::varuint32_from_bin(s);
+   action.global_sequence = std::nullopt;
+   if (read_bool(s))
+   {
+      eosio::check(eosio::varuint32_from_bin(s) == 0, "unsupported action_receipt version");
+      s.skip(sizeof(eosio::name) + sizeof(eosio::checksum256));  // receiver, act_digest
+      uint64_t global_sequence;
+      eosio::from_bin(global_sequence, s);
+      action.global_sequence = global_sequence;
+      s.skip(sizeof(uint64_t));  // recv_sequence
+      skip_array(s, sizeof(eosio::name) + sizeof(uint64_t));  // auth_sequence
+      eosio::varuint32_from_bin(s);                            // code_sequence
+      eosio::varuint32_from_bin(s);                            // abi_sequence
+   }
+   eosio::from_bin(action.receiver, s);
+   eosio::from_bin(action.account, s);
+   eosio::from_bin(action.name, s);
+   skip_array(s, sizeof(eosio::name) * 2);  // authorization
+   eosio::from_bin(action.data, s);
+   s.skip(sizeof(bool) + sizeof(int64_t));                // context_free, elapsed
+   skip_bytes(s);                                         // console
+   skip_array(s, sizeof(eosio::name) + sizeof(int64_t));  // account_ram_deltas
+   if (read_bool(s))
+      skip_bytes(s);  // except
+   if (read_bool(s))
+      s.skip(sizeof(uint64_t));  // error_code
+   if (version == 1)
+      skip_bytes(s);  // return_value
+}
+
+void skip_partial_transaction(eosio::input_stream& s)
+{
+   eosio::check(eosio::varuint32_from_bin(s) == 0, "unsupported partial_transaction version");
+   s.skip(sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint32_t));  // expiration, ref_block_*
+   eosio::varuint32_from_bin(s);                                     // max_net_usage_words
+   s.skip(sizeof(uint8_t));                                          // max_cpu_usage_ms
+   eosio::varuint32_from_bin(s);                                     // delay_sec
+   for (auto n = eosio::varuint32_from_bin(s); n; --n)               // transaction_extensions
+   {
+      s.skip(sizeof(uint16_t));
+      skip_bytes(s);
+   }
+   for (auto n = eosio::varuint32_from_bin(s); n; --n)  // signatures
+   {
+      eosio::signature sig;
+      eosio::from_bin(sig, s);
    }
+   for (auto n = eosio::varuint32_from_bin(s); n; --n)  // context_free_data
+      skip_bytes(s);
+}
+
+// Reads a transaction_trace. Fills actions with its action traces; actions[i] has
+// action_ordinal i + 1.
+eosio::checksum256 scan_transaction_trace(eosio::input_stream& s,
+                                          std::vector<ship_action>& actions)
+{
+   eosio::check(eosio::varuint32_from_bin(s) == 0, "unsupported transaction_trace version");
+   eosio::checksum256 id;
+   eosio::from_bin(id, s);
+   s.skip(sizeof(uint8_t) + sizeof(uint32_t));  // status, cpu_usage_us
+   eosio::varuint32_from_bin(s);                // net_usage_words
+   s.skip(sizeof(int64_t) + sizeof(uint64_t) + sizeof(bool));  // elapsed, net_usage, scheduled
+
+   actions.resize(eosio::varuint32_from_bin(s));
+   for (auto& action : actions)
+      scan_action_trace(s, action);
+
+   if (read_bool(s))
+      s.skip(sizeof(eosio::name) + sizeof(int64_t));  // account_ram_delta
+   if (read_bool(s))
+      skip_bytes(s);  // except
+   if (read_bool(s))
+      s.skip(sizeof(uint64_t));  // error_code
+   auto num_failed = eosio::varuint32_from_bin(s);
+   if (num_failed)
+   {
+      std::vector<ship_action> failed_actions;
+      for (; num_failed; --num_failed)
+         scan_transaction_trace(s, failed_actions);
+   }
+   if (read_bool(s))
+      skip_partial_transaction(s);
+   return id;
+}
+
+// Matches the actions which filter_block acts on
+bool is_eden_action(const ship_action& action, const ship_action* creator)
+{
+   if (action.account == eden_account)
+      return true;
+   if (action.account == token_account)
+      return action.receiver == eden_account && action.name == "transfer"_n;
+   if (action.account == "eosio.null"_n)
+      return action.name == "eden.events"_n && creator && creator->receiver == eden_account;
+   if (action.account == atomic_account)
+      return action.receiver == eden_account &&
+             (action.name == "logmint"_n || action.name == "logtransfer"_n);
+   return false;
+}
 
+// Converts ship traces (a serialized std::vector<transaction_trace>) into transactions,
+// keeping only the actions filter_block acts on. Transactions which have none are dropped.
+std::vector<subchain::transaction> ship_to_eden_transactions(eosio::input_stream traces)
+{
+   std::vector<subchain::transaction> transactions;
+   std::vector<ship_action> actions;
+   if (!traces.remaining())
+      return transactions;
+   for (auto num_traces = eosio::varuint32_from_bin(traces); num_traces; --num_traces)
+   {
+      auto id = scan_transaction_trace(traces, actions);
+      std::optional<subchain::transaction> transaction;
+      for (auto& action : actions)
+      {
+         const ship_action* creator = nullptr;
+         if (action.creator_action_ordinal)
+         {
+            eosio::check(action.creator_action_ordinal <= actions.size(),
+                         "invalid creator_action_ordinal");
+            creator = &actions[action.creator_action_ordinal - 1];
+         }
+         if (!is_eden_action(action, creator))
+            continue;
+
+         eosio::check(action.global_sequence && (!creator || creator->global_sequence),
+                      "action trace is missing its receipt");
+         std::optional<subchain::creator_action> creatorAction;
+         if (creator)
+            creatorAction = subchain::creator_action{
+                .seq = *creator->global_sequence,
+                .receiver = creator->receiver,
+            };
+         if (!transaction)
+            transaction.emplace().id = id;
+         transaction->actions.push_back(subchain::action{
+             .seq = *action.global_sequence,
+             .firstReceiver = action.account,
+             .receiver = action.receiver,
+             .name = action.name,
+             .creatorAction = creatorAction,
+             .hexData = {std::vector<char>(action.data.pos, action.data.end)},
+         });
+      }
+      if (transaction)
+         transactions.push_back(std::move(*transaction));
+   }
    return transactions;
 }
 
 subchain::block_log block_log;
 
+// Irreversible blocks which trimBlocks() moved out of block_log; see openBlockArchive
+subchain::host_block_archive block_archive;
+
+// Compact JSON responses of recent queries. Cleared whenever db or block_log changes.
+clchain::gql_result_cache result_cache;
+
+uint64_t db_revision()
+{
+   return db.db.undo_stack_revision_range().second;
+}
+
 void forked_n_blocks(size_t n)
 {
    if (n)
+   {
       printf("forked %d blocks, %d now in log\n", (int)n, (int)block_log.blocks.size());
+      result_cache.clear();
+   }
    while (n--)
       db.db.undo();
 }
 
+// Set while adding a batch of blocks. add_block() then only commits when it has to;
+// the batch commits once at the end.
+bool batching = false;
+
 bool add_block(subchain::block_with_id&& bi, uint32_t eosio_irreversible)
 {
    auto [status, num_forked] = block_log.add_block(bi);
@@ -2334,13 +2783,16 @@ bool add_block(subchain::block_with_id&& bi, uint32_t eosio_irreversible)
    forked_n_blocks(num_forked);
    if (auto* b = block_log.block_before_eosio_num(eosio_irreversible + 1))
       block_log.irreversible = std::max(block_log.irreversible, b->num);
-   db.db.commit(block_log.irreversible);
    bool need_undo = bi.num > block_log.irreversible;
-   auto session = db.db.start_undo_session(bi.num > block_log.irreversible);
+   auto [undo_begin, undo_end] = db.db.undo_stack_revision_range();
+   if (!batching || (!need_undo && undo_begin != undo_end))
+      db.db.commit(block_log.irreversible);
+   auto session = db.db.start_undo_session(need_undo);
    filter_block(bi.eosioBlock);
    session.push();
    if (!need_undo)
       db.db.set_revision(bi.num);
+   result_cache.clear();
    // printf("%s block: %d %d log: %d irreversible: %d db: %d-%d %s\n", block_log.status_str[status],
    //        (int)bi.eosioBlock.num, (int)bi.num, (int)block_log.blocks.size(),
    //        block_log.irreversible,  //
@@ -2383,7 +2835,7 @@ bool add_block(eosio::ship_protocol::block_position block,
                eosio::ship_protocol::block_position prev,
                uint32_t eosio_irreversible,
                eosio::block_timestamp timestamp,
-               std::vector<eosio::ship_protocol::transaction_trace> traces)
+               eosio::input_stream traces)
 {
    subchain::eosio_block eosio_block;
    eosio_block.num = block.block_num;
@@ -2422,6 +2874,39 @@ bool add_block(eosio::ship_protocol::block_position block,
    return add_block(std::move(block), eosio_irreversible);
 }
 
+// Batches are a sequence of [uint32_t size][message]. Returns the number of messages for
+// which f returned true.
+template <typename F>
+uint32_t add_batch(const char* data, uint32_t size, F&& f)
+{
+   eosio::input_stream bin{data, size};
+   uint32_t num_added = 0;
+   batching = true;
+   chainbase::scope_exit end_batch{[] { batching = false; }};
+   while (bin.remaining())
+   {
+      uint32_t message_size;
+      eosio::from_bin(message_size, bin);
+      eosio::input_stream message{bin.pos, message_size};
+      bin.skip(message_size);
+      num_added += f(message);
+   }
+   db.db.commit(block_log.irreversible);
+   return num_added;
+}
+
+// Like addBlock, but for a batch of blocks. Returns the number of blocks appended.
+[[clang::export_name("addBlocks")]] uint32_t addBlocks(const char* data,
+                                                     uint32_t size,
+                                                     uint32_t eosio_irreversible)
+{
+   return add_batch(data, size, [&](eosio::input_stream bin) {
+      subchain::block_with_id block;
+      eosio::from_bin(block, bin);
+      return add_block(std::move(block), eosio_irreversible);
+   });
+}
+
 [[clang::export_name("getShipBlocksRequest")]] bool getShipBlocksRequest(uint32_t block_num)
 {
    eosio::ship_protocol::request request = eosio::ship_protocol::get_blocks_request_v0{
@@ -2436,46 +2921,69 @@ bool add_block(eosio::ship_protocol::block_position block,
    return true;
 }
 
-[[clang::export_name("pushShipMessage")]] bool pushShipMessage(const char* data, uint32_t size)
+bool push_ship_message(eosio::input_stream bin)
 {
-   eosio::input_stream bin{data, size};
    eosio::ship_protocol::result result;
    eosio::from_bin(result, bin);
 
    if (auto* blocks_result = std::get_if<eosio::ship_protocol::get_blocks_result_v0>(&result))
    {
-      eosio::ship_protocol::signed_block signed_block;
+      // Only the timestamp (the first field of the block header) is needed
+      eosio::block_timestamp timestamp;
       if (blocks_result->block)
       {
-         eosio::from_bin(signed_block, blocks_result->block.value());
+         auto block = *blocks_result->block;
+         eosio::from_bin(timestamp.slot, block);
       }
 
-      std::vector<eosio::ship_protocol::transaction_trace> traces;
+      eosio::input_stream traces;
       if (blocks_result->traces)
-      {
-         eosio::from_bin(traces, blocks_result->traces.value());
-      }
+         traces = *blocks_result->traces;
 
       auto prev_block = blocks_result->prev_block ? blocks_result->prev_block.value()
                                                   : eosio::ship_protocol::block_position{};
 
       return add_block(blocks_result->this_block.value(), prev_block,
-                       blocks_result->last_irreversible.block_num, signed_block.timestamp, traces);
+                       blocks_result->last_irreversible.block_num, timestamp, traces);
    }
    return false;
 }
 
+[[clang::export_name("pushShipMessage")]] bool pushShipMessage(const char* data, uint32_t size)
+{
+   return push_ship_message({data, size});
+}
+
+// Like pushShipMessage, but for a batch of messages. Returns the number of blocks appended.
+[[clang::export_name("pushShipMessages")]] uint32_t pushShipMessages(const char* data,
+                                                                   uint32_t size)
+{
+   return add_batch(data, size, push_ship_message);
+}
+
 [[clang::export_name("setIrreversible")]] uint32_t setIrreversible(uint32_t irreversible)
 {
    if (auto* b = block_log.block_before_num(irreversible + 1))
       block_log.irreversible = std::max(block_log.irreversible, b->num);
    db.db.commit(block_log.irreversible);
+   result_cache.clear();
    return block_log.irreversible;
 }
 
+// After this, trimBlocks() moves irreversible blocks to the host's archive instead of dropping
+// them, and blocks stay readable through getBlock and queries. If no blocks have been added
+// yet, resumes from the archive's last block; the state must then be restored to that block,
+// e.g. with loadSnapshot.
+[[clang::export_name("openBlockArchive")]] void openBlockArchive()
+{
+   block_log.open(block_archive);
+   result_cache.clear();
+}
+
 [[clang::export_name("trimBlocks")]] void trimBlocks()
 {
    block_log.trim();
+   result_cache.clear();
 }
 
 [[clang::export_name("undoBlockNum")]] void undoBlockNum(uint32_t blockNum)
@@ -2491,6 +2999,7 @@ bool add_block(eosio::ship_protocol::block_position block,
 
 [[clang::export_name("getBlock")]] bool getBlock(uint32_t num)
 {
+   block_log.release_archived();
    auto block = block_log.block_by_num(num);
    if (!block)
       return false;
@@ -2498,6 +3007,109 @@ bool add_block(eosio::ship_protocol::block_position block,
    return true;
 }
 
+// Snapshots contain the irreversible state: the committed contents of each table, plus the
+// blocks in block_log up to the state's block. A delta contains only the blocks and objects
+// which changed since the previous snapshot was saved.
+//
+// uint32_t                   magic
+// uint32_t                   version
+// bool                       delta
+// uint32_t                   block_num
+// varuint32                  num_blocks
+//   block_with_id            block
+// per table, in for_each_table order:
+//   uint16_t                 type_id
+//   ...                      see chainbase/snapshot.hpp
+constexpr uint32_t snapshot_magic = 0x6e736465;  // "edsn"
+constexpr uint32_t snapshot_version = 2;
+
+// Most recent snapshot saved or loaded. Deltas are relative to this.
+std::vector<uint64_t> snapshot_revisions;
+uint32_t snapshot_block_num = 0;
+
+[[clang::export_name("saveSnapshot")]] bool saveSnapshot(bool delta)
+{
+   delta = delta && !snapshot_revisions.empty();
+   uint32_t block_num = db.db.undo_stack_revision_range().first;
+
+   std::vector<char> bin;
+   eosio::vector_stream stream{bin};
+   eosio::to_bin(snapshot_magic, stream);
+   eosio::to_bin(snapshot_version, stream);
+   eosio::to_bin(delta, stream);
+   eosio::to_bin(block_num, stream);
+
+   auto first = block_log.lower_bound_in_blocks(delta ? snapshot_block_num + 1 : 0);
+   auto last = std::max(first, block_log.upper_bound_in_blocks(block_num));
+   eosio::varuint32_to_bin(last - first, stream);
+   for (auto it = first; it != last; ++it)
+      eosio::to_bin(**it, stream);
+
+   std::vector<uint64_t> revisions;
+   db.for_each_table([&](auto& table) {
+      std::optional<uint64_t> base;
+      if (delta)
+         base = snapshot_revisions[revisions.size()];
+      eosio::to_bin(uint16_t(std::decay_t<decltype(table)>::value_type::type_id), stream);
+      revisions.push_back(chainbase::write_snapshot(table, base, stream));
+   });
+
+   snapshot_revisions = std::move(revisions);
+   snapshot_block_num = block_num;
+   result = std::move(bin);
+   return true;
+}
+
+// Discards reversible blocks, then restores the state from a snapshot. A delta must
+// follow the most recent snapshot loaded into this instance.
+[[clang::export_name("loadSnapshot")]] bool loadSnapshot(const char* data, uint32_t size)
+{
+   eosio::input_stream bin{data, size};
+   uint32_t magic, version, block_num;
+   bool delta;
+   eosio::from_bin(magic, bin);
+   eosio::from_bin(version, bin);
+   eosio::check(magic == snapshot_magic && version == snapshot_version,
+                "unsupported snapshot format");
+   eosio::from_bin(delta, bin);
+   eosio::from_bin(block_num, bin);
+   eosio::check(!delta || !snapshot_revisions.empty(), "snapshot delta has no base");
+
+   forked_n_blocks(block_log.undo(block_log.irreversible + 1));
+   db.db.undo_all();
+
+   if (!delta)
+      block_log.blocks.clear();
+   auto num_blocks = eosio::varuint32_from_bin(bin);
+   for (uint32_t i = 0; i < num_blocks; ++i)
+   {
+      auto block = std::make_unique<subchain::block_with_id>();
+      eosio::from_bin(*block, bin);
+      if (i == 0 && !block_log.blocks.empty() && block_log.blocks.back()->num + 1 != block->num)
+         block_log.blocks.clear();
+      block_log.blocks.push_back(std::move(block));
+   }
+   block_log.irreversible = block_num;
+
+   std::vector<uint64_t> revisions;
+   db.for_each_table([&](auto& table) {
+      std::optional<uint64_t> base;
+      if (delta)
+         base = snapshot_revisions[revisions.size()];
+      uint16_t type_id;
+      eosio::from_bin(type_id, bin);
+      eosio::check(type_id == std::decay_t<decltype(table)>::value_type::type_id,
+                   "snapshot table mismatch");
+      revisions.push_back(chainbase::read_snapshot(table, base, bin));
+   });
+   db.db.set_revision(block_num);
+   result_cache.clear();
+
+   snapshot_revisions = std::move(revisions);
+   snapshot_block_num = block_num;
+   return true;
+}
+
 constexpr const char MemberConnection_name[] = "MemberConnection";
 constexpr const char MemberEdge_name[] = "MemberEdge";
 using MemberConnection =
@@ -2518,6 +3130,112 @@ constexpr const char DistributionEdge_name[] = "DistributionEdge";
 using DistributionConnection = clchain::Connection<
     clchain::ConnectionConfig<Distribution, DistributionConnection_name, DistributionEdge_name>>;
 
+struct NodePoolStats
+{
+   chainbase::node_pool::stats stats = chainbase::get_node_pool().get_stats();
+
+   uint64_t liveNodes() const { return stats.live_nodes; }
+   uint64_t freeNodes() const { return stats.free_nodes; }
+   uint64_t liveBytes() const { return stats.live_bytes; }
+   uint64_t freeBytes() const { return stats.free_bytes; }
+   uint64_t slabBytes() const { return stats.slab_bytes; }
+   uint64_t largeNodes() const { return stats.large_nodes; }
+   uint64_t largeBytes() const { return stats.large_bytes; }
+};
+EOSIO_REFLECT2(NodePoolStats,
+               liveNodes,
+               freeNodes,
+               liveBytes,
+               freeBytes,
+               slabBytes,
+               largeNodes,
+               largeBytes)
+
+struct TableChanges
+{
+   std::string table;
+   std::vector<uint64_t> created;
+   std::vector<uint64_t> modified;
+   std::vector<uint64_t> removed;
+};
+EOSIO_REFLECT2(TableChanges, table, created, modified, removed)
+
+// Identifies the state after a block. Revisions are reused when blocks are forked out, so the
+// cursor also holds the block's id; a cursor from a forked-out block no longer matches.
+struct ChangesCursor
+{
+   uint32_t revision = 0;
+   eosio::checksum256 blockId;
+};
+EOSIO_REFLECT(ChangesCursor, revision, blockId)
+
+ChangesCursor changes_cursor(uint32_t revision)
+{
+   auto* block = block_log.block_by_num(revision);
+   return {revision, block ? block->id : eosio::checksum256{}};
+}
+
+std::optional<ChangesCursor> changes_cursor_from_hex(const std::string& s)
+{
+   std::vector<char> bytes;
+   bytes.reserve(s.size() / 2);
+   if (!eosio::unhex(std::back_inserter(bytes), s.begin(), s.end()) ||
+       bytes.size() != sizeof(uint32_t) + sizeof(eosio::checksum256))
+      return std::nullopt;
+   return eosio::convert_from_bin<ChangesCursor>(bytes);
+}
+
+// Ids of the objects which changed since a cursor. Only reversible revisions are tracked; if
+// the cursor is older than minRevision, or its block was forked out, then complete is false
+// and tables is empty.
+struct Changes
+{
+   std::pair<int64_t, int64_t> range = db.db.undo_stack_revision_range();
+   std::optional<std::vector<chainbase::table_changes>> changes;
+
+   explicit Changes(const std::string& since)
+   {
+      auto c = changes_cursor_from_hex(since);
+      if (c && c->blockId == changes_cursor(c->revision).blockId)
+         changes = db.db.changes_since(c->revision);
+   }
+
+   uint32_t revision() const { return range.second; }
+   uint32_t minRevision() const { return range.first; }
+   bool complete() const { return changes.has_value(); }
+
+   // Pass as since to get the next changes
+   std::string cursor() const
+   {
+      auto bin = eosio::convert_to_bin(changes_cursor(range.second));
+      return eosio::hex(bin.begin(), bin.end());
+   }
+
+   // Tables which changed
+   std::vector<TableChanges> tables() const
+   {
+      std::vector<TableChanges> result;
+      if (!changes)
+         return result;
+      for (auto& c : *changes)
+      {
+         if (c.created.empty() && c.modified.empty() && c.removed.empty())
+            continue;
+         result.push_back({c.type_name,
+                           {c.created.begin(), c.created.end()},
+                           {c.modified.begin(), c.modified.end()},
+                           {c.removed.begin(), c.removed.end()}});
+      }
+      return result;
+   }
+};
+EOSIO_REFLECT2(Changes, revision, minRevision, complete, cursor, tables)
+
+// Maximum number of objects a filtered connection examines per page. Filters without a
+// supporting index scan the range; if they hit this limit, the page is short and the cursors
+// let the client continue the scan.
+constexpr uint32_t max_filter_scan = 10'000;
+
 struct Query
 {
    subchain::BlockLog blockLog;
@@ -2530,6 +3248,10 @@ struct Query
       return Status{&idx.begin()->status};
    }
 
+   NodePoolStats nodePool() const { return {}; }
+
+   Changes changes(std::string since) const { return Changes{since}; }
+
    BalanceConnection balances(std::optional<eosio::name> gt,
                               std::optional<eosio::name> ge,
                               std::optional<eosio::name> lt,
@@ -2580,7 +3302,9 @@ struct Query
                             std::optional<uint32_t> first,
                             std::optional<uint32_t> last,
                             std::optional<std::string> before,
-                            std::optional<std::string> after) const
+                            std::optional<std::string> after,
+                            std::optional<eosio::name> inviter,
+                            std::optional<bool> participating) const
    {
       return clchain::make_connection<MemberConnection, eosio::name>(
           gt, ge, lt, le, first, last, before, after,    //
@@ -2590,7 +3314,12 @@ struct Query
              return Member{obj.member.account, &obj.member};
           },
           [](auto& members, auto key) { return members.lower_bound(key); },
-          [](auto& members, auto key) { return members.upper_bound(key); });
+          [](auto& members, auto key) { return members.upper_bound(key); },
+          [&](auto& obj) {
+             return (!inviter || obj.member.inviter == *inviter) &&
+                    (!participating || obj.member.participating == *participating);
+          },
+          inviter || participating ? max_filter_scan : ~uint32_t(0));
    }
 
    MemberConnection membersByCreatedAt(std::optional<eosio::block_timestamp> gt,
@@ -2647,6 +3376,8 @@ struct Query
           [](auto& sessions, auto key) { return sessions.upper_bound(key); });
    }
 
+   // If invitee is set, then the by_invitee index narrows the range and cursors are
+   // (invitee, id) pairs instead of ids. inviter is a filter; see max_filter_scan.
    InductionConnection inductions(std::optional<uint64_t> gt,
                                   std::optional<uint64_t> ge,
                                   std::optional<uint64_t> lt,
@@ -2654,17 +3385,38 @@ struct Query
                                   std::optional<uint32_t> first,
                                   std::optional<uint32_t> last,
                                   std::optional<std::string> before,
-                                  std::optional<std::string> after) const
+                                  std::optional<std::string> after,
+                                  std::optional<eosio::name> invitee,
+                                  std::optional<eosio::name> inviter) const
    {
+      auto to_node = [](auto& obj) { return Induction{obj.induction.id, &obj.induction}; };
+      auto filter = [&](auto& obj) { return !inviter || obj.induction.inviter.first == *inviter; };
+      auto max_scan = inviter ? max_filter_scan : ~uint32_t(0);
+      if (invitee)
+      {
+         using key = std::pair<eosio::name, uint64_t>;
+         auto to_key = [&](auto& id) { return std::optional{key{*invitee, id}}; };
+         return clchain::make_connection<InductionConnection, key>(
+             gt ? to_key(*gt) : std::nullopt,                                 //
+             ge ? to_key(*ge) : std::optional{key{*invitee, 0}},              //
+             lt ? to_key(*lt) : std::nullopt,                                 //
+             le ? to_key(*le) : std::optional{key{*invitee, ~uint64_t(0)}},  //
+             first, last, before, after,                                      //
+             db.inductions.get<by_invitee>(),                                 //
+             [](auto& obj) { return obj.by_invitee(); },                      //
+             to_node,
+             [](auto& inductions, auto key) { return inductions.lower_bound(key); },
+             [](auto& inductions, auto key) { return inductions.upper_bound(key); },  //
+             filter, max_scan);
+      }
       return clchain::make_connection<InductionConnection, uint64_t>(
           gt, ge, lt, le, first, last, before, after,  //
           db.inductions.get<by_pk>(),                  //
           [](auto& obj) { return obj.induction.id; },  //
-          [](auto& obj) {
-             return Induction{obj.induction.id, &obj.induction};
-          },
+          to_node,
           [](auto& inductions, auto key) { return inductions.lower_bound(key); },
-          [](auto& inductions, auto key) { return inductions.upper_bound(key); });
+          [](auto& inductions, auto key) { return inductions.upper_bound(key); },  //
+          filter, max_scan);
    }
 
    InductionConnection inductionsByCreatedAt(std::optional<eosio::block_timestamp> gt,
@@ -2735,14 +3487,36 @@ EOSIO_REFLECT2(
     Query,
     blockLog,
     status,
+    nodePool,
+    method(changes, "since"),
     masterPool,
     distributionFund,
     method(balances, "gt", "ge", "lt", "le", "first", "last", "before", "after"),
     method(encryptionKeys, "gt", "ge", "lt", "le", "first", "last", "before", "after"),
-    method(members, "gt", "ge", "lt", "le", "first", "last", "before", "after"),
+    method(members,
+           "gt",
+           "ge",
+           "lt",
+           "le",
+           "first",
+           "last",
+           "before",
+           "after",
+           "inviter",
+           "participating"),
     method(membersByCreatedAt, "gt", "ge", "lt", "le", "first", "last", "before", "after"),
     method(sessions, "gt", "ge", "lt", "le", "first", "last", "before", "after"),
-    method(inductions, "gt", "ge", "lt", "le", "first", "last", "before", "after"),
+    method(inductions,
+           "gt",
+           "ge",
+           "lt",
+           "le",
+           "first",
+           "last",
+           "before",
+           "after",
+           "invitee",
+           "inviter"),
     method(inductionsByCreatedAt, "gt", "ge", "lt", "le", "first", "last", "before", "after"),
     method(elections, "gt", "ge", "lt", "le", "first", "last", "before", "after"),
     method(distributions, "gt", "ge", "lt", "le", "first", "last", "before", "after"))
@@ -2757,11 +3531,131 @@ auto schema = clchain::get_gql_schema<Query>();
    return schema.c_str();
 }
 
+// Schema with the binary type of each scalar field, for clients of queryBin
+const std::string& get_bin_schema()
+{
+   static auto bin_schema = clchain::get_gql_schema<Query>(nullptr, true);
+   return bin_schema;
+}
+[[clang::export_name("getBinSchemaSize")]] uint32_t getBinSchemaSize()
+{
+   return get_bin_schema().size();
+}
+[[clang::export_name("getBinSchema")]] const char* getBinSchema()
+{
+   return get_bin_schema().c_str();
+}
+
+clchain::gql_plan_cache<Query> query_cache;
+
+// Sets the byte budget of the query result cache; 0 disables it
+[[clang::export_name("setResultCacheSize")]] void setResultCacheSize(uint32_t max_bytes)
+{
+   result_cache.max_bytes = max_bytes;
+   result_cache.clear();
+}
+
+// The response is compact JSON unless pretty is set. Compact responses are cached until the
+// state changes.
 [[clang::export_name("query")]] void query(const char* query,
                                            uint32_t size,
                                            const char* variables,
-                                           uint32_t variables_size)
+                                           uint32_t variables_size,
+                                           bool pretty)
 {
+   if (!pretty)
+   {
+      auto* cached = result_cache.get(db_revision(), {query, size}, {variables, variables_size});
+      if (cached)
+      {
+         result = *cached;
+         return;
+      }
+   }
+   block_log.release_archived();
    Query root{block_log};
-   result = clchain::gql_query(root, {query, size}, {variables, variables_size});
+   auto& plan = query_cache.get({query, size});
+   if (pretty)
+      result = clchain::gql_query<clchain::gql_pretty_stream<eosio::string_stream>>(
+          root, plan, {variables, variables_size});
+   else
+   {
+      result = clchain::gql_query(root, plan, {variables, variables_size});
+      result_cache.put(db_revision(), {query, size}, {variables, variables_size},
+                       std::get<std::string>(result));
+   }
+}
+
+// Like query, but the response is binary; see clchain::gql_query_bin
+[[clang::export_name("queryBin")]] void queryBin(const char* query,
+                                                 uint32_t size,
+                                                 const char* variables,
+                                                 uint32_t variables_size)
+{
+   block_log.release_archived();
+   Query root{block_log};
+   result = clchain::gql_query_bin(root, query_cache.get({query, size}),
+                                   {variables, variables_size});
+}
+
+[[clang::import_module("clchain"), clang::import_name("query_chunk")]] void query_chunk(
+    const char* data,
+    uint32_t size);
+
+// Responses which queryChunked streams are also cached if they're at most this size. Larger ones
+// aren't, since keeping a copy for the cache would double buffer them again.
+constexpr uint32_t chunked_cache_max_bytes = 64 * 1024;
+
+// Like query, but passes the response to the host's query_chunk in pieces of up to
+// chunk_size bytes instead of storing it in result. Returns false if the query failed after
+// part of the response was passed; result then holds the error response. Only responses up to
+// chunked_cache_max_bytes are cached.
+[[clang::export_name("queryChunked")]] bool queryChunked(const char* query,
+                                                         uint32_t size,
+                                                         const char* variables,
+                                                         uint32_t variables_size,
+                                                         uint32_t chunk_size,
+                                                         bool pretty)
+{
+   chunk_size = std::max(chunk_size, uint32_t(1));
+   if (!pretty)
+   {
+      auto* cached = result_cache.get(db_revision(), {query, size}, {variables, variables_size});
+      if (cached)
+      {
+         for (size_t pos = 0; pos < cached->size(); pos += chunk_size)
+            query_chunk(cached->data() + pos, std::min<size_t>(chunk_size, cached->size() - pos));
+         return true;
+      }
+   }
+   block_log.release_archived();
+   Query root{block_log};
+   auto& plan = query_cache.get({query, size});
+   std::string error;
+   // Keeps a copy of small responses for the cache
+   std::string response;
+   bool keep = !pretty;
+   auto keep_limit = std::min<size_t>(chunked_cache_max_bytes, result_cache.max_bytes);
+   auto flush = [&](const char* data, uint32_t n) {
+      query_chunk(data, n);
+      keep = keep && response.size() + n <= keep_limit;
+      if (keep)
+         response.append(data, n);
+      else
+         std::string{}.swap(response);
+   };
+   bool ok = pretty ? clchain::gql_query_chunked<clchain::gql_pretty_stream>(
+                          root, plan, {variables, variables_size}, chunk_size, flush, error)
+                    : clchain::gql_query_chunked(root, plan, {variables, variables_size},
+                                                 chunk_size, flush, error);
+   if (ok)
+   {
+      if (keep)
+         result_cache.put(db_revision(), {query, size}, {variables, variables_size},
+                          std::move(response));
+      return true;
+   }
+   result = clchain::gql_response<eosio::string_stream>(
+       [&](auto&, const auto& set_error) { return set_error(error); });
+   return false;
 }
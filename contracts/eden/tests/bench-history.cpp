@@ -0,0 +1,61 @@
+#include <tester-base.hpp>
+
+// Generates a synthetic Eden history for benchmarking the micro-chain. The SHiP messages of
+// every block are written to a file, each prefixed by its 32-bit little-endian size, ready
+// for pushShipMessage. See packages/eden-subchain-client/bench/micro-chain.js.
+
+std::string history_file = "eden-bench-history.bin";
+uint32_t num_inductions = 1000;
+uint32_t num_elections = 3;
+
+int main(int argc, char* argv[])
+{
+   Catch::Session session;
+   auto cli =
+       session.cli() |
+       Catch::clara::Opt(history_file, "file")["-o"]["--output"]("History file to write") |
+       Catch::clara::Opt(num_inductions, "n")["--inductions"]("Number of members to induct") |
+       Catch::clara::Opt(num_elections, "n")["--elections"]("Number of elections to run");
+   session.cli(cli);
+   auto ret = session.applyCommandLine(argc, argv);
+   if (ret)
+      return ret;
+   return session.run();
+}
+
+uint32_t write_ship_history(test_chain& chain, const std::string& filename)
+{
+   std::ofstream file{filename, std::ios::binary};
+   eosio::check(file.is_open(), "failed to open " + filename);
+   uint32_t num_blocks = 0;
+   for (uint32_t block_num = 2; auto history = chain.get_history(block_num); ++block_num)
+   {
+      uint32_t size = history->memory.size();
+      file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+      file.write(history->memory.data(), size);
+      ++num_blocks;
+   }
+   return num_blocks;
+}
+
+TEST_CASE("Generate micro-chain benchmark history")
+{
+   eden_tester t;
+   t.genesis();
+   t.set_balance(s2a("100000.0000 EOS"));
+   t.induct_n(num_inductions);
+   for (uint32_t i = 0; i < num_elections; ++i)
+   {
+      t.run_election();
+      t.chain.start_block();
+      t.distribute();
+      t.skip_to(t.chain.get_head_block_info().timestamp.to_time_point() + eosio::days(30));
+      t.distribute();
+   }
+   t.chain.start_block();
+   t.chain.start_block();
+
+   auto num_blocks = write_ship_history(t.chain, history_file);
+   printf("%s: %u blocks, %u inductions, %u elections\n", history_file.c_str(), num_blocks,
+          num_inductions, num_elections);
+}
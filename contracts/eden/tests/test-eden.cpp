@@ -1208,6 +1208,11 @@ TEST_CASE("clearall")
                       std::tuple("eden.gm"_n, "eden.gm"_n, "rename"_n)}});
    t.chain.start_block();
    t.genesis();
+   // The micro-chain must not keep references to the cleared rows
+   test_chain::user_context{t.chain, {{"eden.gm"_n, "board.major"_n}, {"ahab"_n, "active"_n}}}
+       .act<actions::rename>("alice"_n, "ahab"_n);
+   CHECK(get_eden_membership("ahab"_n).status() == eden::member_status::active_member);
+   t.write_dfuse_history("dfuse-test-clearall.json");
 }
 
 TEST_CASE("account migration")
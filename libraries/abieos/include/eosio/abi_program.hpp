@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "abi.hpp"
+#include "stream.hpp"
+
+namespace eosio
+{
+   // A type from an abi compiled to a flat program. abi_type::bin_to_json and
+   // abi_type::json_to_bin walk the type graph, dispatching through abi_serializer and pushing a
+   // stack entry for every struct, array, and variant they visit; a program runs the same
+   // conversions in a single loop over its instructions:
+   //
+   // * Small non-recursive structs are inlined into their users; recursive and large structs,
+   //   and variant alternatives, become subroutines.
+   // * Struct keys are pre-rendered.
+   // * Adjacent fixed-size values (integers, names, assets, checksums, ...) form runs. bin_to_json
+   //   bounds-checks a run once, then reads each value at its offset within the run.
+   // * Common builtins are decoded inline; the rest fall back to their abi_serializer.
+   //
+   // Results match abi_type::bin_to_json and abi_type::json_to_bin. The abi must outlive the
+   // program and must not change while it's in use. A program is immutable once built, so
+   // threads may share it.
+   class abi_program
+   {
+     public:
+      explicit abi_program(const abi_type* type);
+
+      // Appends json to dest. Doesn't check for extra data after the value.
+      void bin_to_json(input_stream& bin, std::vector<char>& dest) const;
+      std::string bin_to_json(input_stream& bin) const;
+
+      std::vector<char> json_to_bin(std::string_view json) const;
+
+      enum class op : uint8_t;
+
+      struct instruction
+      {
+         op code;
+         uint8_t flags;
+         uint16_t size;
+         uint32_t a;
+         uint32_t b;
+         uint32_t c;
+      };
+
+      struct variant_case
+      {
+         uint32_t literal;  // ["name", in literals, followed by the unquoted name
+         uint32_t literal_size;
+         uint32_t name_size;
+         uint32_t pc;
+      };
+
+     private:
+      struct compiler;
+
+      std::vector<instruction> code;
+      std::vector<variant_case> cases;
+      std::vector<const abi_type*> types;
+      std::string literals;
+   };
+}  // namespace eosio
@@ -89,6 +89,58 @@ extern "C"
                                   const char* type,
                                   const char* hex);
 
+   typedef struct abieos_abi_s abieos_abi;
+
+   // Compile an abi (JSON format) into a handle which may be shared between threads. Returns null
+   // on error; use abieos_get_error to retrieve error.
+   abieos_abi* abieos_compile_abi(abieos_context* context, const char* abi);
+
+   // Compile an abi (binary format). Returns null on error; use abieos_get_error to retrieve error.
+   abieos_abi* abieos_compile_abi_bin(abieos_context* context, const char* data, size_t size);
+
+   // Destroy a compiled abi. It must not be in use by any thread.
+   void abieos_destroy_abi(abieos_abi* abi);
+
+   // Convert json to binary using a compiled abi. Multiple threads may convert using the same abi,
+   // each with its own context. Use abieos_get_bin_* to retrieve result. Returns false on error.
+   abieos_bool abieos_abi_json_to_bin(abieos_context* context,
+                                      const abieos_abi* abi,
+                                      const char* type,
+                                      const char* json);
+
+   typedef struct abieos_bin_to_json_item
+   {
+      // Set by the caller
+      const char* type;
+      const char* data;
+      size_t size;
+
+      // Set by abieos_bin_to_json_batch. The null-terminated json, or the error message if ok is
+      // false, is at arena + json_offset. json_size doesn't include the null terminator.
+      size_t json_offset;
+      size_t json_size;
+      abieos_bool ok;
+   } abieos_bin_to_json_item;
+
+   // Convert a batch of binary values to json using up to num_threads threads (0 uses one per
+   // core): the calling thread, and worker threads which the context starts on first use and keeps
+   // until it's destroyed. Items are converted in order until their results fill arena.
+   // *num_converted is set to the number of items whose results are in arena, and *arena_used to
+   // the bytes those use; call again with the remaining items to continue. Conversion stops soon
+   // after the arena fills, so few of the remaining items are converted twice. If not even the
+   // first item's result fits, returns false and sets *arena_used to the size it needs. Items which
+   // fail to convert don't fail the batch. Multiple threads may convert batches using the same abi,
+   // each with its own context. Returns false on error; use abieos_get_error to retrieve error.
+   abieos_bool abieos_bin_to_json_batch(abieos_context* context,
+                                        const abieos_abi* abi,
+                                        abieos_bin_to_json_item* items,
+                                        size_t count,
+                                        char* arena,
+                                        size_t arena_size,
+                                        size_t* arena_used,
+                                        size_t* num_converted,
+                                        uint32_t num_threads);
+
 #ifdef __cplusplus
 }
 #endif
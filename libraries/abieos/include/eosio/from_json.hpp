@@ -3,12 +3,14 @@
 #include <errno.h>
 #include <rapidjson/reader.h>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <optional>
 #include <variant>
 #include <vector>
 #include "check.hpp"
 #include "for_each_field.hpp"
+#include "json_scanner.hpp"
 #include "types.hpp"
 
 namespace eosio
@@ -189,46 +191,24 @@ namespace eosio
       std::string_view value_string = {};
    };
 
-   class json_token_stream
-       : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, json_token_stream>
+   // The get_ methods of the json token streams. Derived provides current_token, complete,
+   // peek_token, and eat_token.
+   template <typename Derived>
+   class json_token_reader
    {
-     private:
-      rapidjson::Reader reader;
-      rapidjson::InsituStringStream ss;
-
      public:
-      json_token current_token;
-
-      // This modifies json
-      json_token_stream(char* json) : ss{json} { reader.IterativeParseInit(); }
-
-      bool complete() { return reader.IterativeParseComplete(); }
-
-      std::reference_wrapper<const json_token> peek_token()
-      {
-         if (current_token.type != json_token_type::type_unread)
-            return current_token;
-         check(
-             reader.IterativeParseNext<
-                 rapidjson::kParseInsituFlag | rapidjson::kParseValidateEncodingFlag |
-                 rapidjson::kParseIterativeFlag | rapidjson::kParseNumbersAsStringsFlag>(ss, *this),
-             convert_error_to_string_view(reader.GetParseErrorCode()));
-         return current_token;
-      }
-
-      void eat_token() { current_token.type = json_token_type::type_unread; }
-
       void get_end()
       {
-         check(current_token.type == json_token_type::type_unread && complete(),
+         check(derived().current_token.type == json_token_type::type_unread &&
+                   derived().complete(),
                convert_json_error(from_json_error::expected_end));
       }
       bool get_null_pred()
       {
-         auto t = peek_token();
+         auto t = derived().peek_token();
          if (t.get().type != json_token_type::type_null)
             return false;
-         eat_token();
+         derived().eat_token();
          return true;
       }
       void get_null()
@@ -238,80 +218,80 @@ namespace eosio
 
       bool get_bool()
       {
-         auto t = peek_token();
+         auto t = derived().peek_token();
          check(t.get().type == json_token_type::type_bool,
                convert_json_error(from_json_error::expected_bool));
-         eat_token();
+         derived().eat_token();
          return t.get().value_bool;
       }
 
       std::string_view get_string()
       {
-         auto t = peek_token();
+         auto t = derived().peek_token();
          check(t.get().type == json_token_type::type_string,
                convert_json_error(from_json_error::expected_string));
-         eat_token();
+         derived().eat_token();
          return t.get().value_string;
       }
 
       void get_start_object()
       {
-         auto t = peek_token();
+         auto t = derived().peek_token();
          check(t.get().type == json_token_type::type_start_object,
                convert_json_error(from_json_error::expected_start_object));
-         eat_token();
+         derived().eat_token();
       }
 
       std::string_view get_key()
       {
-         auto t = peek_token();
+         auto t = derived().peek_token();
          check(t.get().type == json_token_type::type_key,
                convert_json_error(from_json_error::expected_key));
-         eat_token();
+         derived().eat_token();
          return t.get().key;
       }
 
       std::optional<std::string_view> maybe_get_key()
       {
-         auto t = peek_token();
+         auto t = derived().peek_token();
          if (t.get().type != json_token_type::type_key)
             return {};
-         eat_token();
+         derived().eat_token();
          return t.get().key;
       }
 
       bool get_end_object_pred()
       {
-         auto t = peek_token();
+         auto t = derived().peek_token();
          if (t.get().type != json_token_type::type_end_object)
             return false;
-         eat_token();
+         derived().eat_token();
          return true;
       }
 
       void get_end_object()
       {
-         auto t = peek_token();
+         auto t = derived().peek_token();
          check(t.get().type == json_token_type::type_end_object,
                convert_json_error(from_json_error::expected_end_object));
-         eat_token();
+         derived().eat_token();
       }
 
       bool get_start_array_pred()
       {
-         auto t = peek_token();
+         auto t = derived().peek_token();
          if (t.get().type != json_token_type::type_start_array)
             return false;
-         eat_token();
+         derived().eat_token();
          return true;
       }
 
       bool get_end_array_pred()
       {
-         auto t = peek_token();
+         auto t = derived().peek_token();
          if (t.get().type != json_token_type::type_end_array)
             return false;
-         eat_token();
+         derived().eat_token();
          return true;
       }
       void get_start_array()
@@ -324,6 +304,41 @@ namespace eosio
          check(get_end_array_pred(), convert_json_error(from_json_error::expected_end_array));
       }
 
+     private:
+      Derived& derived() { return static_cast<Derived&>(*this); }
+   };
+
+   // Tokenizes json in place using rapidjson's iterative reader
+   class rapidjson_token_stream
+       : public json_token_reader<rapidjson_token_stream>,
+         public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, rapidjson_token_stream>
+   {
+     private:
+      rapidjson::Reader reader;
+      rapidjson::InsituStringStream ss;
+
+     public:
+      json_token current_token;
+
+      // This modifies json
+      rapidjson_token_stream(char* json) : ss{json} { reader.IterativeParseInit(); }
+
+      bool complete() { return reader.IterativeParseComplete(); }
+
+      std::reference_wrapper<const json_token> peek_token()
+      {
+         if (current_token.type != json_token_type::type_unread)
+            return current_token;
+         check(
+             reader.IterativeParseNext<
+                 rapidjson::kParseInsituFlag | rapidjson::kParseValidateEncodingFlag |
+                 rapidjson::kParseIterativeFlag | rapidjson::kParseNumbersAsStringsFlag>(ss, *this),
+             convert_error_to_string_view(reader.GetParseErrorCode()));
+         return current_token;
+      }
+
+      void eat_token() { current_token.type = json_token_type::type_unread; }
+
       // BaseReaderHandler methods
       bool Null()
       {
@@ -377,7 +392,486 @@ namespace eosio
          current_token.type = json_token_type::type_end_array;
          return true;
       }
-   };  // json_token_stream
+   };  // rapidjson_token_stream
+
+   // Tokenizes json in place. json_scanner finds the significant characters a block at a time,
+   // which lets this skip whitespace and string contents without looking at each byte. Tokens
+   // are validated as they're read, following rapidjson's grammar and error codes: strings are
+   // unescaped in place and checked for valid utf8, and numbers are returned as strings.
+   class json_scan_token_stream : public json_token_reader<json_scan_token_stream>
+   {
+     private:
+      enum class parse_state : uint8_t
+      {
+         start,
+         finish,
+         object_initial,
+         member_key,
+         key_value_delimiter,
+         member_value,
+         member_delimiter,
+         array_initial,
+         element,
+         element_delimiter,
+      };
+
+      char* pos;
+      char* end;
+      json_scanner scanner;
+      parse_state state = parse_state::start;
+      std::vector<parse_state> containers;  // the state to restore when each container ends
+
+     public:
+      json_token current_token;
+
+      // This modifies json
+      json_scan_token_stream(char* json)
+          : pos{json}, end{json + strlen(json)}, scanner{json, end}
+      {
+      }
+
+      bool complete() { return state == parse_state::finish; }
+
+      std::reference_wrapper<const json_token> peek_token()
+      {
+         if (current_token.type == json_token_type::type_unread)
+            read_token();
+         return current_token;
+      }
+
+      void eat_token() { current_token.type = json_token_type::type_unread; }
+
+     private:
+      void read_token()
+      {
+         if (state == parse_state::finish)
+            return;
+         while (true)
+         {
+            auto next = scanner.next(pos);
+            if (next == end)
+            {
+               // rapidjson reports whitespace-only json as an invalid value
+               check(false, convert_json_error(state == parse_state::start && next != pos
+                                                   ? from_json_error::value_invalid
+                                                   : state_error()));
+               return;
+            }
+            pos += next - pos;
+            switch (*pos)
+            {
+               case '{':
+                  begin_container(json_token_type::type_start_object,
+                                  parse_state::object_initial);
+                  return;
+               case '[':
+                  begin_container(json_token_type::type_start_array, parse_state::array_initial);
+                  return;
+               case '}':
+                  check(state == parse_state::object_initial || state == parse_state::member_value,
+                        convert_json_error(state_error()));
+                  end_container(json_token_type::type_end_object);
+                  return;
+               case ']':
+                  check(state == parse_state::array_initial || state == parse_state::element,
+                        convert_json_error(state_error()));
+                  end_container(json_token_type::type_end_array);
+                  return;
+               case ':':
+                  check(state == parse_state::member_key, convert_json_error(state_error()));
+                  state = parse_state::key_value_delimiter;
+                  ++pos;
+                  break;
+               case ',':
+                  if (state == parse_state::member_value)
+                     state = parse_state::member_delimiter;
+                  else if (state == parse_state::element)
+                     state = parse_state::element_delimiter;
+                  else
+                     check(false, convert_json_error(state_error()));
+                  ++pos;
+                  break;
+               case '"':
+                  if (state == parse_state::object_initial ||
+                      state == parse_state::member_delimiter)
+                  {
+                     current_token.key = read_string();
+                     current_token.type = json_token_type::type_key;
+                     state = parse_state::member_key;
+                     return;
+                  }
+                  check_value_allowed();
+                  current_token.value_string = read_string();
+                  current_token.type = json_token_type::type_string;
+                  end_value();
+                  return;
+               case 't':
+                  check_value_allowed();
+                  read_literal("true");
+                  current_token.type = json_token_type::type_bool;
+                  current_token.value_bool = true;
+                  end_value();
+                  return;
+               case 'f':
+                  check_value_allowed();
+                  read_literal("false");
+                  current_token.type = json_token_type::type_bool;
+                  current_token.value_bool = false;
+                  end_value();
+                  return;
+               case 'n':
+                  check_value_allowed();
+                  read_literal("null");
+                  current_token.type = json_token_type::type_null;
+                  end_value();
+                  return;
+               default:
+               {
+                  check_value_allowed();
+                  auto begin = pos;
+                  read_number();
+                  current_token.value_string = {begin, size_t(pos - begin)};
+                  current_token.type = json_token_type::type_string;
+                  end_value();
+                  return;
+               }
+            }
+         }
+      }
+
+      // The error for a token which isn't allowed in the current state
+      from_json_error state_error() const
+      {
+         switch (state)
+         {
+            case parse_state::start:
+               return from_json_error::document_empty;
+            case parse_state::finish:
+               return from_json_error::document_root_not_singular;
+            case parse_state::object_initial:
+            case parse_state::member_delimiter:
+               return from_json_error::object_miss_name;
+            case parse_state::member_key:
+               return from_json_error::object_miss_colon;
+            case parse_state::member_value:
+               return from_json_error::object_miss_comma_or_curly_bracket;
+            case parse_state::element:
+               return from_json_error::array_miss_comma_or_square_bracket;
+            default:
+               return from_json_error::value_invalid;
+         }
+      }
+
+      void check_value_allowed()
+      {
+         check(state == parse_state::start || state == parse_state::key_value_delimiter ||
+                   state == parse_state::array_initial ||
+                   state == parse_state::element_delimiter,
+               convert_json_error(state_error()));
+      }
+
+      // The state after a value in the current state
+      parse_state after_value() const
+      {
+         if (state == parse_state::start)
+            return parse_state::finish;
+         if (state == parse_state::key_value_delimiter)
+            return parse_state::member_value;
+         return parse_state::element;
+      }
+
+      void end_value()
+      {
+         state = after_value();
+         if (state == parse_state::finish)
+            check(scanner.next(pos) == end,
+                  convert_json_error(from_json_error::document_root_not_singular));
+      }
+
+      void begin_container(json_token_type type, parse_state initial)
+      {
+         check_value_allowed();
+         containers.push_back(after_value());
+         state = initial;
+         current_token.type = type;
+         ++pos;
+      }
+
+      void end_container(json_token_type type)
+      {
+         current_token.type = type;
+         ++pos;
+         state = containers.back();
+         containers.pop_back();
+         if (state == parse_state::finish)
+            check(scanner.next(pos) == end,
+                  convert_json_error(from_json_error::document_root_not_singular));
+      }
+
+      void read_literal(const char* literal)
+      {
+         for (; *literal; ++literal, ++pos)
+            check(*pos == *literal, convert_json_error(from_json_error::value_invalid));
+      }
+
+      static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+      // Follows rapidjson's number grammar, including the points where it gives up on numbers
+      // which don't fit in a double
+      void read_number()
+      {
+         bool minus = *pos == '-';
+         if (minus)
+            ++pos;
+         uint64_t i = 0;
+         double d = 0;
+         bool use_double = false;
+         int significant_digits = 0;
+         if (*pos == '0')
+         {
+            ++pos;
+         }
+         else if (*pos >= '1' && *pos <= '9')
+         {
+            // Exact until the next digit could overflow int64_t or uint64_t
+            const uint64_t limit = minus ? 0x0ccc'cccc'cccc'cccc : 0x1999'9999'9999'9999;
+            const char max_digit = minus ? '8' : '5';
+            i = *pos++ - '0';
+            for (; is_digit(*pos); ++pos, ++significant_digits)
+            {
+               if (i >= limit && (i != limit || *pos > max_digit))
+               {
+                  d = i;
+                  use_double = true;
+                  break;
+               }
+               i = i * 10 + (*pos - '0');
+            }
+            for (; use_double && is_digit(*pos); ++pos)
+            {
+               check(d < 1.7976931348623157e307,
+                     convert_json_error(from_json_error::number_too_big));
+               d = d * 10 + (*pos - '0');
+            }
+         }
+         else
+         {
+            check(false, convert_json_error(from_json_error::value_invalid));
+         }
+
+         int exp_frac = 0;
+         if (*pos == '.')
+         {
+            ++pos;
+            check(is_digit(*pos), convert_json_error(from_json_error::number_miss_fraction));
+            for (; !use_double && is_digit(*pos) && i <= 0x1f'ffff'ffff'ffff; ++pos)
+            {
+               i = i * 10 + (*pos - '0');
+               --exp_frac;
+               if (i)
+                  ++significant_digits;
+            }
+            if (!use_double)
+               d = i;
+            use_double = true;
+            for (; is_digit(*pos); ++pos)
+            {
+               if (significant_digits >= 17)
+                  continue;
+               d = d * 10 + (*pos - '0');
+               --exp_frac;
+               if (d > 0)
+                  ++significant_digits;
+            }
+         }
+
+         if (*pos == 'e' || *pos == 'E')
+         {
+            ++pos;
+            bool exp_minus = *pos == '-';
+            if (*pos == '+' || *pos == '-')
+               ++pos;
+            check(is_digit(*pos), convert_json_error(from_json_error::number_miss_exponent));
+            int exp = *pos++ - '0';
+            for (; is_digit(*pos); ++pos)
+            {
+               if (exp_minus)
+                  continue;
+               exp = exp * 10 + (*pos - '0');
+               check(exp <= 308 - exp_frac, convert_json_error(from_json_error::number_too_big));
+            }
+         }
+      }
+
+      static int hex_digit(char c)
+      {
+         if (c >= '0' && c <= '9')
+            return c - '0';
+         if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+         if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+         return -1;
+      }
+
+      static uint32_t read_hex4(const char*& in)
+      {
+         uint32_t result = 0;
+         for (int i = 0; i < 4; ++i, ++in)
+         {
+            auto digit = hex_digit(*in);
+            check(digit >= 0,
+                  convert_json_error(from_json_error::string_unicode_escape_invalid_hex));
+            result = result * 16 + digit;
+         }
+         return result;
+      }
+
+      static void write_utf8(uint32_t code_point, char*& out)
+      {
+         if (code_point < 0x80)
+         {
+            *out++ = code_point;
+         }
+         else if (code_point < 0x800)
+         {
+            *out++ = 0xc0 | (code_point >> 6);
+            *out++ = 0x80 | (code_point & 0x3f);
+         }
+         else if (code_point < 0x10000)
+         {
+            *out++ = 0xe0 | (code_point >> 12);
+            *out++ = 0x80 | ((code_point >> 6) & 0x3f);
+            *out++ = 0x80 | (code_point & 0x3f);
+         }
+         else
+         {
+            *out++ = 0xf0 | (code_point >> 18);
+            *out++ = 0x80 | ((code_point >> 12) & 0x3f);
+            *out++ = 0x80 | ((code_point >> 6) & 0x3f);
+            *out++ = 0x80 | (code_point & 0x3f);
+         }
+      }
+
+      // Decodes the escape sequence at in. The result is never longer than the sequence.
+      static const char* unescape(const char* in, char*& out)
+      {
+         ++in;
+         switch (char c = *in++)
+         {
+            case '"':
+            case '\\':
+            case '/':
+               *out++ = c;
+               return in;
+            case 'b':
+               *out++ = '\b';
+               return in;
+            case 'f':
+               *out++ = '\f';
+               return in;
+            case 'n':
+               *out++ = '\n';
+               return in;
+            case 'r':
+               *out++ = '\r';
+               return in;
+            case 't':
+               *out++ = '\t';
+               return in;
+            case 'u':
+            {
+               auto code_point = read_hex4(in);
+               if (code_point >= 0xd800 && code_point <= 0xdfff)
+               {
+                  check(code_point <= 0xdbff && in[0] == '\\' && in[1] == 'u',
+                        convert_json_error(from_json_error::string_unicode_surrogate_invalid));
+                  in += 2;
+                  auto low = read_hex4(in);
+                  check(low >= 0xdc00 && low <= 0xdfff,
+                        convert_json_error(from_json_error::string_unicode_surrogate_invalid));
+                  code_point = (((code_point - 0xd800) << 10) | (low - 0xdc00)) + 0x10000;
+               }
+               write_utf8(code_point, out);
+               return in;
+            }
+            default:
+               check(false, convert_json_error(from_json_error::string_escape_invalid));
+               return in;
+         }
+      }
+
+      // Copies the utf8 sequence at in, rejecting overlong forms, surrogates, and code points
+      // past U+10FFFF
+      static const char* copy_utf8(const char* in, char*& out)
+      {
+         auto byte = [&](int i) { return (unsigned char)in[i]; };
+         int size = 0;
+         unsigned char min = 0x80, max = 0xbf;
+         if (byte(0) >= 0xc2 && byte(0) <= 0xdf)
+         {
+            size = 2;
+         }
+         else if (byte(0) >= 0xe0 && byte(0) <= 0xef)
+         {
+            size = 3;
+            if (byte(0) == 0xe0)
+               min = 0xa0;
+            else if (byte(0) == 0xed)
+               max = 0x9f;
+         }
+         else if (byte(0) >= 0xf0 && byte(0) <= 0xf4)
+         {
+            size = 4;
+            if (byte(0) == 0xf0)
+               min = 0x90;
+            else if (byte(0) == 0xf4)
+               max = 0x8f;
+         }
+         check(size && byte(1) >= min && byte(1) <= max,
+               convert_json_error(from_json_error::string_invalid_encoding));
+         for (int i = 2; i < size; ++i)
+            check(byte(i) >= 0x80 && byte(i) <= 0xbf,
+                  convert_json_error(from_json_error::string_invalid_encoding));
+         memmove(out, in, size);
+         out += size;
+         return in + size;
+      }
+
+      // Reads the string starting at pos and unescapes it in place. The result is
+      // null-terminated.
+      std::string_view read_string()
+      {
+         char* begin = pos + 1;
+         char* close = begin + (scanner.next(begin) - begin);
+         char* out = begin + (scanner.find_string_special(begin, close) - begin);
+         const char* in = out;
+         while (in != close)
+         {
+            if (*in == '\\')
+               in = unescape(in, out);
+            else if ((unsigned char)*in >= 0x80)
+               in = copy_utf8(in, out);
+            else
+               check(false, convert_json_error(from_json_error::string_invalid_encoding));
+            auto run = scanner.find_string_special(in, close);
+            memmove(out, in, run - in);
+            out += run - in;
+            in = run;
+         }
+         check(close != end, convert_json_error(from_json_error::string_miss_quotation_mark));
+         *out = 0;
+         pos = close + 1;
+         return {begin, size_t(out - begin)};
+      }
+   };  // json_scan_token_stream
+
+   // json_scan_token_stream is opt-in until it has been checked against rapidjson itself
+#ifdef EOSIO_JSON_SCAN_TOKENIZER
+   using json_token_stream = json_scan_token_stream;
+#else
+   using json_token_stream = rapidjson_token_stream;
+#endif
 
    template <typename SrcIt, typename DestIt>
    [[nodiscard]] bool unhex(DestIt dest, SrcIt begin, SrcIt end)
@@ -0,0 +1,306 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstring>
+
+#if defined(__wasm_simd128__) && defined(__has_builtin)
+#if __has_builtin(__builtin_wasm_bitmask_i8x16)
+#define EOSIO_JSON_SCAN_SIMD128
+#include <wasm_simd128.h>
+#endif
+#elif defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace eosio
+{
+   // Character classes for a 64-byte block of json; bit i describes byte i
+   struct json_block_masks
+   {
+      uint64_t quote = 0;
+      uint64_t backslash = 0;
+      uint64_t whitespace = 0;
+   };
+
+   // The vectorized parts of json scanning. classify reads exactly 64 bytes. find_string_special
+   // returns the first byte in [begin, end) which a string can't copy as-is: a control character,
+   // a backslash, or a byte of a multi-byte utf8 sequence. It returns end if there are none.
+   struct json_scan_backend
+   {
+      const char* name;
+      void (*classify)(const char* p, json_block_masks& masks);
+      const char* (*find_string_special)(const char* begin, const char* end);
+   };
+
+   namespace json_scan
+   {
+      inline bool is_string_special(char c)
+      {
+         return (unsigned char)c < 0x20 || (unsigned char)c >= 0x80 || c == '\\';
+      }
+
+      inline void classify_scalar(const char* p, json_block_masks& masks)
+      {
+         masks = {};
+         for (int i = 0; i < 64; ++i)
+         {
+            uint64_t bit = uint64_t(1) << i;
+            switch (p[i])
+            {
+               case '"':
+                  masks.quote |= bit;
+                  break;
+               case '\\':
+                  masks.backslash |= bit;
+                  break;
+               case ' ':
+               case '\t':
+               case '\n':
+               case '\r':
+                  masks.whitespace |= bit;
+                  break;
+            }
+         }
+      }
+
+      inline const char* find_string_special_scalar(const char* begin, const char* end)
+      {
+         while (begin != end && !is_string_special(*begin))
+            ++begin;
+         return begin;
+      }
+
+      inline constexpr json_scan_backend scalar = {"scalar", classify_scalar,
+                                                   find_string_special_scalar};
+
+#if defined(EOSIO_JSON_SCAN_SIMD128)
+      inline uint64_t classify_16(v128_t v, uint8_t c)
+      {
+         return uint16_t(wasm_i8x16_bitmask(wasm_i8x16_eq(v, wasm_i8x16_splat(c))));
+      }
+
+      inline void classify_simd128(const char* p, json_block_masks& masks)
+      {
+         masks = {};
+         for (int i = 0; i < 64; i += 16)
+         {
+            v128_t v = wasm_v128_load(p + i);
+            masks.quote |= classify_16(v, '"') << i;
+            masks.backslash |= classify_16(v, '\\') << i;
+            masks.whitespace |= (classify_16(v, ' ') | classify_16(v, '\t') |
+                                 classify_16(v, '\n') | classify_16(v, '\r'))
+                                << i;
+         }
+      }
+
+      inline const char* find_string_special_simd128(const char* begin, const char* end)
+      {
+         for (; end - begin >= 16; begin += 16)
+         {
+            v128_t v = wasm_v128_load(begin);
+            // Bytes >= 0x80 are negative, so the signed compare catches them with the control
+            // characters
+            v128_t special = wasm_v128_or(wasm_i8x16_lt(v, wasm_i8x16_splat(0x20)),
+                                          wasm_i8x16_eq(v, wasm_i8x16_splat('\\')));
+            uint32_t m = wasm_i8x16_bitmask(special);
+            if (m)
+               return begin + __builtin_ctz(m);
+         }
+         return find_string_special_scalar(begin, end);
+      }
+
+      inline constexpr json_scan_backend simd128 = {"simd128", classify_simd128,
+                                                    find_string_special_simd128};
+
+      inline const json_scan_backend& select_backend() { return simd128; }
+#elif defined(__SSE2__) && !defined(__wasm_simd128__)
+      inline uint64_t classify_16(__m128i v, char c)
+      {
+         return uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c))));
+      }
+
+      inline void classify_sse2(const char* p, json_block_masks& masks)
+      {
+         masks = {};
+         for (int i = 0; i < 64; i += 16)
+         {
+            __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+            masks.quote |= classify_16(v, '"') << i;
+            masks.backslash |= classify_16(v, '\\') << i;
+            masks.whitespace |= (classify_16(v, ' ') | classify_16(v, '\t') |
+                                 classify_16(v, '\n') | classify_16(v, '\r'))
+                                << i;
+         }
+      }
+
+      inline const char* find_string_special_sse2(const char* begin, const char* end)
+      {
+         for (; end - begin >= 16; begin += 16)
+         {
+            __m128i v = _mm_loadu_si128((const __m128i*)begin);
+            // Bytes >= 0x80 are negative, so the signed compare catches them with the control
+            // characters
+            uint32_t m = _mm_movemask_epi8(_mm_or_si128(_mm_cmplt_epi8(v, _mm_set1_epi8(0x20)),
+                                                        _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))));
+            if (m)
+               return begin + __builtin_ctz(m);
+         }
+         return find_string_special_scalar(begin, end);
+      }
+
+      inline constexpr json_scan_backend sse2 = {"sse2", classify_sse2, find_string_special_sse2};
+
+      __attribute__((target("avx2"))) inline uint64_t classify_32(__m256i v, char c)
+      {
+         return uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c))));
+      }
+
+      __attribute__((target("avx2"))) inline void classify_avx2(const char* p,
+                                                                json_block_masks& masks)
+      {
+         masks = {};
+         for (int i = 0; i < 64; i += 32)
+         {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+            masks.quote |= classify_32(v, '"') << i;
+            masks.backslash |= classify_32(v, '\\') << i;
+            masks.whitespace |= (classify_32(v, ' ') | classify_32(v, '\t') |
+                                 classify_32(v, '\n') | classify_32(v, '\r'))
+                                << i;
+         }
+      }
+
+      __attribute__((target("avx2"))) inline const char* find_string_special_avx2(
+          const char* begin,
+          const char* end)
+      {
+         for (; end - begin >= 32; begin += 32)
+         {
+            __m256i v = _mm256_loadu_si256((const __m256i*)begin);
+            uint32_t m = _mm256_movemask_epi8(
+                _mm256_or_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), v),
+                                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))));
+            if (m)
+               return begin + __builtin_ctz(m);
+         }
+         return find_string_special_sse2(begin, end);
+      }
+
+      inline constexpr json_scan_backend avx2 = {"avx2", classify_avx2, find_string_special_avx2};
+
+      inline const json_scan_backend& select_backend()
+      {
+         __builtin_cpu_init();
+         if (__builtin_cpu_supports("avx2"))
+            return avx2;
+         return sse2;
+      }
+#else
+      inline const json_scan_backend& select_backend() { return scalar; }
+#endif
+
+      // The best backend this cpu supports. x86-64 picks AVX2 or SSE2 at runtime. wasm can't
+      // detect features at runtime, so it uses simd128 only in modules built with -msimd128.
+      inline const json_scan_backend& default_backend()
+      {
+         static const json_scan_backend& backend = select_backend();
+         return backend;
+      }
+
+      // Bit i is the xor of bits 0 through i
+      inline uint64_t prefix_xor(uint64_t x)
+      {
+         x ^= x << 1;
+         x ^= x << 2;
+         x ^= x << 4;
+         x ^= x << 8;
+         x ^= x << 16;
+         x ^= x << 32;
+         return x;
+      }
+   }  // namespace json_scan
+
+   // Finds the significant characters in json: the unescaped quotes, and everything outside
+   // strings which isn't whitespace. Blocks are scanned on demand, carrying string and escape
+   // state from one block to the next. This is only the structure; json_scan_token_stream
+   // validates the tokens.
+   class json_scanner
+   {
+     public:
+      json_scanner(const char* begin,
+                   const char* end,
+                   const json_scan_backend& backend = json_scan::default_backend())
+          : backend{backend}, block{begin}, end{end}
+      {
+         if (block != end)
+            scan_block();
+      }
+
+      // The first significant character at or after pos, or end if there are none. pos must not
+      // decrease from one call to the next.
+      const char* next(const char* pos)
+      {
+         while (true)
+         {
+            // There's nothing significant between pos and a block which was scanned past it
+            if (pos < block)
+               pos = block;
+            if (pos - block < 64)
+            {
+               uint64_t m = significant & (~uint64_t(0) << (pos - block));
+               if (m)
+                  return block + __builtin_ctzll(m);
+            }
+            if (end - block <= 64)
+               return end;
+            block += 64;
+            scan_block();
+         }
+      }
+
+      const char* find_string_special(const char* begin, const char* end) const
+      {
+         return backend.find_string_special(begin, end);
+      }
+
+     private:
+      const json_scan_backend& backend;
+      const char* block;
+      const char* end;
+      uint64_t significant = 0;
+      uint64_t prev_in_string = 0;
+      uint64_t prev_escaped = 0;
+
+      void scan_block()
+      {
+         json_block_masks masks;
+         if (end - block >= 64)
+         {
+            backend.classify(block, masks);
+         }
+         else
+         {
+            char padded[64];
+            memset(padded, ' ', sizeof(padded));
+            memcpy(padded, block, end - block);
+            backend.classify(padded, masks);
+         }
+
+         // A backslash escapes the next character unless it is escaped itself. Runs of
+         // backslashes which start on an odd bit flip the escaped parity of the run.
+         constexpr uint64_t even_bits = 0x5555'5555'5555'5555;
+         uint64_t backslash = masks.backslash & ~prev_escaped;
+         uint64_t follows_escape = backslash << 1 | prev_escaped;
+         uint64_t odd_starts = backslash & ~even_bits & ~follows_escape;
+         uint64_t even_starts;
+         prev_escaped = __builtin_add_overflow(odd_starts, backslash, &even_starts);
+         uint64_t escaped = (even_bits ^ (even_starts << 1)) & follows_escape;
+
+         // in_string covers each opening quote and the characters up to its closing quote
+         uint64_t quote = masks.quote & ~escaped;
+         uint64_t in_string = json_scan::prefix_xor(quote) ^ prev_in_string;
+         prev_in_string = uint64_t(int64_t(in_string) >> 63);
+         significant = (~masks.whitespace & ~in_string) | quote;
+      }
+   };
+}  // namespace eosio
@@ -0,0 +1,642 @@
+#include <eosio/abi_program.hpp>
+#include "abieos.hpp"
+
+#include <cstring>
+
+using namespace eosio;
+
+enum class eosio::abi_program::op : uint8_t
+{
+   end,
+   call,  // a: target
+   ret,
+
+   // Starts a run of fixed-size values. bin_to_json consumes all a bytes of the run up front;
+   // the values which follow read at their offset (a) within it.
+   fixed_run,
+   boolean,
+   int8,
+   uint8,
+   int16,
+   uint16,
+   int32,
+   uint32,
+   int64,
+   uint64,
+   name,
+   fixed_builtin,  // size: bytes, b: types index
+
+   string,
+   builtin,  // b: types index
+
+   struct_begin,
+   field,  // a, size: key literal. c: unquoted key size. b: next field or struct_end
+   struct_end,
+   optional,     // b: end of the optional
+   array_begin,  // b: end of the array
+   array_next,   // b: first instruction of the element
+   variant,      // a: first case, size: number of cases
+   variant_end,
+};
+
+using op = abi_program::op;
+
+namespace
+{
+   inline constexpr uint32_t no_run = ~uint32_t(0);
+
+   // A binary extension field, which may be missing when the data ends
+   inline constexpr uint8_t field_extension = 1;
+
+   struct fixed_builtin_def
+   {
+      std::string_view name;
+      op code;
+      uint32_t size;
+   };
+
+   constexpr fixed_builtin_def fixed_builtins[] = {
+       {"bool", op::boolean, 1},
+       {"int8", op::int8, 1},
+       {"uint8", op::uint8, 1},
+       {"int16", op::int16, 2},
+       {"uint16", op::uint16, 2},
+       {"int32", op::int32, 4},
+       {"uint32", op::uint32, 4},
+       {"int64", op::int64, 8},
+       {"uint64", op::uint64, 8},
+       {"int128", op::fixed_builtin, 16},
+       {"uint128", op::fixed_builtin, 16},
+       {"float32", op::fixed_builtin, 4},
+       {"float64", op::fixed_builtin, 8},
+       {"float128", op::fixed_builtin, 16},
+       {"time_point", op::fixed_builtin, 8},
+       {"time_point_sec", op::fixed_builtin, 4},
+       {"block_timestamp_type", op::fixed_builtin, 4},
+       {"name", op::name, 8},
+       {"checksum160", op::fixed_builtin, 20},
+       {"checksum256", op::fixed_builtin, 32},
+       {"checksum512", op::fixed_builtin, 64},
+       {"symbol", op::fixed_builtin, 8},
+       {"symbol_code", op::fixed_builtin, 8},
+       {"asset", op::fixed_builtin, 16},
+   };
+
+   template <typename T>
+   T read(const char* p)
+   {
+      T result;
+      memcpy(&result, p, sizeof(result));
+      return result;
+   }
+
+   template <typename T>
+   void json_to_bin_value(abieos::json_to_bin_state& state)
+   {
+      T x;
+      from_json(x, state);
+      to_bin(x, state.writer);
+   }
+
+   struct frame
+   {
+      uint32_t value;  // return address, or items in the array
+      uint32_t size_insertion = 0;
+   };
+
+   void push_frame(std::vector<frame>& frames, frame f)
+   {
+      eosio::check(frames.size() < abieos::max_stack_size,
+                   eosio::convert_abi_error(eosio::abi_error::recursion_limit_reached));
+      frames.push_back(f);
+   }
+}  // namespace
+
+struct abi_program::compiler
+{
+   // Structs larger than this, in instructions, become subroutines instead of being inlined
+   static constexpr size_t inline_limit = 48;
+
+   abi_program& p;
+   uint32_t run = no_run;
+   std::vector<const abi_type*> inlining;
+   std::map<std::pair<const abi_type*, bool>, uint32_t> subroutine_ids;
+   std::vector<std::pair<const abi_type*, bool>> subroutines;
+   std::map<const abi_type*, uint32_t> type_indexes;
+
+   uint32_t pc() const { return p.code.size(); }
+
+   uint32_t emit(op code, uint8_t flags = 0, uint16_t size = 0, uint32_t a = 0, uint32_t b = 0)
+   {
+      p.code.push_back({code, flags, size, a, b, 0});
+      return p.code.size() - 1;
+   }
+
+   uint32_t type_index(const abi_type* type)
+   {
+      auto [it, inserted] = type_indexes.try_emplace(type, p.types.size());
+      if (inserted)
+         p.types.push_back(type);
+      return it->second;
+   }
+
+   uint32_t subroutine(const abi_type* type, bool allow_extensions)
+   {
+      auto [it, inserted] =
+          subroutine_ids.try_emplace({type, allow_extensions}, subroutines.size());
+      if (inserted)
+         subroutines.push_back({type, allow_extensions});
+      return it->second;
+   }
+
+   uint32_t add_literal(std::string_view s)
+   {
+      auto result = p.literals.size();
+      p.literals.append(s);
+      return result;
+   }
+
+   // Instruction count if type were inlined, up to budget + 1
+   static size_t estimate(const abi_type* type, size_t budget)
+   {
+      if (auto* t = type->optional_of())
+         return 1 + estimate(t, budget);
+      if (auto* t = type->extension_of())
+         return estimate(t, budget);
+      if (auto* t = type->array_of())
+         return 2 + estimate(t, budget);
+      if (auto* s = type->as_struct())
+      {
+         size_t result = 2;
+         for (auto& field : s->fields)
+         {
+            if (result > budget)
+               break;
+            result += 1 + estimate(field.type, budget - result);
+         }
+         return result;
+      }
+      return 2;
+   }
+
+   void compile_value(const abi_type* type, bool allow_extensions)
+   {
+      if (auto* t = type->optional_of())
+      {
+         run = no_run;
+         auto i = emit(op::optional);
+         compile_value(t, allow_extensions);
+         run = no_run;
+         p.code[i].b = pc();
+      }
+      else if (auto* t = type->extension_of())
+      {
+         compile_value(t, allow_extensions);
+      }
+      else if (auto* t = type->array_of())
+      {
+         run = no_run;
+         auto i = emit(op::array_begin);
+         auto body = pc();
+         compile_value(t, false);
+         run = no_run;
+         emit(op::array_next, 0, 0, 0, body);
+         p.code[i].b = pc();
+      }
+      else if (type->as_struct())
+      {
+         if (std::find(inlining.begin(), inlining.end(), type) != inlining.end() ||
+             estimate(type, inline_limit) > inline_limit)
+         {
+            run = no_run;
+            emit(op::call, 0, 0, subroutine(type, allow_extensions));
+         }
+         else
+            compile_struct(type, allow_extensions);
+      }
+      else if (auto* v = type->as_variant())
+      {
+         eosio::check(v->size() <= 0xffff, eosio::convert_abi_error(eosio::abi_error::bad_abi));
+         run = no_run;
+         emit(op::variant, 0, v->size(), p.cases.size());
+         for (auto& alt : *v)
+         {
+            std::string literal = "[";
+            eosio::string_stream stream{literal};
+            to_json(alt.name, stream);
+            literal += ',';
+            auto offset = add_literal(literal);
+            add_literal(alt.name);
+            p.cases.push_back({offset, uint32_t(literal.size()), uint32_t(alt.name.size()),
+                               subroutine(alt.type, allow_extensions)});
+         }
+         emit(op::variant_end);
+      }
+      else
+      {
+         eosio::check(std::holds_alternative<abi_type::builtin>(type->_data),
+                      eosio::convert_abi_error(eosio::abi_error::bad_abi));
+         compile_builtin(type);
+      }
+   }
+
+   void compile_builtin(const abi_type* type)
+   {
+      for (auto& def : fixed_builtins)
+      {
+         if (def.name != type->name)
+            continue;
+         if (run == no_run)
+            run = emit(op::fixed_run);
+         auto offset = p.code[run].a;
+         p.code[run].a += def.size;
+         emit(def.code, 0, def.size, offset, type_index(type));
+         return;
+      }
+      run = no_run;
+      if (type->name == "string")
+         emit(op::string);
+      else
+         emit(op::builtin, 0, 0, 0, type_index(type));
+   }
+
+   void compile_struct(const abi_type* type, bool allow_extensions)
+   {
+      auto& fields = type->as_struct()->fields;
+      inlining.push_back(type);
+      emit(op::struct_begin);
+      uint32_t prev = no_run;
+      for (auto& field : fields)
+      {
+         bool extension = field.type->extension_of() && allow_extensions;
+         if (extension)
+            run = no_run;
+         std::string literal = &field == &fields.front() ? "" : ",";
+         eosio::string_stream stream{literal};
+         to_json(field.name, stream);
+         literal += ':';
+         eosio::check(literal.size() <= 0xffff,
+                      eosio::convert_abi_error(eosio::abi_error::bad_abi));
+         auto i = emit(op::field, extension ? field_extension : 0, literal.size(),
+                       add_literal(literal));
+         p.code[i].c = field.name.size();
+         add_literal(field.name);
+         if (prev != no_run)
+            p.code[prev].b = i;
+         prev = i;
+         compile_value(field.type, allow_extensions && &field == &fields.back());
+         if (extension)
+            run = no_run;
+      }
+      auto end = emit(op::struct_end);
+      if (prev != no_run)
+         p.code[prev].b = end;
+      inlining.pop_back();
+   }
+};
+
+abi_program::abi_program(const abi_type* type)
+{
+   compiler c{*this};
+   c.compile_value(type, true);
+   c.emit(op::end);
+
+   std::vector<uint32_t> subroutine_pcs;
+   for (size_t i = 0; i < c.subroutines.size(); ++i)
+   {
+      auto [t, allow_extensions] = c.subroutines[i];
+      c.run = no_run;
+      subroutine_pcs.push_back(c.pc());
+      if (t->as_struct())
+         c.compile_struct(t, allow_extensions);
+      else
+         c.compile_value(t, allow_extensions);
+      c.emit(op::ret);
+   }
+   for (auto& i : code)
+      if (i.code == op::call)
+         i.a = subroutine_pcs[i.a];
+   for (auto& v : cases)
+      v.pc = subroutine_pcs[v.pc];
+}
+
+void abi_program::bin_to_json(input_stream& bin, std::vector<char>& dest) const
+{
+   vector_stream writer{dest};
+   abieos::bin_to_json_state state{bin, writer};
+   std::vector<frame> frames;
+   const char* run = nullptr;
+   for (uint32_t pc = 0;;)
+   {
+      auto& i = code[pc++];
+      switch (i.code)
+      {
+         case op::end:
+            return;
+         case op::call:
+            push_frame(frames, {pc});
+            pc = i.a;
+            break;
+         case op::ret:
+            pc = frames.back().value;
+            frames.pop_back();
+            break;
+
+         case op::fixed_run:
+            eosio::check(i.a <= bin.remaining(),
+                         eosio::convert_stream_error(eosio::stream_error::overrun));
+            run = bin.pos;
+            bin.pos += i.a;
+            break;
+         case op::boolean:
+            to_json(run[i.a] != 0, writer);
+            break;
+         case op::int8:
+            to_json(read<int8_t>(run + i.a), writer);
+            break;
+         case op::uint8:
+            to_json(read<uint8_t>(run + i.a), writer);
+            break;
+         case op::int16:
+            to_json(read<int16_t>(run + i.a), writer);
+            break;
+         case op::uint16:
+            to_json(read<uint16_t>(run + i.a), writer);
+            break;
+         case op::int32:
+            to_json(read<int32_t>(run + i.a), writer);
+            break;
+         case op::uint32:
+            to_json(read<uint32_t>(run + i.a), writer);
+            break;
+         case op::int64:
+            to_json(read<int64_t>(run + i.a), writer);
+            break;
+         case op::uint64:
+            to_json(read<uint64_t>(run + i.a), writer);
+            break;
+         case op::name:
+            to_json(eosio::name{read<uint64_t>(run + i.a)}, writer);
+            break;
+         case op::fixed_builtin:
+         {
+            input_stream value{run + i.a, i.size};
+            abieos::bin_to_json_state value_state{value, writer};
+            types[i.b]->ser->bin_to_json(value_state, false, types[i.b], true);
+            break;
+         }
+
+         case op::string:
+         {
+            uint32_t size;
+            varuint32_from_bin(size, bin);
+            const char* data;
+            bin.read_reuse_storage(data, size);
+            to_json(std::string_view{data, size}, writer);
+            break;
+         }
+         case op::builtin:
+            types[i.b]->ser->bin_to_json(state, false, types[i.b], true);
+            break;
+
+         case op::struct_begin:
+            writer.write('{');
+            break;
+         case op::field:
+            if ((i.flags & field_extension) && bin.pos == bin.end)
+            {
+               pc = i.b;
+               break;
+            }
+            writer.write(literals.data() + i.a, i.size);
+            break;
+         case op::struct_end:
+            writer.write('}');
+            break;
+         case op::optional:
+         {
+            uint8_t present;
+            from_bin(present, bin);
+            if (!present)
+            {
+               writer.write("null", 4);
+               pc = i.b;
+            }
+            break;
+         }
+         case op::array_begin:
+         {
+            uint32_t size;
+            varuint32_from_bin(size, bin);
+            writer.write('[');
+            if (size)
+               push_frame(frames, {size});
+            else
+            {
+               writer.write(']');
+               pc = i.b;
+            }
+            break;
+         }
+         case op::array_next:
+            if (--frames.back().value)
+            {
+               writer.write(',');
+               pc = i.b;
+            }
+            else
+            {
+               frames.pop_back();
+               writer.write(']');
+            }
+            break;
+         case op::variant:
+         {
+            uint32_t index;
+            varuint32_from_bin(index, bin);
+            eosio::check(index < i.size,
+                         eosio::convert_stream_error(eosio::stream_error::bad_variant_index));
+            auto& v = cases[i.a + index];
+            writer.write(literals.data() + v.literal, v.literal_size);
+            push_frame(frames, {pc});
+            pc = v.pc;
+            break;
+         }
+         case op::variant_end:
+            writer.write(']');
+            break;
+      }
+   }
+}
+
+std::string abi_program::bin_to_json(input_stream& bin) const
+{
+   std::vector<char> result;
+   bin_to_json(bin, result);
+   return {result.data(), result.size()};
+}
+
+std::vector<char> abi_program::json_to_bin(std::string_view json) const
+{
+   std::string mutable_json{json};
+   mutable_json.push_back(0);
+   mutable_json.push_back(0);
+   mutable_json.push_back(0);
+   std::vector<char> out_buf;
+   vector_stream out{out_buf};
+   abieos::json_to_bin_state state(mutable_json.data(), out);
+   std::vector<frame> frames;
+   for (uint32_t pc = 0; code[pc].code != op::end;)
+   {
+      auto& i = code[pc++];
+      switch (i.code)
+      {
+         case op::end:
+            break;
+         case op::call:
+            push_frame(frames, {pc});
+            pc = i.a;
+            break;
+         case op::ret:
+            pc = frames.back().value;
+            frames.pop_back();
+            break;
+
+         case op::fixed_run:
+            break;
+         case op::boolean:
+            json_to_bin_value<bool>(state);
+            break;
+         case op::int8:
+            json_to_bin_value<int8_t>(state);
+            break;
+         case op::uint8:
+            json_to_bin_value<uint8_t>(state);
+            break;
+         case op::int16:
+            json_to_bin_value<int16_t>(state);
+            break;
+         case op::uint16:
+            json_to_bin_value<uint16_t>(state);
+            break;
+         case op::int32:
+            json_to_bin_value<int32_t>(state);
+            break;
+         case op::uint32:
+            json_to_bin_value<uint32_t>(state);
+            break;
+         case op::int64:
+            json_to_bin_value<int64_t>(state);
+            break;
+         case op::uint64:
+            json_to_bin_value<uint64_t>(state);
+            break;
+         case op::name:
+            json_to_bin_value<eosio::name>(state);
+            break;
+         case op::string:
+            to_bin(state.get_string(), out);
+            break;
+         case op::fixed_builtin:
+         case op::builtin:
+            types[i.b]->ser->json_to_bin(state, false, types[i.b], true);
+            break;
+
+         case op::struct_begin:
+            state.get_start_object();
+            break;
+         case op::field:
+         {
+            if (state.get_end_object_pred())
+            {
+               eosio::check(i.flags & field_extension,
+                            eosio::convert_json_error(eosio::from_json_error::expected_field));
+               state.skipped_extension = true;
+               pc = i.b;
+               while (code[pc].code != op::struct_end)
+                  pc = code[pc].b;
+               ++pc;
+               break;
+            }
+            auto key = state.get_key();
+            eosio::check(!state.skipped_extension,
+                         eosio::convert_json_error(eosio::from_json_error::unexpected_field));
+            eosio::check(key == std::string_view{literals.data() + i.a + i.size, i.c},
+                         eosio::convert_json_error(eosio::from_json_error::expected_field));
+            break;
+         }
+         case op::struct_end:
+            eosio::check(state.get_end_object_pred(),
+                         eosio::convert_json_error(eosio::from_json_error::unexpected_field));
+            break;
+         case op::optional:
+            if (state.get_null_pred())
+            {
+               out.write(char(0));
+               pc = i.b;
+            }
+            else
+               out.write(char(1));
+            break;
+         case op::array_begin:
+            state.get_start_array();
+            if (state.get_end_array_pred())
+            {
+               state.size_insertions.push_back({out_buf.size(), 0});
+               pc = i.b;
+            }
+            else
+            {
+               push_frame(frames, {0, uint32_t(state.size_insertions.size())});
+               state.size_insertions.push_back({out_buf.size()});
+            }
+            break;
+         case op::array_next:
+            ++frames.back().value;
+            if (state.get_end_array_pred())
+            {
+               state.size_insertions[frames.back().size_insertion].size = frames.back().value;
+               frames.pop_back();
+            }
+            else
+               pc = i.b;
+            break;
+         case op::variant:
+         {
+            state.get_start_array();
+            auto name = state.get_string();
+            uint32_t index = 0;
+            while (index < i.size)
+            {
+               auto& v = cases[i.a + index];
+               if (name == std::string_view{literals.data() + v.literal + v.literal_size,
+                                            v.name_size})
+                  break;
+               ++index;
+            }
+            eosio::check(index < i.size, eosio::convert_json_error(
+                                             eosio::from_json_error::invalid_type_for_variant));
+            varuint32_to_bin(index, out);
+            push_frame(frames, {pc});
+            pc = cases[i.a + index].pc;
+            break;
+         }
+         case op::variant_end:
+            eosio::check(state.get_end_array_pred(),
+                         eosio::convert_json_error(eosio::from_json_error::expected_variant));
+            break;
+      }
+   }
+   eosio::check(state.complete(), eosio::convert_json_error(eosio::from_json_error::expected_end));
+
+   std::vector<char> bin;
+   size_t pos = 0;
+   for (auto& insertion : state.size_insertions)
+   {
+      bin.insert(bin.end(), out_buf.begin() + pos, out_buf.begin() + insertion.position);
+      eosio::push_varuint32(bin, insertion.size);
+      pos = insertion.position;
+   }
+   bin.insert(bin.end(), out_buf.begin() + pos, out_buf.end());
+   return bin;
+}
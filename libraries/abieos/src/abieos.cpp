@@ -2,14 +2,106 @@
 
 #include "eosio/abieos.h"
 #include "abieos.hpp"
+#include "eosio/abi_program.hpp"
 #include "eosio/hex.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
 
 inline const bool catch_all = true;
 
 using namespace abieos;
 
+// Threads which help the context's owner run abieos_bin_to_json_batch. They're started by the
+// first batch that wants them and wait for later batches until the context is destroyed.
+class batch_workers
+{
+  public:
+   ~batch_workers()
+   {
+      {
+         std::lock_guard lock{mutex};
+         stopping = true;
+      }
+      start_cv.notify_all();
+      for (auto& t : threads)
+         t.join();
+   }
+
+   // Runs work on the calling thread and on up to num_helpers workers. work must not throw, and
+   // must return promptly once there is nothing left for it to claim; helpers which wake after
+   // the calling thread is done don't run it.
+   void run(size_t num_helpers, const std::function<void()>& work)
+   {
+      while (threads.size() < num_helpers)
+      {
+         try
+         {
+            threads.emplace_back([this] { worker(); });
+         }
+         catch (std::system_error&)
+         {
+            // Continue with the threads which did start
+            break;
+         }
+      }
+      {
+         std::lock_guard lock{mutex};
+         job = &work;
+         unclaimed = std::min(num_helpers, threads.size());
+         ++generation;
+      }
+      start_cv.notify_all();
+      work();
+      std::unique_lock lock{mutex};
+      unclaimed = 0;
+      done_cv.wait(lock, [&] { return !running; });
+      job = nullptr;
+   }
+
+  private:
+   void worker()
+   {
+      uint64_t last_generation = 0;
+      std::unique_lock lock{mutex};
+      while (true)
+      {
+         start_cv.wait(lock, [&] {
+            return stopping || (generation != last_generation && unclaimed);
+         });
+         if (stopping)
+            return;
+         last_generation = generation;
+         --unclaimed;
+         ++running;
+         auto& work = *job;
+         lock.unlock();
+         work();
+         lock.lock();
+         if (!--running)
+            done_cv.notify_one();
+      }
+   }
+
+   std::vector<std::thread> threads;
+   std::mutex mutex;
+   std::condition_variable start_cv;
+   std::condition_variable done_cv;
+   const std::function<void()>* job = nullptr;
+   uint64_t generation = 0;
+   size_t unclaimed = 0;
+   size_t running = 0;
+   bool stopping = false;
+};
+
 struct abieos_context_s
 {
    const char* last_error = "";
@@ -18,6 +110,8 @@ struct abieos_context_s
    std::vector<char> result_bin{};
 
    std::map<name, abi> contracts{};
+
+   std::unique_ptr<batch_workers> workers{};
 };
 
 static void fix_null_str(const char*& s)
@@ -122,20 +216,45 @@ extern "C" const char* abieos_name_to_string(abieos_context* context, uint64_t n
    });
 }
 
+static bool parse_abi(abieos_context* context, const char* abi, abieos::abi& c)
+{
+   context->last_error = "abi parse error";
+   abi_def def{};
+   std::string error;
+   std::string abi_copy{abi};
+   eosio::json_token_stream stream(abi_copy.data());
+   from_json(def, stream);
+   if (!eosio::check_abi_version(def.version, error))
+      return set_error(context, std::move(error));
+   convert(def, c);
+   return true;
+}
+
+static bool parse_abi_bin(abieos_context* context, const char* data, size_t size, abieos::abi& c)
+{
+   context->last_error = "abi parse error";
+   if (!data || !size)
+      return set_error(context, "no data");
+   std::string error;
+   eosio::input_stream stream{data, size};
+   std::string version;
+   from_bin(version, stream);
+   if (!eosio::check_abi_version(version, error))
+      return set_error(context, std::move(error));
+   abi_def def{};
+   stream = {data, size};
+   from_bin(def, stream);
+   convert(def, c);
+   return true;
+}
+
 extern "C" abieos_bool abieos_set_abi(abieos_context* context, uint64_t contract, const char* abi)
 {
    fix_null_str(abi);
    return handle_exceptions(context, false, [&]() {
-      context->last_error = "abi parse error";
-      abi_def def{};
-      std::string error;
-      std::string abi_copy{abi};
-      eosio::json_token_stream stream(abi_copy.data());
-      from_json(def, stream);
-      if (!eosio::check_abi_version(def.version, error))
-         return set_error(context, std::move(error));
       abieos::abi c;
-      convert(def, c);
+      if (!parse_abi(context, abi, c))
+         return false;
       context->contracts.insert({name{contract}, std::move(c)});
       return true;
    });
@@ -147,20 +266,9 @@ extern "C" abieos_bool abieos_set_abi_bin(abieos_context* context,
                                           size_t size)
 {
    return handle_exceptions(context, false, [&] {
-      context->last_error = "abi parse error";
-      if (!data || !size)
-         return set_error(context, "no data");
-      std::string error;
-      eosio::input_stream stream{data, size};
-      std::string version;
-      from_bin(version, stream);
-      if (!eosio::check_abi_version(version, error))
-         return set_error(context, std::move(error));
-      abi_def def{};
-      stream = {data, size};
-      from_bin(def, stream);
       abieos::abi c;
-      convert(def, c);
+      if (!parse_abi_bin(context, data, size, c))
+         return false;
       context->contracts.insert({name{contract}, std::move(c)});
       return true;
    });
@@ -312,3 +420,225 @@ extern "C" const char* abieos_hex_to_json(abieos_context* context,
       return abieos_bin_to_json(context, contract, type, data.data(), data.size());
    });
 }
+
+struct abieos_abi_s
+{
+   // get_type adds optional, array, and extension types on first use; existing types are only
+   // read once the abi is converted
+   mutable abi types;
+   mutable std::map<const abi_type*, std::unique_ptr<eosio::abi_program>> programs;
+   mutable std::shared_mutex mutex;
+
+   const abi_type* get_type(const std::string& name) const
+   {
+      {
+         std::shared_lock lock{mutex};
+         if (types.abi_types.count(name))
+            return types.get_type(name);
+      }
+      std::unique_lock lock{mutex};
+      return types.get_type(name);
+   }
+
+   // Compiled on first use
+   const eosio::abi_program* get_program(const abi_type* type) const
+   {
+      {
+         std::shared_lock lock{mutex};
+         auto it = programs.find(type);
+         if (it != programs.end())
+            return it->second.get();
+      }
+      std::unique_lock lock{mutex};
+      auto& program = programs[type];
+      if (!program)
+         program = std::make_unique<eosio::abi_program>(type);
+      return program.get();
+   }
+};
+
+extern "C" abieos_abi* abieos_compile_abi(abieos_context* context, const char* abi)
+{
+   fix_null_str(abi);
+   return handle_exceptions(context, nullptr, [&]() -> abieos_abi* {
+      auto result = std::make_unique<abieos_abi>();
+      if (!parse_abi(context, abi, result->types))
+         return nullptr;
+      return result.release();
+   });
+}
+
+extern "C" abieos_abi* abieos_compile_abi_bin(abieos_context* context,
+                                              const char* data,
+                                              size_t size)
+{
+   return handle_exceptions(context, nullptr, [&]() -> abieos_abi* {
+      auto result = std::make_unique<abieos_abi>();
+      if (!parse_abi_bin(context, data, size, result->types))
+         return nullptr;
+      return result.release();
+   });
+}
+
+extern "C" void abieos_destroy_abi(abieos_abi* abi)
+{
+   delete abi;
+}
+
+extern "C" abieos_bool abieos_abi_json_to_bin(abieos_context* context,
+                                              const abieos_abi* abi,
+                                              const char* type,
+                                              const char* json)
+{
+   fix_null_str(type);
+   fix_null_str(json);
+   return handle_exceptions(context, false, [&] {
+      context->last_error = "json parse error";
+      if (!abi)
+         return set_error(context, "abi is null");
+      context->result_bin.clear();
+      context->result_bin = abi->get_program(abi->get_type(type))->json_to_bin(json);
+      return true;
+   });
+}
+
+// Items are converted in chunks, claimed in order. Each chunk's json goes to its own buffer, which
+// is copied into the arena once the chunks before it are done.
+inline constexpr size_t batch_chunk_size = 64;
+
+static void convert_chunk(const abieos_abi* abi,
+                          abieos_bin_to_json_item* items,
+                          size_t count,
+                          std::vector<char>& out)
+{
+   std::string type_name;
+   const eosio::abi_program* program = nullptr;
+   for (size_t i = 0; i < count; ++i)
+   {
+      auto& item = items[i];
+      auto begin = out.size();
+      try
+      {
+         fix_null_str(item.type);
+         if (!program || type_name != item.type)
+         {
+            program = nullptr;
+            type_name = item.type;
+            program = abi->get_program(abi->get_type(type_name));
+         }
+         eosio::input_stream bin{item.data, item.data ? item.size : 0};
+         program->bin_to_json(bin, out);
+         if (bin.pos != bin.end)
+            throw std::runtime_error("Extra data");
+         item.ok = true;
+      }
+      catch (std::exception& e)
+      {
+         out.resize(begin);
+         out.insert(out.end(), e.what(), e.what() + strlen(e.what()));
+         item.ok = false;
+      }
+      item.json_offset = begin;
+      item.json_size = out.size() - begin;
+      out.push_back(0);
+   }
+}
+
+extern "C" abieos_bool abieos_bin_to_json_batch(abieos_context* context,
+                                                const abieos_abi* abi,
+                                                abieos_bin_to_json_item* items,
+                                                size_t count,
+                                                char* arena,
+                                                size_t arena_size,
+                                                size_t* arena_used,
+                                                size_t* num_converted,
+                                                uint32_t num_threads)
+{
+   return handle_exceptions(context, false, [&] {
+      if (arena_used)
+         *arena_used = 0;
+      if (num_converted)
+         *num_converted = 0;
+      if (!abi)
+         return set_error(context, "abi is null");
+      if (count && !items)
+         return set_error(context, "items is null");
+      if (!arena)
+         arena_size = 0;
+      size_t num_chunks = (count + batch_chunk_size - 1) / batch_chunk_size;
+      std::vector<std::vector<char>> chunks(num_chunks);
+      std::atomic<size_t> next_chunk{0};
+      // Chunks are claimed in order, so once the finished ones overflow the arena, no later chunk
+      // can fit. The first chunk is always converted, to report the size the first item needs.
+      std::atomic<size_t> bytes_converted{0};
+      std::mutex error_mutex;
+      std::exception_ptr error;
+      std::function<void()> work = [&] {
+         try
+         {
+            for (size_t i; (i = next_chunk++) < num_chunks;)
+            {
+               if (i && bytes_converted > arena_size)
+                  break;
+               auto begin = i * batch_chunk_size;
+               convert_chunk(abi, items + begin,
+                             std::min(batch_chunk_size, count - begin), chunks[i]);
+               bytes_converted += chunks[i].size();
+            }
+         }
+         catch (...)
+         {
+            std::lock_guard lock{error_mutex};
+            if (!error)
+               error = std::current_exception();
+            next_chunk = num_chunks;
+         }
+      };
+
+      if (!num_threads)
+         num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+      auto batch_threads = std::min<size_t>(num_threads, num_chunks);
+      if (batch_threads > 1)
+      {
+         if (!context->workers)
+            context->workers = std::make_unique<batch_workers>();
+         context->workers->run(batch_threads - 1, work);
+      }
+      else
+         work();
+      if (error)
+         std::rethrow_exception(error);
+
+      // Copy whole chunks while they fit, then as many items of the next chunk as fit
+      size_t pos = 0;
+      size_t converted = 0;
+      for (size_t i = 0; i < num_chunks && converted == i * batch_chunk_size; ++i)
+      {
+         auto begin = i * batch_chunk_size;
+         auto end = std::min(begin + batch_chunk_size, count);
+         size_t size = 0;
+         for (auto j = begin; j < end; ++j, ++converted)
+         {
+            auto item_end = items[j].json_offset + items[j].json_size + 1;
+            if (chunks[i].empty() || pos + item_end > arena_size)
+               break;
+            size = item_end;
+            items[j].json_offset += pos;
+         }
+         if (size)
+            memcpy(arena + pos, chunks[i].data(), size);
+         pos += size;
+      }
+      if (arena_used)
+         *arena_used = pos;
+      if (num_converted)
+         *num_converted = converted;
+      if (count && !converted)
+      {
+         if (arena_used)
+            *arena_used = items[0].json_size + 1;
+         return set_error(context, "arena is too small");
+      }
+      return true;
+   });
+}
@@ -268,7 +268,7 @@ namespace abieos
 
    struct json_to_bin_state : eosio::json_token_stream
    {
-      using json_token_stream::json_token_stream;
+      using eosio::json_token_stream::json_token_stream;
       eosio::vector_stream& writer;
       std::vector<size_insertion> size_insertions{};
       std::vector<json_to_bin_stack_entry> stack{};
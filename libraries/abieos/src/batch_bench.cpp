@@ -0,0 +1,124 @@
+// copyright defined in abieos/LICENSE.txt
+
+// Measures abieos_bin_to_json_batch throughput as the thread count grows. Results go through a
+// fixed-size arena, resuming after each call fills it.
+//
+// usage: abieos-batch-bench [count] [max_threads] [arena_kib]
+
+#include <eosio/abi.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/convert.hpp>
+#include <eosio/to_bin.hpp>
+#include "eosio/abieos.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct transfer
+{
+   eosio::name from;
+   eosio::name to;
+   eosio::asset quantity;
+   std::string memo;
+};
+EOSIO_REFLECT(transfer, from, to, quantity, memo)
+
+static eosio::abi_def make_abi()
+{
+   eosio::abi_def def;
+   def.version = "eosio::abi/1.1";
+   def.structs.push_back({"transfer",
+                          "",
+                          {{"from", "name"},
+                           {"to", "name"},
+                           {"quantity", "asset"},
+                           {"memo", "string"}}});
+   def.structs.push_back({"transfers", "", {{"transfers", "transfer[]"}}});
+   return def;
+}
+
+int main(int argc, const char** argv)
+{
+   size_t count = argc > 1 ? strtoull(argv[1], nullptr, 0) : 200000;
+   uint32_t max_threads = argc > 2 ? strtoul(argv[2], nullptr, 0) : 0;
+   size_t arena_kib = argc > 3 ? strtoull(argv[3], nullptr, 0) : 4096;
+   if (!max_threads)
+      max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+   auto context = abieos_create();
+   auto abi_bin = eosio::convert_to_bin(make_abi());
+   auto abi = abieos_compile_abi_bin(context, abi_bin.data(), abi_bin.size());
+   if (!abi)
+      throw std::runtime_error(abieos_get_error(context));
+
+   // Every 8th item is a list of transfers; the rest are single transfers
+   std::vector<std::vector<char>> bins;
+   std::vector<abieos_bin_to_json_item> items;
+   std::vector<transfer> group;
+   for (size_t i = 0; i < count; ++i)
+   {
+      transfer t{eosio::name{"alice"}, eosio::name{"bob"},
+                 eosio::asset{int64_t(i), eosio::symbol{"EOS", 4}},
+                 "memo " + std::to_string(i)};
+      if (i % 8 == 7)
+      {
+         group.assign(10, t);
+         bins.push_back(eosio::convert_to_bin(group));
+      }
+      else
+         bins.push_back(eosio::convert_to_bin(t));
+   }
+   for (size_t i = 0; i < count; ++i)
+      items.push_back({i % 8 == 7 ? "transfers" : "transfer", bins[i].data(), bins[i].size()});
+
+   std::vector<char> arena(arena_kib * 1024);
+   size_t json_size = 0;
+   size_t num_calls = 0;
+   auto convert_all = [&](uint32_t num_threads) {
+      json_size = 0;
+      num_calls = 0;
+      size_t arena_used = 0;
+      size_t num_converted = 0;
+      for (size_t begin = 0; begin < items.size(); begin += num_converted, ++num_calls)
+      {
+         if (!abieos_bin_to_json_batch(context, abi, items.data() + begin, items.size() - begin,
+                                       arena.data(), arena.size(), &arena_used, &num_converted,
+                                       num_threads))
+            throw std::runtime_error(abieos_get_error(context));
+         json_size += arena_used;
+      }
+   };
+   convert_all(1);
+   printf("%zu items, %zu bytes of json, %zu calls with a %zu KiB arena\n", count, json_size,
+          num_calls, arena_kib);
+
+   double base = 0;
+   for (uint32_t num_threads = 1;; num_threads *= 2)
+   {
+      if (num_threads > max_threads)
+         num_threads = max_threads;
+      double best = 0;
+      for (int i = 0; i < 3; ++i)
+      {
+         auto start = std::chrono::steady_clock::now();
+         convert_all(num_threads);
+         std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+         if (!best || elapsed.count() < best)
+            best = elapsed.count();
+      }
+      if (!base)
+         base = best;
+      printf("%3u threads: %8.3f ms  %10.0f items/s  %5.2fx\n", num_threads, best * 1000,
+             count / best, base / best);
+      if (num_threads == max_threads)
+         break;
+   }
+
+   abieos_destroy_abi(abi);
+   abieos_destroy(context);
+}
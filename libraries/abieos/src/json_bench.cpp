@@ -0,0 +1,115 @@
+// copyright defined in abieos/LICENSE.txt
+
+// Compares json_scan_token_stream's tokenizing speed against rapidjson_token_stream's, on
+// documents shaped like state-history action traces and on documents of long hex strings.
+//
+// usage: abieos-json-bench [records]
+
+#include <eosio/from_json.hpp>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+static std::string make_traces(size_t num_records)
+{
+   std::string json = "[";
+   for (size_t i = 0; i < num_records; ++i)
+   {
+      if (i)
+         json += ",\n";
+      json += R"({"action_ordinal":)" + std::to_string(i % 7 + 1) +
+              R"(,"receipt":["action_receipt_v0",{"receiver":"eosio.token","act_digest":)"
+              R"("8A2E4F3C7D6B5A1908172635445362718A2E4F3C7D6B5A190817263544536271",)"
+              R"("global_sequence":")" +
+              std::to_string(1000000000 + i) +
+              R"(","auth_sequence":[{"account":"alice","sequence":")" + std::to_string(i) +
+              R"("}]}],"act":{"account":"eosio.token","name":"transfer",)"
+              R"("authorization":[{"actor":"alice","permission":"active"}],)"
+              R"("data":{"from":"alice","to":"bob","quantity":"1.0000 EOS",)"
+              R"("memo":"payment \")" +
+              std::to_string(i) + R"(\" été"}},"context_free":false,"elapsed":)" +
+              std::to_string(20 + i % 13) + R"(,"console":"","except":null})";
+   }
+   json += "]";
+   return json;
+}
+
+static std::string make_hex(size_t num_records)
+{
+   std::string json = "[";
+   for (size_t i = 0; i < num_records; ++i)
+   {
+      if (i)
+         json += ",";
+      json += '"';
+      for (size_t j = 0; j < 512; ++j)
+         json += "0123456789ABCDEF"[(i + j * 7) % 16];
+      json += '"';
+   }
+   json += "]";
+   return json;
+}
+
+template <typename Stream>
+static size_t tokenize(std::string& copy, const std::string& json)
+{
+   copy = json;
+   Stream stream{copy.data()};
+   size_t num_tokens = 0;
+   while (!stream.complete())
+   {
+      stream.peek_token();
+      stream.eat_token();
+      ++num_tokens;
+   }
+   return num_tokens;
+}
+
+template <typename F>
+static double best_of(F f)
+{
+   double best = 0;
+   for (int i = 0; i < 5; ++i)
+   {
+      auto start = std::chrono::steady_clock::now();
+      f();
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      if (!best || elapsed.count() < best)
+         best = elapsed.count();
+   }
+   return best;
+}
+
+int main(int argc, const char** argv)
+{
+   size_t num_records = argc > 1 ? strtoull(argv[1], nullptr, 0) : 20000;
+
+   size_t sink = 0;
+   std::string copy;
+   auto run = [&](const char* name, const std::string& json) {
+      if (tokenize<eosio::rapidjson_token_stream>(copy, json) !=
+          tokenize<eosio::json_scan_token_stream>(copy, json))
+      {
+         printf("%s: token count mismatch\n", name);
+         sink = 0;
+         return;
+      }
+      // Includes the copy each stream needs since it tokenizes in place
+      auto rapidjson_time = best_of([&] {
+         sink += tokenize<eosio::rapidjson_token_stream>(copy, json);
+      });
+      auto stream_time = best_of([&] {
+         sink += tokenize<eosio::json_scan_token_stream>(copy, json);
+      });
+      printf("%-8s %10zu bytes  rapidjson: %8.3f ms %8.1f MB/s  json_scan_token_stream: %8.3f "
+             "ms %8.1f MB/s  %5.2fx\n",
+             name, json.size(), rapidjson_time * 1000, json.size() / rapidjson_time / 1e6,
+             stream_time * 1000, json.size() / stream_time / 1e6, rapidjson_time / stream_time);
+   };
+   run("traces", make_traces(num_records));
+   run("hex", make_hex(num_records / 4));
+
+   return sink == 0;
+}
@@ -0,0 +1,445 @@
+// copyright defined in abieos/LICENSE.txt
+
+// Checks json_scan_token_stream against rapidjson_token_stream, the default json_token_stream:
+// both must produce the same tokens and the same error on valid, malformed, generated and mutated
+// documents, and documents written back out from their tokens must read the same way again.
+
+#include <eosio/from_json.hpp>
+#include <eosio/to_json.hpp>
+
+#include <random>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+int error_count;
+
+// What a stream read from a document: one entry per token, then the error if there was one
+struct token_log
+{
+   std::vector<std::string> tokens;
+   std::string error;
+
+   bool operator==(const token_log&) const = default;
+};
+
+template <typename Stream>
+token_log read_tokens(std::string json)
+{
+   token_log result;
+   try
+   {
+      Stream stream{json.data()};
+      while (!stream.complete())
+      {
+         auto& t = stream.peek_token().get();
+         switch (t.type)
+         {
+            case eosio::json_token_type::type_null:
+               result.tokens.push_back("null");
+               break;
+            case eosio::json_token_type::type_bool:
+               result.tokens.push_back(t.value_bool ? "true" : "false");
+               break;
+            case eosio::json_token_type::type_string:
+               result.tokens.push_back("s:" + std::string{t.value_string});
+               break;
+            case eosio::json_token_type::type_key:
+               result.tokens.push_back("k:" + std::string{t.key});
+               break;
+            case eosio::json_token_type::type_start_object:
+               result.tokens.push_back("{");
+               break;
+            case eosio::json_token_type::type_end_object:
+               result.tokens.push_back("}");
+               break;
+            case eosio::json_token_type::type_start_array:
+               result.tokens.push_back("[");
+               break;
+            case eosio::json_token_type::type_end_array:
+               result.tokens.push_back("]");
+               break;
+            default:
+               result.tokens.push_back("?");
+               break;
+         }
+         stream.eat_token();
+      }
+   }
+   catch (std::exception& e)
+   {
+      result.error = e.what();
+   }
+   return result;
+}
+
+std::string printable(const std::string& s)
+{
+   std::string result;
+   for (unsigned char c : s)
+   {
+      if (c >= 0x20 && c < 0x7f)
+         result += c;
+      else
+      {
+         char buf[8];
+         snprintf(buf, sizeof(buf), "\\x%02x", c);
+         result += buf;
+      }
+   }
+   return result;
+}
+
+// Returns the tokens both streams read, or nullopt if they differ
+std::optional<token_log> check_parity(const std::string& json)
+{
+   auto expected = read_tokens<eosio::rapidjson_token_stream>(json);
+   auto actual = read_tokens<eosio::json_scan_token_stream>(json);
+   if (actual == expected)
+      return expected;
+   if (++error_count <= 20)
+   {
+      printf("mismatch on %s\n", printable(json).c_str());
+      for (auto* log : {&expected, &actual})
+      {
+         printf("  %s:", log == &expected ? "rapidjson" : "json_scan_token_stream");
+         for (auto& t : log->tokens)
+            printf(" %s", printable(t).c_str());
+         printf(" error: %s\n", log->error.c_str());
+      }
+   }
+   return std::nullopt;
+}
+
+// Writes tokens back out as json. Numbers were read as strings, so they come back as strings,
+// which read back to the same tokens.
+std::string write_tokens(const std::vector<std::string>& tokens, std::mt19937& rng)
+{
+   auto ws = [&] {
+      static const char chars[] = " \t\n\r";
+      return std::string(rng() % 3, chars[rng() % 4]);
+   };
+   std::string result;
+   bool need_comma = false;
+   for (auto& t : tokens)
+   {
+      bool closing = t == "}" || t == "]";
+      if (need_comma && !closing)
+         result += ",";
+      result += ws();
+      if (t.starts_with("s:"))
+         result += eosio::convert_to_json(t.substr(2));
+      else if (t.starts_with("k:"))
+         result += eosio::convert_to_json(t.substr(2)) + ws() + ":";
+      else
+         result += t;
+      result += ws();
+      need_comma = !t.starts_with("k:") && t != "{" && t != "[";
+   }
+   return result;
+}
+
+class generator
+{
+  public:
+   explicit generator(uint32_t seed) : rng{seed} {}
+
+   std::string document()
+   {
+      std::string result;
+      value(result, 0);
+      ws(result);
+      return result;
+   }
+
+   std::mt19937 rng;
+
+  private:
+   uint32_t random(uint32_t n) { return rng() % n; }
+
+   void ws(std::string& out)
+   {
+      static const char chars[] = " \t\n\r";
+      if (random(3) == 0)
+         out.append(random(4), chars[random(4)]);
+   }
+
+   void number(std::string& out)
+   {
+      static const char* const special[] = {
+          "0", "-0", "0.0", "-0.0e-0", "1e308", "1.7976931348623157e308", "1e309", "1e400",
+          "-1e400", "1e-400", "1e99999999999", "18446744073709551615", "18446744073709551616",
+          "-9223372036854775809", "123456789012345678901234567890.5e-10",
+          "0.00000000000000000000000000000000000000001"};
+      if (random(4) == 0)
+      {
+         out += special[random(std::size(special))];
+         return;
+      }
+      if (random(2))
+         out += '-';
+      auto digits = [&](uint32_t max) {
+         auto n = 1 + random(max);
+         for (uint32_t i = 0; i < n; ++i)
+            out += char('0' + random(10));
+      };
+      if (random(3))
+         out += char('1' + random(9));
+      else
+         out += '0';
+      if (random(2) && out.back() != '0')
+         digits(25);
+      if (random(3) == 0)
+      {
+         out += '.';
+         digits(20);
+      }
+      if (random(3) == 0)
+      {
+         out += "eE"[random(2)];
+         if (random(2))
+            out += "+-"[random(2)];
+         digits(4);
+      }
+   }
+
+   void string(std::string& out)
+   {
+      static const char* const pieces[] = {
+          "a",         "key",      " ",         "\\\"",     "\\\\",     "\\/",
+          "\\b",       "\\f",      "\\n",       "\\r",      "\\t",      "\\u0041",
+          "\\u00e9",   "\\u0000",  "\\u20AC",   "\\ud83d\\ude00",       "\xc3\xa9",
+          "\xe2\x82\xac",          "\xf0\x9f\x98\x80",      "\x7f",     "~",
+          "0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz"};
+      out += '"';
+      auto n = random(3) ? random(6) : random(40);
+      for (uint32_t i = 0; i < n; ++i)
+         out += pieces[random(std::size(pieces))];
+      out += '"';
+   }
+
+   void value(std::string& out, uint32_t depth)
+   {
+      ws(out);
+      auto kind = random(depth < 8 ? 9 : 6);
+      switch (kind)
+      {
+         case 0:
+            out += "null";
+            break;
+         case 1:
+            out += random(2) ? "true" : "false";
+            break;
+         case 2:
+         case 3:
+            number(out);
+            break;
+         case 4:
+         case 5:
+            string(out);
+            break;
+         case 6:
+         case 7:
+         {
+            out += '[';
+            auto n = random(6);
+            for (uint32_t i = 0; i < n; ++i)
+            {
+               if (i)
+                  out += ',';
+               value(out, depth + 1);
+            }
+            ws(out);
+            out += ']';
+            break;
+         }
+         default:
+         {
+            out += '{';
+            auto n = random(6);
+            for (uint32_t i = 0; i < n; ++i)
+            {
+               if (i)
+                  out += ',';
+               ws(out);
+               string(out);
+               ws(out);
+               out += ':';
+               value(out, depth + 1);
+            }
+            ws(out);
+            out += '}';
+            break;
+         }
+      }
+      ws(out);
+   }
+};
+
+// Replaces, inserts, or deletes a few bytes, or truncates
+std::string mutate(std::string json, std::mt19937& rng)
+{
+   static const char chars[] = "\"\\{}[]:,0123456789eE.+-tfnul \t\n\r/u\x01\x1f\x7f\x80\xbf\xc0"
+                               "\xc3\xe2\xed\xf0\xf5\xff";
+   auto random_char = [&] { return chars[rng() % (sizeof(chars) - 1)]; };
+   auto n = 1 + rng() % 3;
+   for (uint32_t i = 0; i < n && !json.empty(); ++i)
+   {
+      auto pos = rng() % json.size();
+      switch (rng() % 4)
+      {
+         case 0:
+            json[pos] = random_char();
+            break;
+         case 1:
+            json.insert(json.begin() + pos, random_char());
+            break;
+         case 2:
+            json.erase(pos, 1);
+            break;
+         default:
+            json.resize(pos);
+            break;
+      }
+   }
+   return json;
+}
+
+// One document per error rapidjson can report, plus edge cases for each kind of token
+const char* const corpus[] = {
+    "",
+    " \t\n\r",
+    "null",
+    "true",
+    "false",
+    "nul",
+    "tru",
+    "fals",
+    "nullx",
+    "[nulL]",
+    "0",
+    "-0",
+    "-",
+    "--1",
+    "+1",
+    "01",
+    "[01]",
+    "1.",
+    "1.e5",
+    ".5",
+    "1e",
+    "1e+",
+    "1E-x",
+    "1e400",
+    "-1e400",
+    "1e-400",
+    "123456789012345678901234567890",
+    "\"\"",
+    "\"abc",
+    "\"\\\"",
+    "\"\\x\"",
+    "\"\\u12g4\"",
+    "\"\\u123\"",
+    "\"\\ud800\"",
+    "\"\\ud800\\u0041\"",
+    "\"\\ud800\\udbff\"",
+    "\"\\udc00\"",
+    "\"\\u0000\"",
+    "\"\x01\"",
+    "\"\x7f\"",
+    "\"\x80\"",
+    "\"\xc0\x80\"",
+    "\"\xc3\"",
+    "\"\xc3\xa9\"",
+    "\"\xe2\x82\"",
+    "\"\xed\xa0\x80\"",
+    "\"\xf0\x9f\x98\x80\"",
+    "\"\xf4\x90\x80\x80\"",
+    "\"\xf5\x80\x80\x80\"",
+    "\"\xff\"",
+    "[",
+    "]",
+    "[]",
+    "[ ]",
+    "[,]",
+    "[1,]",
+    "[1 2]",
+    "[1,,2]",
+    "[[[[[[]]]]]]",
+    "[[[[[[]]]]]",
+    "{",
+    "}",
+    "{}",
+    "{,}",
+    "{\"a\"}",
+    "{\"a\" 1}",
+    "{\"a\":}",
+    "{\"a\":1,}",
+    "{\"a\":1 \"b\":2}",
+    "{1:2}",
+    "{\"a\":1]",
+    "[1}",
+    "[1] 2",
+    "{} {}",
+    "1 ",
+    " 1",
+    "1 x",
+    "\"a\"\"b\"",
+};
+
+void check_corpus()
+{
+   for (auto* json : corpus)
+      check_parity(json);
+
+   std::string deep(3000, '[');
+   deep += std::string(3000, ']');
+   check_parity(deep);
+   deep.pop_back();
+   check_parity(deep);
+
+   // Every token type straddling the scanner's 64-byte blocks
+   for (auto* json : {"[null,true,false,\"\\u00e9x\",-12.5e3,{\"k\":\"v\"}]"})
+      for (size_t pad = 0; pad < 70; ++pad)
+         check_parity(std::string(pad, ' ') + json + std::string(pad % 7, '\n'));
+}
+
+void check_generated()
+{
+   generator gen{1};
+   for (int i = 0; i < 20000; ++i)
+   {
+      auto json = gen.document();
+      auto log = check_parity(json);
+      if (!log)
+         continue;
+      if (!log->error.empty())
+      {
+         // Generated documents are valid, except for numbers rapidjson considers too big
+         if (log->error != eosio::convert_json_error(eosio::from_json_error::number_too_big))
+            printf("unexpected error %s on %s\n", log->error.c_str(), printable(json).c_str()),
+                ++error_count;
+      }
+      else
+      {
+         auto written = write_tokens(log->tokens, gen.rng);
+         auto reread = check_parity(written);
+         if (reread && reread->tokens != log->tokens)
+            printf("round trip mismatch on %s\n", printable(json).c_str()), ++error_count;
+      }
+      for (int j = 0; j < 5; ++j)
+         check_parity(mutate(json, gen.rng));
+   }
+}
+
+int main()
+{
+   check_corpus();
+   check_generated();
+   if (error_count)
+   {
+      printf("%d failures\n", error_count);
+      return 1;
+   }
+   printf("ok\n");
+}
@@ -0,0 +1,241 @@
+// copyright defined in abieos/LICENSE.txt
+
+// Compares abi_type's bin_to_json and json_to_bin against abi_program on blocks of state-history
+// transaction traces.
+//
+// usage: abieos-program-bench [blocks] [traces_per_block]
+
+#include <eosio/abi.hpp>
+#include <eosio/abi_program.hpp>
+#include <eosio/convert.hpp>
+#include <eosio/ship_protocol.hpp>
+#include <eosio/to_bin.hpp>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace eosio::ship_protocol;
+
+// The subset of the state-history abi which describes transaction traces
+static eosio::abi_def make_abi()
+{
+   eosio::abi_def def;
+   def.version = "eosio::abi/1.1";
+   def.structs = {
+       {"extension", "", {{"type", "uint16"}, {"data", "bytes"}}},
+       {"permission_level", "", {{"actor", "name"}, {"permission", "name"}}},
+       {"action",
+        "",
+        {{"account", "name"},
+         {"name", "name"},
+         {"authorization", "permission_level[]"},
+         {"data", "bytes"}}},
+       {"account_auth_sequence", "", {{"account", "name"}, {"sequence", "uint64"}}},
+       {"action_receipt_v0",
+        "",
+        {{"receiver", "name"},
+         {"act_digest", "checksum256"},
+         {"global_sequence", "uint64"},
+         {"recv_sequence", "uint64"},
+         {"auth_sequence", "account_auth_sequence[]"},
+         {"code_sequence", "varuint32"},
+         {"abi_sequence", "varuint32"}}},
+       {"account_delta", "", {{"account", "name"}, {"delta", "int64"}}},
+       {"action_trace_v0",
+        "",
+        {{"action_ordinal", "varuint32"},
+         {"creator_action_ordinal", "varuint32"},
+         {"receipt", "action_receipt?"},
+         {"receiver", "name"},
+         {"act", "action"},
+         {"context_free", "bool"},
+         {"elapsed", "int64"},
+         {"console", "string"},
+         {"account_ram_deltas", "account_delta[]"},
+         {"except", "string?"},
+         {"error_code", "uint64?"}}},
+       {"action_trace_v1",
+        "",
+        {{"action_ordinal", "varuint32"},
+         {"creator_action_ordinal", "varuint32"},
+         {"receipt", "action_receipt?"},
+         {"receiver", "name"},
+         {"act", "action"},
+         {"context_free", "bool"},
+         {"elapsed", "int64"},
+         {"console", "string"},
+         {"account_ram_deltas", "account_delta[]"},
+         {"except", "string?"},
+         {"error_code", "uint64?"},
+         {"return_value", "bytes"}}},
+       {"partial_transaction_v0",
+        "",
+        {{"expiration", "time_point_sec"},
+         {"ref_block_num", "uint16"},
+         {"ref_block_prefix", "uint32"},
+         {"max_net_usage_words", "varuint32"},
+         {"max_cpu_usage_ms", "uint8"},
+         {"delay_sec", "varuint32"},
+         {"transaction_extensions", "extension[]"},
+         {"signatures", "signature[]"},
+         {"context_free_data", "bytes[]"}}},
+       {"transaction_trace_v0",
+        "",
+        {{"id", "checksum256"},
+         {"status", "uint8"},
+         {"cpu_usage_us", "uint32"},
+         {"net_usage_words", "varuint32"},
+         {"elapsed", "int64"},
+         {"net_usage", "uint64"},
+         {"scheduled", "bool"},
+         {"action_traces", "action_trace[]"},
+         {"account_ram_delta", "account_delta?"},
+         {"except", "string?"},
+         {"error_code", "uint64?"},
+         {"failed_dtrx_trace", "recurse_transaction_trace[]"},
+         {"partial", "partial_transaction?"}}},
+       {"recurse_transaction_trace", "", {{"recurse", "transaction_trace"}}},
+   };
+   def.variants.value = {
+       {"action_receipt", {"action_receipt_v0"}},
+       {"action_trace", {"action_trace_v0", "action_trace_v1"}},
+       {"partial_transaction", {"partial_transaction_v0"}},
+       {"transaction_trace", {"transaction_trace_v0"}},
+   };
+   return def;
+}
+
+static std::vector<transaction_trace> make_block(uint32_t block_num, uint32_t num_traces)
+{
+   std::vector<transaction_trace> block;
+   for (uint32_t i = 0; i < num_traces; ++i)
+   {
+      transaction_trace_v0 trace;
+      trace.id.data()[0] = block_num;
+      trace.id.data()[1] = i;
+      trace.cpu_usage_us = 100 + i;
+      trace.net_usage_words = 16;
+      trace.net_usage = 128;
+      for (uint32_t j = 0; j < 3; ++j)
+      {
+         action_receipt_v0 receipt;
+         receipt.receiver = eosio::name{"eosio.token"};
+         receipt.global_sequence = uint64_t(block_num) * 1000 + i * 3 + j;
+         receipt.recv_sequence = receipt.global_sequence;
+         receipt.auth_sequence = {{eosio::name{"alice"}, receipt.global_sequence}};
+         receipt.code_sequence = 1;
+         receipt.abi_sequence = 1;
+
+         action_trace_v1 action;
+         action.action_ordinal = j + 1;
+         action.creator_action_ordinal = j ? 1 : 0;
+         action.receipt = receipt;
+         action.receiver = j == 2 ? eosio::name{"bob"} : eosio::name{"eosio.token"};
+         action.act.account = eosio::name{"eosio.token"};
+         action.act.name = eosio::name{"transfer"};
+         action.act.authorization = {{eosio::name{"alice"}, eosio::name{"active"}}};
+         static const char data[40] = "transfer payload";
+         action.act.data = {data, data + sizeof(data)};
+         action.elapsed = 20 + j;
+         action.account_ram_deltas = {{eosio::name{"alice"}, int64_t(j) - 1}};
+         trace.action_traces.push_back(action);
+      }
+      if (i % 4 == 0)
+      {
+         partial_transaction_v0 partial;
+         partial.expiration = eosio::time_point_sec{1600000000 + block_num};
+         partial.ref_block_num = block_num;
+         partial.ref_block_prefix = 0x12345678;
+         trace.partial = partial;
+      }
+      block.push_back(trace);
+   }
+   return block;
+}
+
+template <typename F>
+static double best_of(F f)
+{
+   double best = 0;
+   for (int i = 0; i < 5; ++i)
+   {
+      auto start = std::chrono::steady_clock::now();
+      f();
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      if (!best || elapsed.count() < best)
+         best = elapsed.count();
+   }
+   return best;
+}
+
+int main(int argc, const char** argv)
+{
+   size_t num_blocks = argc > 1 ? strtoull(argv[1], nullptr, 0) : 200;
+   uint32_t num_traces = argc > 2 ? strtoul(argv[2], nullptr, 0) : 50;
+
+   eosio::abi abi;
+   convert(make_abi(), abi);
+   auto type = abi.get_type("transaction_trace[]");
+   eosio::abi_program program{type};
+
+   std::vector<std::vector<char>> bins;
+   std::vector<std::string> jsons;
+   size_t bin_bytes = 0;
+   size_t json_bytes = 0;
+   for (size_t i = 0; i < num_blocks; ++i)
+   {
+      bins.push_back(eosio::convert_to_bin(make_block(i, num_traces)));
+      eosio::input_stream bin{bins.back()};
+      jsons.push_back(type->bin_to_json(bin));
+      eosio::input_stream program_bin{bins.back()};
+      if (program.bin_to_json(program_bin) != jsons.back() ||
+          program.json_to_bin(jsons.back()) != bins.back())
+         throw std::runtime_error("abi_program result mismatch");
+      bin_bytes += bins.back().size();
+      json_bytes += jsons.back().size();
+   }
+   printf("%zu blocks, %zu bytes of binary, %zu bytes of json\n", num_blocks, bin_bytes,
+          json_bytes);
+
+   auto report = [&](const char* name, double type_time, double program_time, size_t bytes) {
+      printf("%-12s abi_type: %8.3f ms %8.1f MB/s  abi_program: %8.3f ms %8.1f MB/s  %5.2fx\n",
+             name, type_time * 1000, bytes / type_time / 1e6, program_time * 1000,
+             bytes / program_time / 1e6, type_time / program_time);
+   };
+
+   size_t sink = 0;
+   std::vector<char> out;
+   auto type_b2j = best_of([&] {
+      for (auto& b : bins)
+      {
+         eosio::input_stream bin{b};
+         sink += type->bin_to_json(bin).size();
+      }
+   });
+   auto program_b2j = best_of([&] {
+      for (auto& b : bins)
+      {
+         eosio::input_stream bin{b};
+         out.clear();
+         program.bin_to_json(bin, out);
+         sink += out.size();
+      }
+   });
+   report("bin_to_json", type_b2j, program_b2j, bin_bytes);
+
+   auto type_j2b = best_of([&] {
+      for (auto& j : jsons)
+         sink += type->json_to_bin(j).size();
+   });
+   auto program_j2b = best_of([&] {
+      for (auto& j : jsons)
+         sink += program.json_to_bin(j).size();
+   });
+   report("json_to_bin", type_j2b, program_j2b, json_bytes);
+
+   return sink == 0;
+}
@@ -1,10 +1,14 @@
 // copyright defined in abieos/LICENSE.txt
 
 #include <stdio.h>
+#include <algorithm>
+#include <map>
+#include <random>
 #include <stdexcept>
 #include <string>
 #include <vector>
 #include "abieos.hpp"
+#include "eosio/abi_program.hpp"
 #include "eosio/abieos.h"
 #include "fuzzer.hpp"
 
@@ -273,6 +277,56 @@ T check_context(abieos_context* context, T value)
    return value;
 }
 
+// Copies of the abis given to the context; run_check_type compares abi_program's results against
+// the context's
+std::map<uint64_t, eosio::abi> program_abis;
+
+void add_program_abi(uint64_t contract, const char* abi_json)
+{
+   std::string copy = abi_json;
+   eosio::json_token_stream stream{copy.data()};
+   eosio::abi_def def;
+   from_json(def, stream);
+   convert(def, program_abis[contract]);
+}
+
+void add_program_abi_hex(uint64_t contract, const char* abi_hex)
+{
+   std::vector<char> data;
+   check(eosio::unhex(std::back_inserter(data), abi_hex, abi_hex + strlen(abi_hex)), "unhex");
+   eosio::input_stream stream{data.data(), data.size()};
+   eosio::abi_def def;
+   from_bin(def, stream);
+   convert(def, program_abis[contract]);
+}
+
+void check_program(uint64_t contract,
+                   const char* type,
+                   const char* data,
+                   const std::string& hex,
+                   const std::string& json,
+                   bool check_ordered)
+{
+   auto it = program_abis.find(contract);
+   if (it == program_abis.end())
+      return;
+   eosio::abi_program program{it->second.get_type(type)};
+   if (check_ordered)
+   {
+      std::string program_hex;
+      auto bin = program.json_to_bin(data);
+      eosio::hex(bin.begin(), bin.end(), std::back_inserter(program_hex));
+      if (program_hex != hex)
+         throw std::runtime_error("abi_program json_to_bin mismatch: " + program_hex);
+   }
+   std::vector<char> bin;
+   check(eosio::unhex(std::back_inserter(bin), hex.begin(), hex.end()), "unhex");
+   eosio::input_stream stream{bin.data(), bin.size()};
+   auto program_json = program.bin_to_json(stream);
+   if (program_json != json || stream.remaining())
+      throw std::runtime_error("abi_program bin_to_json mismatch: " + program_json);
+}
+
 void run_check_type(abieos_context* context,
                     uint64_t contract,
                     const char* type,
@@ -299,6 +353,7 @@ void run_check_type(abieos_context* context,
    printf("%s %s %s %s\n", type, data, reorderable_hex.c_str(), result.c_str());
    if (result != expected)
       throw std::runtime_error("mismatch");
+   check_program(contract, type, data, reorderable_hex, result, check_ordered);
 }
 
 template <typename F>
@@ -336,6 +391,10 @@ void check_types()
    check_context(context, abieos_set_abi_hex(context, token, tokenHexAbi));
    check_context(context, abieos_set_abi(context, testAbiName, testAbi));
    check_context(context, abieos_set_abi_hex(context, testHexAbiName, testHexAbi));
+   add_program_abi(0, transactionAbi);
+   add_program_abi_hex(token, tokenHexAbi);
+   add_program_abi(testAbiName, testAbi);
+   add_program_abi_hex(testHexAbiName, testHexAbi);
 
    int next_id = 0;
    auto write_corpus = [&](bool abi_is_bin, uint8_t operation, uint64_t contract,
@@ -1052,11 +1111,221 @@ void check_types()
    abieos_destroy(context);
 }
 
+void check_batch()
+{
+   auto context = check(abieos_create());
+   auto testAbiName = check_context(context, abieos_string_to_name(context, "test.abi"));
+   check_context(context, abieos_set_abi(context, testAbiName, testAbi));
+   auto abi = check_context(context, abieos_compile_abi(context, testAbi));
+
+   std::vector<std::pair<const char*, const char*>> values = {
+       {"v1", R"(["int8",7])"},
+       {"v1", R"(["s2",{"y1":5,"y2":4}])"},
+       {"s3", R"({"z1":7,"z2":["int8",6],"z3":{"y1":9}})"},
+       {"s4", R"({"a1":null,"b1":[5,6,7]})"},
+       {"int8[]", R"([1,2,3])"},
+       {"s1?", R"({"x1":6})"},
+   };
+   std::vector<std::vector<char>> bins;
+   std::vector<std::string> expected;
+   for (auto& [type, json] : values)
+   {
+      check_context(context, abieos_json_to_bin(context, testAbiName, type, json));
+      auto data = abieos_get_bin_data(context);
+      bins.emplace_back(data, data + abieos_get_bin_size(context));
+      expected.push_back(json);
+
+      check_context(context, abieos_abi_json_to_bin(context, abi, type, json));
+      data = abieos_get_bin_data(context);
+      if (std::vector<char>(data, data + abieos_get_bin_size(context)) != bins.back())
+         throw std::runtime_error("abieos_abi_json_to_bin mismatch: " + std::string(json));
+   }
+   check_error(context, "abi is null",
+               [&] { return abieos_abi_json_to_bin(context, nullptr, "int8", "7"); });
+   check_error(context, "Unknown type",
+               [&] { return abieos_abi_json_to_bin(context, abi, "no_such_type", "7"); });
+   check_error(context, "number is out of range",
+               [&] { return abieos_abi_json_to_bin(context, abi, "int8", "128"); });
+
+   std::vector<abieos_bin_to_json_item> items;
+   for (size_t i = 0; i < 1000; ++i)
+   {
+      auto n = i % (values.size() + 2);
+      if (n < values.size())
+         items.push_back({values[n].first, bins[n].data(), bins[n].size()});
+      else if (n == values.size())
+         items.push_back({"s3", bins[0].data(), bins[0].size()});  // wrong type
+      else
+         items.push_back({"no_such_type", bins[0].data(), bins[0].size()});
+   }
+
+   auto check_item = [&](size_t i, const char* arena) {
+      auto& item = items[i];
+      auto n = i % (values.size() + 2);
+      std::string json{arena + item.json_offset, item.json_size};
+      if (arena[item.json_offset + item.json_size])
+         throw std::runtime_error("batch result is not null-terminated");
+      if (n < values.size() ? !item.ok || json != expected[n] : item.ok || json.empty())
+         throw std::runtime_error("batch mismatch: " + json);
+   };
+
+   for (uint32_t num_threads : {1, 2, 7, 0})
+   {
+      size_t arena_used = 0;
+      size_t num_converted = 0;
+      check(!abieos_bin_to_json_batch(context, abi, items.data(), items.size(), nullptr, 0,
+                                      &arena_used, &num_converted, num_threads),
+            "batch into empty arena");
+      check(!num_converted && arena_used == expected[0].size() + 1,
+            "batch reports the size the first item needs");
+
+      std::vector<char> arena(1 << 20);
+      check_context(context, abieos_bin_to_json_batch(context, abi, items.data(), items.size(),
+                                                      arena.data(), arena.size(), &arena_used,
+                                                      &num_converted, num_threads));
+      check(num_converted == items.size() && arena_used < arena.size(), "whole batch");
+      for (size_t i = 0; i < items.size(); ++i)
+         check_item(i, arena.data());
+
+      // Each call resumes from the first item which didn't fit
+      arena.resize(arena_used / 5);
+      size_t num_calls = 0;
+      for (size_t begin = 0; begin < items.size(); begin += num_converted, ++num_calls)
+      {
+         check_context(context,
+                       abieos_bin_to_json_batch(context, abi, items.data() + begin,
+                                                items.size() - begin, arena.data(), arena.size(),
+                                                &arena_used, &num_converted, num_threads));
+         check(num_converted && arena_used <= arena.size(), "partial batch");
+         for (size_t i = begin; i < begin + num_converted; ++i)
+            check_item(i, arena.data());
+      }
+      check(num_calls >= 5, "partial batches fill the arena");
+   }
+
+   // The context's workers are reused by every batch, including small ones
+   std::vector<char> arena(1 << 20);
+   for (size_t i = 0; i < 2000; ++i)
+   {
+      size_t begin = i % 500;
+      size_t count = 1 + i % 300;
+      size_t arena_used = 0;
+      size_t num_converted = 0;
+      check_context(context, abieos_bin_to_json_batch(context, abi, items.data() + begin, count,
+                                                      arena.data(), arena.size(), &arena_used,
+                                                      &num_converted, 4));
+      check(num_converted == count, "small batch");
+      for (size_t j = begin; j < begin + count; ++j)
+         check_item(j, arena.data());
+   }
+
+   abieos_destroy_abi(abi);
+   abieos_destroy(context);
+}
+
+// Significant characters found one byte at a time
+std::vector<size_t> scan_json_bytes(const std::string& json)
+{
+   std::vector<size_t> result;
+   bool in_string = false;
+   bool escaped = false;
+   for (size_t i = 0; i < json.size(); ++i)
+   {
+      char c = json[i];
+      bool whitespace = c == ' ' || c == '\t' || c == '\n' || c == '\r';
+      if (escaped)
+      {
+         escaped = false;
+         if (!in_string && !whitespace)
+            result.push_back(i);
+         continue;
+      }
+      if (c == '\\')
+         escaped = true;
+      if (c == '"')
+         in_string = !in_string;
+      else if (in_string || whitespace)
+         continue;
+      result.push_back(i);
+   }
+   return result;
+}
+
+void check_json_scanner()
+{
+   std::vector<const eosio::json_scan_backend*> backends{&eosio::json_scan::scalar};
+#if defined(__SSE2__) && !defined(__wasm_simd128__)
+   backends.push_back(&eosio::json_scan::sse2);
+   if (__builtin_cpu_supports("avx2"))
+      backends.push_back(&eosio::json_scan::avx2);
+#endif
+#ifdef EOSIO_JSON_SCAN_SIMD128
+   backends.push_back(&eosio::json_scan::simd128);
+#endif
+
+   std::mt19937 rng;
+   const char alphabet[] = "\"\"\\\\  \t\n\rab{}[]:,\x01\x80";
+   for (int i = 0; i < 5000; ++i)
+   {
+      std::string json(rng() % 300, 0);
+      for (auto& c : json)
+         c = alphabet[rng() % (sizeof(alphabet) - 1)];
+      auto expected = scan_json_bytes(json);
+      auto special = std::find_if(json.begin(), json.end(), eosio::json_scan::is_string_special);
+      for (auto* backend : backends)
+      {
+         eosio::json_scanner scanner{json.data(), json.data() + json.size(), *backend};
+         std::vector<size_t> found;
+         for (auto p = scanner.next(json.data()); p != json.data() + json.size();
+              p = scanner.next(p + 1))
+            found.push_back(p - json.data());
+         if (found != expected)
+            throw std::runtime_error(std::string{"json_scanner mismatch: "} + backend->name);
+         if (backend->find_string_special(json.data(), json.data() + json.size()) !=
+             json.data() + (special - json.begin()))
+            throw std::runtime_error(std::string{"find_string_special mismatch: "} +
+                                     backend->name);
+      }
+   }
+
+   // Tokens which cross block boundaries
+   std::string padding(60, ' ');
+   std::string json = padding + R"({"a\u00e9\ud83d\ude00\"":[)" + padding +
+                      R"(-2.5e3, "x\\y\/", true,null]})" + padding;
+   eosio::json_scan_token_stream stream{json.data()};
+   stream.get_start_object();
+   check(stream.get_key() == "a\xc3\xa9\xf0\x9f\x98\x80\"", "json key");
+   stream.get_start_array();
+   check(stream.get_string() == "-2.5e3", "json number");
+   check(stream.get_string() == "x\\y/", "json string");
+   check(stream.get_bool(), "json bool");
+   stream.get_null();
+   stream.get_end_array();
+   stream.get_end_object();
+   stream.get_end();
+
+   for (auto bad : {"", "  ", "[1,]", "{\"a\" 1}", "\"\\x\"", "\"\xc0\x80\"", "\"\\ud800\"",
+                    "1.", "1e", "01", "[1] 2", "\"abc"})
+   {
+      std::string copy = bad;
+      check_except("", [&] {
+         eosio::json_scan_token_stream stream{copy.data()};
+         while (!stream.complete())
+         {
+            stream.peek_token();
+            stream.eat_token();
+         }
+      });
+   }
+}
+
 int main()
 {
    try
    {
       check_types();
+      check_batch();
+      check_json_scanner();
       printf("\nok\n\n");
       return 0;
    }
@@ -0,0 +1,105 @@
+// Compares range scans over an ordered_unique index (intrusive AVL tree) with the same index
+// as a btree_unique (B+tree of node pointers). The table mimics the micro-chain's
+// balance_history: many rows per account, scanned in pages by (account, time, id).
+//
+//    cltester undo-index-bench.wasm [rows] [scans] [page size]
+
+#include <boost/multi_index/key.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <chainbase/chainbase.hpp>
+#include <chainbase/node_pool.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <tuple>
+
+struct by_id;
+struct by_pk;
+
+using history_key = std::tuple<uint64_t, uint32_t, uint64_t>;
+
+struct history_object : public chainbase::object<0, history_object>
+{
+   CHAINBASE_DEFAULT_CONSTRUCTOR(history_object)
+
+   id_type id;
+   uint64_t account = 0;
+   uint32_t time = 0;
+   int64_t delta = 0;
+   int64_t balance = 0;
+
+   history_key by_pk() const { return {account, time, id._id}; }
+};
+
+template <typename PkIndex>
+using history_index = chainbase::generic_index<boost::multi_index_container<
+    history_object,
+    boost::multi_index::indexed_by<
+        boost::multi_index::ordered_unique<boost::multi_index::tag<by_id>,
+                                           boost::multi_index::key<&history_object::id>>,
+        PkIndex>,
+    chainbase::pool_allocator<history_object>>>;
+
+using avl_index = history_index<
+    boost::multi_index::ordered_unique<boost::multi_index::tag<by_pk>,
+                                       boost::multi_index::key<&history_object::by_pk>>>;
+using btree_index =
+    history_index<chainbase::btree_unique<boost::multi_index::tag<by_pk>,
+                                          boost::multi_index::key<&history_object::by_pk>>>;
+
+constexpr uint64_t num_accounts = 1000;
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+   return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Index>
+void run(const char* name, uint32_t rows, uint32_t scans, uint32_t page_size)
+{
+   auto live_before = chainbase::get_node_pool().get_stats().live_bytes;
+   Index table;
+   std::mt19937_64 rng(1234);
+
+   auto start = std::chrono::steady_clock::now();
+   for (uint32_t i = 0; i < rows; ++i)
+      table.emplace([&](auto& obj) {
+         obj.account = rng() % num_accounts;
+         obj.time = i;
+         obj.delta = rng() % 1000;
+      });
+   auto build = seconds_since(start);
+   auto live = chainbase::get_node_pool().get_stats().live_bytes - live_before;
+
+   auto& idx = table.template get<by_pk>();
+   int64_t sum = 0;
+   start = std::chrono::steady_clock::now();
+   for (uint32_t i = 0; i < scans; ++i)
+   {
+      auto it = idx.lower_bound(history_key{rng() % num_accounts, rng() % rows, 0});
+      for (uint32_t n = 0; n < page_size && it != idx.end(); ++n, ++it)
+         sum += it->delta;
+   }
+   auto scan = seconds_since(start);
+
+   start = std::chrono::steady_clock::now();
+   for (auto& obj : idx)
+      sum += obj.delta;
+   auto full = seconds_since(start);
+
+   printf("%-6s build %7.3fs  pages %7.3fs (%8.0f rows/ms)  full scan %7.3fs  nodes %6.1f MiB"
+          "  (checksum %lld)\n",
+          name, build, scan, double(scans) * page_size / (scan * 1000), full,
+          live / double(1 << 20), (long long)sum);
+}
+
+int main(int argc, char** argv)
+{
+   uint32_t rows = argc > 1 ? std::stoul(argv[1]) : 500'000;
+   uint32_t scans = argc > 2 ? std::stoul(argv[2]) : 20'000;
+   uint32_t page_size = argc > 3 ? std::stoul(argv[3]) : 100;
+   run<avl_index>("avl", rows, scans, page_size);
+   run<btree_index>("btree", rows, scans, page_size);
+}
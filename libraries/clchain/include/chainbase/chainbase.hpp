@@ -58,6 +58,9 @@ namespace chainbase
    {
       typedef oid<Derived> id_type;
       static const uint16_t type_id = TypeNumber;
+
+      // Lets derived objects default their operator==
+      bool operator==(const object&) const = default;
    };
 
    /** this class is ment to be specified to enable lookup of index type by object type using
@@ -114,6 +117,32 @@ namespace chainbase
       SessionType _session;
    };
 
+   // Changes to one table; see undo_index::changes_since
+   struct table_changes
+   {
+      uint32_t type_id = 0;
+      std::string type_name;
+      std::vector<int64_t> created;
+      std::vector<int64_t> modified;
+      std::vector<int64_t> removed;
+   };
+
+   // Undo stack memory for one table; see undo_index::undo_stats
+   struct table_undo_stats
+   {
+      uint32_t type_id = 0;
+      std::string type_name;
+      struct session
+      {
+         int64_t revision = 0;
+         uint64_t old_values = 0;
+         uint64_t old_value_bytes = 0;
+         uint64_t removed_values = 0;
+         uint64_t removed_value_bytes = 0;
+      };
+      std::vector<session> sessions;
+   };
+
    class abstract_index
    {
      public:
@@ -131,6 +160,8 @@ namespace chainbase
       virtual uint64_t row_count() const = 0;
       virtual const std::string& type_name() const = 0;
       virtual std::pair<int64_t, int64_t> undo_stack_revision_range() const = 0;
+      virtual bool changes_since(int64_t revision, table_changes& result) const = 0;
+      virtual table_undo_stats undo_stats() const = 0;
 
       virtual void remove_object(int64_t id) = 0;
 
@@ -165,6 +196,32 @@ namespace chainbase
       {
          return _base.undo_stack_revision_range();
       }
+      virtual bool changes_since(int64_t revision, table_changes& result) const override
+      {
+         auto changes = _base.changes_since(revision);
+         if (!changes)
+            return false;
+         result.type_id = type_id();
+         result.type_name = type_name();
+         auto copy = [](auto& ids, auto& dest) {
+            dest.reserve(ids.size());
+            for (auto& id : ids)
+               dest.push_back(id._id);
+         };
+         copy(changes->created, result.created);
+         copy(changes->modified, result.modified);
+         copy(changes->removed, result.removed);
+         return true;
+      }
+
+      virtual table_undo_stats undo_stats() const override
+      {
+         table_undo_stats result{type_id(), type_name()};
+         for (auto& s : _base.undo_stats())
+            result.sessions.push_back({s.revision, s.old_values, s.old_value_bytes,
+                                       s.removed_values, s.removed_value_bytes});
+         return result;
+      }
 
       virtual void remove_object(int64_t id) override { return _base.remove_object(id); }
 
@@ -263,6 +320,27 @@ namespace chainbase
          return _index_list[0]->undo_stack_revision_range();
       }
 
+      // Changes to each table since revision, in the order the tables were added, or nullopt
+      // if revision is outside undo_stack_revision_range()
+      std::optional<std::vector<table_changes>> changes_since(int64_t revision) const
+      {
+         std::vector<table_changes> result(_index_list.size());
+         for (size_t i = 0; i < _index_list.size(); ++i)
+            if (!_index_list[i]->changes_since(revision, result[i]))
+               return std::nullopt;
+         return result;
+      }
+
+      // Undo stack memory of each table, in the order the tables were added
+      std::vector<table_undo_stats> undo_stats() const
+      {
+         std::vector<table_undo_stats> result;
+         result.reserve(_index_list.size());
+         for (auto& item : _index_list)
+            result.push_back(item->undo_stats());
+         return result;
+      }
+
       void undo()
       {
          for (auto& item : _index_list)
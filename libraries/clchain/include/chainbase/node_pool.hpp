@@ -0,0 +1,184 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace chainbase
+{
+   // Size-class allocator for undo_index nodes. Each class carves equally-sized blocks out of
+   // slabs and keeps freed blocks on a free list, so nodes released by commit, undo, squash,
+   // and remove are reused by later allocations instead of returning to the general
+   // allocator. Slabs are never released before the pool is destroyed. Requests larger than
+   // max_size bypass the pool. Not thread safe.
+   class node_pool
+   {
+     public:
+      static constexpr std::size_t granularity = alignof(std::max_align_t);
+      static constexpr std::size_t max_size = 1024;
+      static constexpr std::size_t num_classes = max_size / granularity;
+      static constexpr std::size_t slab_size = 16 * 1024;
+
+      struct stats
+      {
+         uint64_t live_nodes = 0;   // blocks handed out from slabs
+         uint64_t free_nodes = 0;   // blocks on free lists, ready for reuse
+         uint64_t live_bytes = 0;   // bytes in live_nodes
+         uint64_t free_bytes = 0;   // bytes in free_nodes
+         uint64_t slab_bytes = 0;   // bytes obtained for slabs, including unused tails
+         uint64_t large_nodes = 0;  // live allocations larger than max_size
+         uint64_t large_bytes = 0;  // bytes in large_nodes
+      };
+
+      node_pool() = default;
+      node_pool(const node_pool&) = delete;
+      node_pool& operator=(const node_pool&) = delete;
+
+      ~node_pool()
+      {
+         while (slabs)
+         {
+            auto next = slabs->next;
+            ::operator delete(slabs);
+            slabs = next;
+         }
+      }
+
+      void* allocate(std::size_t size)
+      {
+         if (size > max_size)
+         {
+            ++large_nodes;
+            large_bytes += size;
+            return ::operator new(size);
+         }
+         auto& c = classes[class_of(size)];
+         ++c.live;
+         if (c.free)
+         {
+            auto result = c.free;
+            c.free = result->next;
+            --c.num_free;
+            return result;
+         }
+         auto block_size = size_of_class(class_of(size));
+         if (std::size_t(c.end - c.pos) < block_size)
+         {
+            auto slab = static_cast<slab_header*>(::operator new(slab_size));
+            slab->next = slabs;
+            slabs = slab;
+            slab_bytes += slab_size;
+            c.pos = reinterpret_cast<char*>(slab) + header_size;
+            c.end = reinterpret_cast<char*>(slab) + slab_size;
+         }
+         auto result = c.pos;
+         c.pos += block_size;
+         return result;
+      }
+
+      void deallocate(void* p, std::size_t size) noexcept
+      {
+         if (size > max_size)
+         {
+            --large_nodes;
+            large_bytes -= size;
+            ::operator delete(p);
+            return;
+         }
+         auto& c = classes[class_of(size)];
+         auto node = static_cast<free_node*>(p);
+         node->next = c.free;
+         c.free = node;
+         --c.live;
+         ++c.num_free;
+      }
+
+      stats get_stats() const
+      {
+         stats result;
+         for (std::size_t i = 0; i < num_classes; ++i)
+         {
+            auto& c = classes[i];
+            result.live_nodes += c.live;
+            result.free_nodes += c.num_free;
+            result.live_bytes += c.live * size_of_class(i);
+            result.free_bytes += c.num_free * size_of_class(i);
+         }
+         result.slab_bytes = slab_bytes;
+         result.large_nodes = large_nodes;
+         result.large_bytes = large_bytes;
+         return result;
+      }
+
+     private:
+      struct free_node
+      {
+         free_node* next;
+      };
+
+      struct slab_header
+      {
+         slab_header* next;
+      };
+
+      struct size_class
+      {
+         free_node* free = nullptr;
+         char* pos = nullptr;
+         char* end = nullptr;
+         uint64_t live = 0;
+         uint64_t num_free = 0;
+      };
+
+      static constexpr std::size_t header_size =
+          (sizeof(slab_header) + granularity - 1) / granularity * granularity;
+
+      static constexpr std::size_t class_of(std::size_t size)
+      {
+         return size ? (size - 1) / granularity : 0;
+      }
+      static constexpr std::size_t size_of_class(std::size_t c) { return (c + 1) * granularity; }
+
+      std::array<size_class, num_classes> classes;
+      slab_header* slabs = nullptr;
+      uint64_t slab_bytes = 0;
+      uint64_t large_nodes = 0;
+      uint64_t large_bytes = 0;
+   };
+
+   // Never destroyed, since global undo_indexes may release nodes during static destruction
+   inline node_pool& get_node_pool()
+   {
+      static node_pool& pool = *new node_pool;
+      return pool;
+   }
+
+   // Stateless allocator which draws from get_node_pool(). Suitable as the Allocator of
+   // undo_index (and therefore of generic_index) in single-threaded programs.
+   template <typename T>
+   class pool_allocator
+   {
+     public:
+      using value_type = T;
+
+      pool_allocator() = default;
+      template <typename U>
+      pool_allocator(const pool_allocator<U>&)
+      {
+      }
+
+      T* allocate(std::size_t n)
+      {
+         static_assert(alignof(T) <= node_pool::granularity, "node_pool can't align T");
+         return static_cast<T*>(get_node_pool().allocate(n * sizeof(T)));
+      }
+      void deallocate(T* p, std::size_t n) noexcept
+      {
+         get_node_pool().deallocate(p, n * sizeof(T));
+      }
+
+      friend bool operator==(const pool_allocator&, const pool_allocator&) { return true; }
+      friend bool operator!=(const pool_allocator&, const pool_allocator&) { return false; }
+   };
+}  // namespace chainbase
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <chainbase/undo_index.hpp>
+#include <eosio/from_bin.hpp>
+#include <eosio/to_bin.hpp>
+
+#include <optional>
+
+namespace chainbase
+{
+   // Snapshot section for a single undo_index. Only the committed state is written; the
+   // undo stack is not. Objects are serialized with to_bin, which must not include the id.
+   //
+   // uint64_t     revision        snapshot_revision() at the time of writing
+   // uint64_t     base_revision   delta only: revision of the snapshot this delta applies to
+   // uint64_t     next_id
+   // varuint32    num_runs        ids of all objects, as runs of consecutive ids
+   //   varuint32  gap             distance from the end of the previous run
+   //   varuint32  size
+   // varuint32    num_objects     objects which changed since base_revision (all if not a delta)
+   //   varuint32  gap             distance from the previous object's id + 1
+   //   T          object
+
+   // Writes the committed state of index. If base_revision is set, only objects which changed
+   // since then are included. Returns the revision to use as base_revision for the next delta.
+   template <typename Index, typename S>
+   uint64_t write_snapshot(Index& index, std::optional<uint64_t> base_revision, S& stream)
+   {
+      auto revision = index.snapshot_revision();
+      index.advance_snapshot_revision();
+      eosio::to_bin(revision, stream);
+      if (base_revision)
+         eosio::to_bin(*base_revision, stream);
+      eosio::to_bin(uint64_t(index.committed_next_id()._id), stream);
+
+      std::vector<std::pair<int64_t, uint32_t>> runs;
+      std::vector<const typename Index::value_type*> changed;
+      index.for_each_committed([&](const auto& obj, uint64_t mtime) {
+         if (!runs.empty() && runs.back().first + runs.back().second == obj.id._id)
+            ++runs.back().second;
+         else
+            runs.emplace_back(obj.id._id, 1);
+         if (!base_revision || mtime > *base_revision)
+            changed.push_back(&obj);
+      });
+
+      int64_t pos = 0;
+      eosio::varuint32_to_bin(runs.size(), stream);
+      for (auto& [begin, size] : runs)
+      {
+         eosio::varuint32_to_bin(begin - pos, stream);
+         eosio::varuint32_to_bin(size, stream);
+         pos = begin + size;
+      }
+
+      pos = 0;
+      eosio::varuint32_to_bin(changed.size(), stream);
+      for (auto* obj : changed)
+      {
+         eosio::varuint32_to_bin(obj->id._id - pos, stream);
+         eosio::to_bin(*obj, stream);
+         pos = obj->id._id + 1;
+      }
+      return revision;
+   }
+
+   // Reads a section written by write_snapshot. If base_revision is set, the section must be
+   // a delta which applies to that revision; otherwise it must be a full snapshot. Objects
+   // which aren't listed are removed. Returns the section's revision.
+   template <typename Index, typename S>
+   uint64_t read_snapshot(Index& index, std::optional<uint64_t> base_revision, S& stream)
+   {
+      using id_type = typename Index::id_type;
+      uint64_t revision;
+      eosio::from_bin(revision, stream);
+      if (base_revision)
+      {
+         uint64_t base;
+         eosio::from_bin(base, stream);
+         eosio::check(base == *base_revision, "snapshot delta does not apply to this state");
+      }
+      uint64_t next_id;
+      eosio::from_bin(next_id, stream);
+
+      std::vector<id_type> removed;
+      auto it = index.begin();
+      auto advance = [&](int64_t id, bool keep) {
+         for (; it != index.end() && it->id._id < id; ++it)
+            if (!keep)
+               removed.push_back(it->id);
+      };
+      int64_t pos = 0;
+      auto num_runs = eosio::varuint32_from_bin(stream);
+      for (uint32_t i = 0; i < num_runs; ++i)
+      {
+         pos += eosio::varuint32_from_bin(stream);
+         advance(pos, false);
+         pos += eosio::varuint32_from_bin(stream);
+         advance(pos, true);
+      }
+      advance(std::numeric_limits<int64_t>::max(), false);
+      for (auto id : removed)
+         index.remove_object(id._id);
+
+      pos = 0;
+      auto num_objects = eosio::varuint32_from_bin(stream);
+      for (uint32_t i = 0; i < num_objects; ++i)
+      {
+         pos += eosio::varuint32_from_bin(stream);
+         index.restore(id_type(pos), [&](auto& obj) { eosio::from_bin(obj, stream); });
+         ++pos;
+      }
+      index.restore_revision(id_type(next_id), revision);
+      return revision;
+   }
+}  // namespace chainbase
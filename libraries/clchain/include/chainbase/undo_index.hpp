@@ -8,13 +8,23 @@
 #include <boost/intrusive/slist.hpp>
 #include <boost/mp11/algorithm.hpp>
 #include <boost/mp11/list.hpp>
+#include <boost/multi_index/hashed_index_fwd.hpp>
 #include <boost/multi_index_container_fwd.hpp>
 #include <eosio/check.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <concepts>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <sstream>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace chainbase
 {
@@ -180,8 +190,71 @@ namespace chainbase
    template <typename Tag, typename... Indices>
    using find_tag = boost::mp11::mp_find<boost::mp11::mp_list<index_tag<Indices>...>, Tag>;
 
+   // Index specifier for undo_index with the same meaning as
+   // boost::multi_index::ordered_unique<TagList, KeyFromValue, Compare>, but stored as a B+tree
+   // of node pointers. See set_impl<Node, btree_unique<...>>.
+   template <typename TagList,
+             typename KeyFromValue,
+             typename Compare = std::less<typename KeyFromValue::result_type>>
+   struct btree_unique
+   {
+      using key_from_value_type = KeyFromValue;
+      using compare_type = Compare;
+   };
+
+   template <typename OrderedIndex>
+   constexpr bool is_valid_index = false;
+   template <typename... T>
+   constexpr bool is_valid_index<boost::multi_index::ordered_unique<T...>> = true;
+   template <typename... T>
+   constexpr bool is_valid_index<boost::multi_index::hashed_unique<T...>> = true;
+   template <typename... T>
+   constexpr bool is_valid_index<btree_unique<T...>> = true;
+
+   template <typename Index>
+   constexpr bool is_intrusive_index = false;
+   template <typename... T>
+   constexpr bool is_intrusive_index<boost::multi_index::ordered_unique<T...>> = true;
+
+   // Hook for hashed indices. The hash is cached so that a node can be found in the table
+   // after a modify changes its key.
+   template <class Tag>
+   struct hash_node_base
+   {
+      hash_node_base() = default;
+      hash_node_base(const hash_node_base&) {}
+      constexpr hash_node_base& operator=(const hash_node_base&) { return *this; }
+      std::size_t _hash;
+   };
+
+   // Hook for B+tree indices: the leaf which holds the node
+   template <class Tag>
+   struct btree_node_base
+   {
+      btree_node_base() = default;
+      btree_node_base(const btree_node_base&) {}
+      constexpr btree_node_base& operator=(const btree_node_base&) { return *this; }
+      void* _leaf;
+   };
+
+   template <typename Index>
+   struct hook_impl
+   {
+      using type = offset_node_base<Index>;
+   };
+   template <typename... T>
+   struct hook_impl<boost::multi_index::hashed_unique<T...>>
+   {
+      using type = hash_node_base<boost::multi_index::hashed_unique<T...>>;
+   };
+   template <typename... T>
+   struct hook_impl<btree_unique<T...>>
+   {
+      using type = btree_node_base<btree_unique<T...>>;
+   };
+
    template <typename K, typename Allocator>
-   using hook = offset_node_base<K>;
+   using hook = typename hook_impl<K>::type;
 
    template <typename Node, typename OrderedIndex>
    using set_base = boost::intrusive::avltree<
@@ -191,11 +264,6 @@ namespace chainbase
            get_key<typename OrderedIndex::key_from_value_type, typename Node::value_type>>,
        boost::intrusive::compare<typename OrderedIndex::compare_type>>;
 
-   template <typename OrderedIndex>
-   constexpr bool is_valid_index = false;
-   template <typename... T>
-   constexpr bool is_valid_index<boost::multi_index::ordered_unique<T...>> = true;
-
    template <typename Node, typename Tag>
    using list_base =
        boost::intrusive::slist<typename Node::value_type,
@@ -260,6 +328,863 @@ namespace chainbase
       friend class undo_index;
    };
 
+   // Hashed index over the nodes of an undo_index: open addressing with linear probing.
+   //
+   // Each slot holds the offset from the slot to the node (0 if the slot is empty), so the
+   // table, like the tree hooks, does not depend on where memory is mapped. Erase uses
+   // backward-shift deletion, so there are no tombstones. The table grows, but never shrinks
+   // before it is destroyed; since undo never leaves more nodes in the index than it had
+   // before, undo never allocates.
+   //
+   // Slots are allocated with a default-constructed Node::allocator_type.
+   template <typename Node, typename... T>
+   struct set_impl<Node, boost::multi_index::hashed_unique<T...>>
+   {
+      using index_type = boost::multi_index::hashed_unique<T...>;
+      using value_type = typename Node::value_type;
+      using key_from_value =
+          get_key<typename index_type::key_from_value_type, typename Node::value_type>;
+      using key_type = typename key_from_value::type;
+      using hasher = typename index_type::hash_type;
+      using key_equal = typename index_type::pred_type;
+
+      class const_iterator
+      {
+        public:
+         using iterator_category = std::forward_iterator_tag;
+         using value_type = typename Node::value_type;
+         using difference_type = std::ptrdiff_t;
+         using pointer = const value_type*;
+         using reference = const value_type&;
+
+         const_iterator() = default;
+         reference operator*() const { return to_value(_slot); }
+         pointer operator->() const { return &to_value(_slot); }
+         const_iterator& operator++()
+         {
+            ++_slot;
+            skip_empty();
+            return *this;
+         }
+         const_iterator operator++(int)
+         {
+            auto result = *this;
+            ++*this;
+            return result;
+         }
+         friend bool operator==(const const_iterator& a, const const_iterator& b)
+         {
+            return a._slot == b._slot;
+         }
+         friend bool operator!=(const const_iterator& a, const const_iterator& b)
+         {
+            return a._slot != b._slot;
+         }
+
+        private:
+         friend struct set_impl;
+         const_iterator(const std::ptrdiff_t* slot, const std::ptrdiff_t* end)
+             : _slot{slot}, _end{end}
+         {
+         }
+         void skip_empty()
+         {
+            while (_slot != _end && !*_slot)
+               ++_slot;
+         }
+         const std::ptrdiff_t* _slot = nullptr;
+         const std::ptrdiff_t* _end = nullptr;
+      };
+      using iterator = const_iterator;
+
+      set_impl() = default;
+      set_impl(const set_impl&) = delete;
+      set_impl& operator=(const set_impl&) = delete;
+      ~set_impl()
+      {
+         if (_capacity)
+            slot_traits::deallocate(_allocator, _slots, _capacity);
+      }
+
+      template <typename K>
+      const_iterator find(K&& k) const
+      {
+         if (!_size)
+            return end();
+         auto h = hash(k);
+         for (auto i = home(h);; i = (i + 1) & (_capacity - 1))
+         {
+            if (!slots()[i])
+               return end();
+            auto& v = to_value(slots() + i);
+            if (get_hash(v) == h && key_equal{}(key_from_value{}(v), k))
+               return make_iterator(i);
+         }
+      }
+      template <typename K>
+      std::size_t count(K&& k) const
+      {
+         return find(static_cast<K&&>(k)) != end();
+      }
+      const_iterator begin() const
+      {
+         auto result = make_iterator(0);
+         result.skip_empty();
+         return result;
+      }
+      const_iterator end() const { return make_iterator(_capacity); }
+      bool empty() const { return !_size; }
+      std::size_t size() const { return _size; }
+      std::size_t capacity() const { return _capacity; }
+      const_iterator iterator_to(const value_type& v) const { return make_iterator(slot_of(v)); }
+
+     private:
+      using slot_allocator = rebind_alloc_t<typename Node::allocator_type, std::ptrdiff_t>;
+      using slot_traits = std::allocator_traits<slot_allocator>;
+
+      static std::size_t& get_hash(const value_type& v)
+      {
+         return static_cast<hash_node_base<index_type>&>(static_cast<Node&>(
+                    *boost::intrusive::get_parent_from_member(const_cast<value_type*>(&v),
+                                                              &value_holder<value_type>::_item)))
+             ._hash;
+      }
+      static const value_type& to_value(const std::ptrdiff_t* slot)
+      {
+         return static_cast<const Node*>(
+                    reinterpret_cast<const hash_node_base<index_type>*>(
+                        reinterpret_cast<const char*>(slot) + *slot))
+             ->_item;
+      }
+      template <typename K>
+      static std::size_t hash(const K& k)
+      {
+         return hasher{}(k);
+      }
+      // Fibonacci hashing spreads weak hashes, such as the identity, over the table
+      std::size_t home(std::size_t h) const
+      {
+         return (uint64_t(h) * 0x9e37'79b9'7f4a'7c15) >> _shift;
+      }
+      std::ptrdiff_t* slots() const { return _capacity ? &*_slots : nullptr; }
+      const_iterator make_iterator(std::size_t i) const
+      {
+         return {slots() + i, slots() + _capacity};
+      }
+      void set_slot(std::size_t i, const value_type& v)
+      {
+         auto& hook = static_cast<const hash_node_base<index_type>&>(
+             static_cast<const Node&>(*boost::intrusive::get_parent_from_member(
+                 &v, &value_holder<value_type>::_item)));
+         slots()[i] = reinterpret_cast<const char*>(&hook) -
+                      reinterpret_cast<const char*>(slots() + i);
+      }
+      std::size_t slot_of(const value_type& v) const
+      {
+         for (auto i = home(get_hash(v));; i = (i + 1) & (_capacity - 1))
+            if (&to_value(slots() + i) == &v)
+               return i;
+      }
+      // Stores v, whose hash is already cached, in the first empty slot of its probe sequence
+      std::size_t place(value_type& v)
+      {
+         auto i = home(get_hash(v));
+         while (slots()[i])
+            i = (i + 1) & (_capacity - 1);
+         set_slot(i, v);
+         return i;
+      }
+      // Returns true if a node other than v has the same key as v
+      bool has_duplicate(const value_type& v) const
+      {
+         auto h = get_hash(v);
+         for (auto i = home(h); slots()[i]; i = (i + 1) & (_capacity - 1))
+         {
+            auto& other = to_value(slots() + i);
+            if (&other != &v && get_hash(other) == h &&
+                key_equal{}(key_from_value{}(other), key_from_value{}(v)))
+               return true;
+         }
+         return false;
+      }
+      void reserve(std::size_t size)
+      {
+         if (size * 4 <= _capacity * 3)
+            return;
+         auto capacity = _capacity ? _capacity * 2 : 16;
+         unsigned shift = 64;
+         for (auto c = capacity; c > 1; c /= 2)
+            --shift;
+         auto new_slots = slot_traits::allocate(_allocator, capacity);
+         std::fill_n(&*new_slots, capacity, 0);
+         auto old_slots = _slots;
+         auto old_capacity = _capacity;
+         _slots = new_slots;
+         _capacity = capacity;
+         _shift = shift;
+         for (std::size_t i = 0; i < old_capacity; ++i)
+            if (old_slots[i])
+               place(const_cast<value_type&>(to_value(&old_slots[i])));
+         if (old_capacity)
+            slot_traits::deallocate(_allocator, old_slots, old_capacity);
+      }
+
+      std::pair<const_iterator, bool> insert_unique(value_type& v)
+      {
+         auto existing = find(key_from_value{}(v));
+         if (existing != end())
+            return {existing, false};
+         reserve(_size + 1);
+         get_hash(v) = hash(key_from_value{}(v));
+         ++_size;
+         return {make_iterator(place(v)), true};
+      }
+      void insert_equal(value_type& v)
+      {
+         reserve(_size + 1);
+         get_hash(v) = hash(key_from_value{}(v));
+         ++_size;
+         place(v);
+      }
+      void erase(const_iterator it)
+      {
+         auto i = std::size_t(it._slot - slots());
+         for (auto j = (i + 1) & (_capacity - 1); slots()[j]; j = (j + 1) & (_capacity - 1))
+         {
+            // The node in slot j may fill the hole at i unless its probe sequence starts
+            // after i (cyclically) and at or before j
+            auto& v = to_value(slots() + j);
+            auto k = home(get_hash(v));
+            if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+               continue;
+            set_slot(i, v);
+            i = j;
+         }
+         slots()[i] = 0;
+         --_size;
+      }
+      void clear()
+      {
+         if (_capacity)
+            std::fill_n(slots(), _capacity, 0);
+         _size = 0;
+      }
+      // Moves v after its key may have changed. If unique and the new key conflicts with
+      // another node, v remains in the index and this returns false.
+      template <bool unique>
+      bool post_modify(value_type& v)
+      {
+         auto h = hash(key_from_value{}(v));
+         if (h != get_hash(v))
+         {
+            erase(iterator_to(v));
+            get_hash(v) = h;
+            ++_size;
+            place(v);
+         }
+         if constexpr (unique)
+            return !has_duplicate(v);
+         return true;
+      }
+
+      typename slot_traits::pointer _slots = nullptr;
+      std::size_t _capacity = 0;
+      std::size_t _size = 0;
+      unsigned _shift = 64;
+      slot_allocator _allocator;
+
+      template <typename U, typename Allocator, typename... Indices>
+      friend class undo_index;
+   };
+
+   // B+tree index over the nodes of an undo_index. Leaves hold sorted arrays of node pointers
+   // and are linked in order, so range scans walk contiguous memory instead of chasing tree
+   // hooks. Inner nodes route by the first node of each child. Each node's hook only records
+   // the leaf which holds it. Adjacent siblings are merged when one is less than a quarter
+   // full and they fit in one node.
+   //
+   // Unlike ordered_unique, insert and erase invalidate iterators into this index, and modify
+   // invalidates them if the key changes. Insert may allocate to split nodes, including
+   // when undo restores a node; allocation failure there terminates the program. The tree
+   // holds plain pointers, so the allocator must not be an interprocess allocator. Nodes are
+   // allocated with a default-constructed Node::allocator_type.
+   template <typename Node, typename... T>
+   struct set_impl<Node, btree_unique<T...>>
+   {
+      using index_type = btree_unique<T...>;
+      using value_type = typename Node::value_type;
+      using key_from_value =
+          get_key<typename index_type::key_from_value_type, typename Node::value_type>;
+      using key_type = typename key_from_value::type;
+      using key_compare = typename index_type::compare_type;
+
+      static constexpr uint32_t leaf_capacity = 64;
+      static constexpr uint32_t inner_capacity = 32;
+
+     private:
+      struct inner_node;
+      struct tree_node
+      {
+         inner_node* parent = nullptr;
+         uint32_t size = 0;
+      };
+      struct leaf_node : tree_node
+      {
+         leaf_node* prev = nullptr;
+         leaf_node* next = nullptr;
+         value_type* items[leaf_capacity];
+      };
+      struct inner_node : tree_node
+      {
+         bool leaf_children = false;
+         tree_node* children[inner_capacity];
+         const value_type* firsts[inner_capacity];  // first node under each child
+      };
+
+     public:
+      class const_iterator
+      {
+        public:
+         using iterator_category = std::bidirectional_iterator_tag;
+         using value_type = typename Node::value_type;
+         using difference_type = std::ptrdiff_t;
+         using pointer = const value_type*;
+         using reference = const value_type&;
+
+         const_iterator() = default;
+         reference operator*() const { return *_leaf->items[_pos]; }
+         pointer operator->() const { return _leaf->items[_pos]; }
+         const_iterator& operator++()
+         {
+            if (++_pos == _leaf->size)
+            {
+               _leaf = _leaf->next;
+               _pos = 0;
+            }
+            return *this;
+         }
+         const_iterator operator++(int)
+         {
+            auto result = *this;
+            ++*this;
+            return result;
+         }
+         const_iterator& operator--()
+         {
+            if (!_leaf)
+            {
+               _leaf = _index->_last;
+               _pos = _leaf->size - 1;
+            }
+            else if (_pos)
+               --_pos;
+            else
+            {
+               _leaf = _leaf->prev;
+               _pos = _leaf->size - 1;
+            }
+            return *this;
+         }
+         const_iterator operator--(int)
+         {
+            auto result = *this;
+            --*this;
+            return result;
+         }
+         friend bool operator==(const const_iterator& a, const const_iterator& b)
+         {
+            return a._leaf == b._leaf && a._pos == b._pos;
+         }
+         friend bool operator!=(const const_iterator& a, const const_iterator& b)
+         {
+            return !(a == b);
+         }
+
+        private:
+         friend struct set_impl;
+         const_iterator(const set_impl* index, leaf_node* leaf, uint32_t pos)
+             : _index{index}, _leaf{leaf}, _pos{pos}
+         {
+            if (_leaf && _pos == _leaf->size)
+            {
+               _leaf = _leaf->next;
+               _pos = 0;
+            }
+         }
+         const set_impl* _index = nullptr;
+         leaf_node* _leaf = nullptr;  // nullptr at end
+         uint32_t _pos = 0;
+      };
+      using iterator = const_iterator;
+      using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+      set_impl() = default;
+      set_impl(const set_impl&) = delete;
+      set_impl& operator=(const set_impl&) = delete;
+      ~set_impl() { clear(); }
+
+      template <typename K>
+      const_iterator find(K&& k) const
+      {
+         auto result = lower_bound(k);
+         if (result != end() && key_compare{}(k, key_from_value{}(*result)))
+            return end();
+         return result;
+      }
+      template <typename K>
+      const_iterator lower_bound(K&& k) const
+      {
+         return bound<false>(k);
+      }
+      template <typename K>
+      const_iterator upper_bound(K&& k) const
+      {
+         return bound<true>(k);
+      }
+      template <typename K>
+      std::pair<const_iterator, const_iterator> equal_range(K&& k) const
+      {
+         return {lower_bound(k), upper_bound(k)};
+      }
+      const_iterator begin() const { return {this, _first, 0}; }
+      const_iterator end() const { return {this, nullptr, 0}; }
+      const_reverse_iterator rbegin() const { return const_reverse_iterator{end()}; }
+      const_reverse_iterator rend() const { return const_reverse_iterator{begin()}; }
+      bool empty() const { return !_size; }
+      std::size_t size() const { return _size; }
+      const_iterator iterator_to(const value_type& v) const
+      {
+         auto leaf = leaf_of(v);
+         uint32_t pos = 0;
+         while (leaf->items[pos] != &v)
+            ++pos;
+         return {this, leaf, pos};
+      }
+
+     private:
+      using leaf_allocator = rebind_alloc_t<typename Node::allocator_type, leaf_node>;
+      using inner_allocator = rebind_alloc_t<typename Node::allocator_type, inner_node>;
+      using leaf_traits = std::allocator_traits<leaf_allocator>;
+      using inner_traits = std::allocator_traits<inner_allocator>;
+      static_assert(std::is_pointer_v<typename leaf_traits::pointer>,
+                    "btree_unique requires an allocator with plain pointers");
+
+      // Nodes allocated before an insert, so that the insert itself can't fail
+      struct spare_nodes
+      {
+         set_impl& index;
+         leaf_node* leaf = nullptr;
+         inner_node* inners = nullptr;  // linked through parent
+
+         explicit spare_nodes(set_impl& index) : index{index} {}
+         spare_nodes(const spare_nodes&) = delete;
+         ~spare_nodes()
+         {
+            if (leaf)
+               index.free_node(leaf);
+            while (inners)
+               index.free_node(std::exchange(inners, inners->parent));
+         }
+         leaf_node* take_leaf() { return std::exchange(leaf, nullptr); }
+         inner_node* take_inner()
+         {
+            auto result = std::exchange(inners, inners->parent);
+            result->parent = nullptr;
+            return result;
+         }
+      };
+
+      static leaf_node*& leaf_of(const value_type& v)
+      {
+         auto& hook = static_cast<btree_node_base<index_type>&>(static_cast<Node&>(
+             *boost::intrusive::get_parent_from_member(const_cast<value_type*>(&v),
+                                                       &value_holder<value_type>::_item)));
+         return reinterpret_cast<leaf_node*&>(hook._leaf);
+      }
+      static decltype(auto) key(const value_type& v) { return key_from_value{}(v); }
+      static uint32_t index_in_parent(const tree_node* n)
+      {
+         uint32_t i = 0;
+         while (n->parent->children[i] != n)
+            ++i;
+         return i;
+      }
+
+      // Returns the first position whose key is greater than k (upper) or not less than k
+      template <bool upper, typename K>
+      const_iterator bound(const K& k) const
+      {
+         if (!_root)
+            return end();
+         auto goes_after = [&](const value_type& v) {
+            if constexpr (upper)
+               return !key_compare{}(k, key(v));
+            else
+               return key_compare{}(key(v), k);
+         };
+         auto n = _root;
+         for (auto depth = _height; depth; --depth)
+         {
+            auto inner = static_cast<inner_node*>(n);
+            auto child = std::partition_point(
+                inner->firsts + 1, inner->firsts + inner->size,
+                [&](const value_type* first) { return goes_after(*first); });
+            n = inner->children[child - inner->firsts - 1];
+         }
+         auto leaf = static_cast<leaf_node*>(n);
+         auto pos = std::partition_point(leaf->items, leaf->items + leaf->size,
+                                         [&](const value_type* v) { return goes_after(*v); });
+         return {this, leaf, uint32_t(pos - leaf->items)};
+      }
+
+      template <typename N>
+      N* allocate_node()
+      {
+         if constexpr (std::is_same_v<N, leaf_node>)
+         {
+            leaf_allocator a;
+            auto result = leaf_traits::allocate(a, 1);
+            leaf_traits::construct(a, result);
+            return result;
+         }
+         else
+         {
+            inner_allocator a;
+            auto result = inner_traits::allocate(a, 1);
+            inner_traits::construct(a, result);
+            return result;
+         }
+      }
+      void free_node(leaf_node* n) noexcept
+      {
+         leaf_allocator a;
+         leaf_traits::destroy(a, n);
+         leaf_traits::deallocate(a, n, 1);
+      }
+      void free_node(inner_node* n) noexcept
+      {
+         inner_allocator a;
+         inner_traits::destroy(a, n);
+         inner_traits::deallocate(a, n, 1);
+      }
+
+      // Allocates the nodes which inserting into leaf may need
+      void reserve(spare_nodes& spares, leaf_node* leaf)
+      {
+         if (!leaf)
+         {
+            spares.leaf = allocate_node<leaf_node>();
+            return;
+         }
+         if (leaf->size < leaf_capacity)
+            return;
+         spares.leaf = allocate_node<leaf_node>();
+         for (tree_node* n = leaf;; n = n->parent)
+         {
+            if (n->parent && n->parent->size < inner_capacity)
+               return;
+            auto inner = allocate_node<inner_node>();
+            inner->parent = spares.inners;
+            spares.inners = inner;
+            if (!n->parent)
+               return;
+         }
+      }
+
+      // Inserts v before position pos of leaf, or as the only node if the tree is empty
+      const_iterator insert_at(leaf_node* leaf, uint32_t pos, value_type& v)
+      {
+         spare_nodes spares{*this};
+         reserve(spares, leaf);
+         if (!leaf)
+         {
+            leaf = spares.take_leaf();
+            _root = _first = _last = leaf;
+         }
+         else if (leaf->size == leaf_capacity)
+         {
+            auto right = spares.take_leaf();
+            constexpr auto half = leaf_capacity / 2;
+            for (uint32_t i = half; i < leaf_capacity; ++i)
+               leaf_of(*(right->items[i - half] = leaf->items[i])) = right;
+            leaf->size = half;
+            right->size = leaf_capacity - half;
+            right->prev = leaf;
+            right->next = leaf->next;
+            (leaf->next ? leaf->next->prev : _last) = right;
+            leaf->next = right;
+            insert_child(leaf, right, right->items[0], spares);
+            if (pos > half)
+            {
+               leaf = right;
+               pos -= half;
+            }
+         }
+         std::copy_backward(leaf->items + pos, leaf->items + leaf->size,
+                            leaf->items + leaf->size + 1);
+         leaf->items[pos] = &v;
+         ++leaf->size;
+         ++_size;
+         leaf_of(v) = leaf;
+         if (!pos)
+            set_first(leaf, &v);
+         return {this, leaf, pos};
+      }
+
+      // Adds right after left in left's parent, splitting as needed
+      void insert_child(tree_node* left, tree_node* right, const value_type* first,
+                        spare_nodes& spares)
+      {
+         auto parent = left->parent;
+         if (!parent)
+         {
+            parent = spares.take_inner();
+            parent->leaf_children = !_height;
+            parent->children[0] = left;
+            parent->firsts[0] = first_of(left);
+            parent->size = 1;
+            left->parent = parent;
+            _root = parent;
+            ++_height;
+         }
+         auto pos = index_in_parent(left) + 1;
+         if (parent->size == inner_capacity)
+         {
+            auto sibling = spares.take_inner();
+            constexpr auto half = inner_capacity / 2;
+            sibling->leaf_children = parent->leaf_children;
+            for (uint32_t i = half; i < inner_capacity; ++i)
+            {
+               sibling->children[i - half] = parent->children[i];
+               sibling->firsts[i - half] = parent->firsts[i];
+               parent->children[i]->parent = sibling;
+            }
+            parent->size = half;
+            sibling->size = inner_capacity - half;
+            insert_child(parent, sibling, sibling->firsts[0], spares);
+            if (pos > half)
+            {
+               parent = sibling;
+               pos -= half;
+            }
+         }
+         std::copy_backward(parent->children + pos, parent->children + parent->size,
+                            parent->children + parent->size + 1);
+         std::copy_backward(parent->firsts + pos, parent->firsts + parent->size,
+                            parent->firsts + parent->size + 1);
+         parent->children[pos] = right;
+         parent->firsts[pos] = first;
+         right->parent = parent;
+         ++parent->size;
+      }
+
+      const value_type* first_of(const tree_node* n) const
+      {
+         if (n->parent ? n->parent->leaf_children : !_height)
+            return static_cast<const leaf_node*>(n)->items[0];
+         return static_cast<const inner_node*>(n)->firsts[0];
+      }
+
+      // Records that first is now the first node under n
+      static void set_first(tree_node* n, const value_type* first)
+      {
+         for (; n->parent; n = n->parent)
+         {
+            auto i = index_in_parent(n);
+            n->parent->firsts[i] = first;
+            if (i)
+               break;
+         }
+      }
+
+      void erase_at(leaf_node* leaf, uint32_t pos)
+      {
+         std::copy(leaf->items + pos + 1, leaf->items + leaf->size, leaf->items + pos);
+         --leaf->size;
+         --_size;
+         if (!leaf->size)
+            return remove_node(leaf);
+         if (!pos)
+            set_first(leaf, leaf->items[0]);
+         if (leaf->size >= leaf_capacity / 4 || !leaf->parent)
+            return;
+         auto parent = leaf->parent;
+         auto i = index_in_parent(leaf);
+         if (i + 1 < parent->size)
+         {
+            auto right = static_cast<leaf_node*>(parent->children[i + 1]);
+            if (leaf->size + right->size <= leaf_capacity)
+               return merge_leaves(leaf, right);
+         }
+         if (i)
+         {
+            auto left = static_cast<leaf_node*>(parent->children[i - 1]);
+            if (left->size + leaf->size <= leaf_capacity)
+               return merge_leaves(left, leaf);
+         }
+      }
+
+      // Moves the contents of right to the end of left, then removes right
+      void merge_leaves(leaf_node* left, leaf_node* right)
+      {
+         for (uint32_t i = 0; i < right->size; ++i)
+            leaf_of(*(left->items[left->size + i] = right->items[i])) = left;
+         left->size += right->size;
+         right->size = 0;
+         remove_node(right);
+      }
+      void merge_inners(inner_node* left, inner_node* right)
+      {
+         for (uint32_t i = 0; i < right->size; ++i)
+         {
+            left->children[left->size + i] = right->children[i];
+            left->firsts[left->size + i] = right->firsts[i];
+            right->children[i]->parent = left;
+         }
+         left->size += right->size;
+         right->size = 0;
+         remove_node(right);
+      }
+
+      // Removes the empty node n from the tree and frees it
+      void remove_node(leaf_node* n)
+      {
+         (n->prev ? n->prev->next : _first) = n->next;
+         (n->next ? n->next->prev : _last) = n->prev;
+         remove_child(n);
+         free_node(n);
+      }
+      void remove_node(inner_node* n)
+      {
+         remove_child(n);
+         free_node(n);
+      }
+
+      // Removes n from its parent, rebalancing the parent
+      void remove_child(tree_node* n)
+      {
+         auto parent = n->parent;
+         if (!parent)
+         {
+            _root = nullptr;
+            _height = 0;
+            return;
+         }
+         auto i = index_in_parent(n);
+         std::copy(parent->children + i + 1, parent->children + parent->size,
+                   parent->children + i);
+         std::copy(parent->firsts + i + 1, parent->firsts + parent->size, parent->firsts + i);
+         --parent->size;
+         if (!parent->size)
+            return remove_node(parent);
+         if (!i)
+            set_first(parent, parent->firsts[0]);
+         if (!parent->parent)
+         {
+            if (parent->size == 1)
+            {
+               _root = parent->children[0];
+               _root->parent = nullptr;
+               --_height;
+               free_node(parent);
+            }
+            return;
+         }
+         if (parent->size >= inner_capacity / 4)
+            return;
+         auto grandparent = parent->parent;
+         auto j = index_in_parent(parent);
+         if (j + 1 < grandparent->size)
+         {
+            auto right = static_cast<inner_node*>(grandparent->children[j + 1]);
+            if (parent->size + right->size <= inner_capacity)
+               return merge_inners(parent, right);
+         }
+         if (j)
+         {
+            auto left = static_cast<inner_node*>(grandparent->children[j - 1]);
+            if (left->size + parent->size <= inner_capacity)
+               return merge_inners(left, parent);
+         }
+      }
+
+      // Returns the leaf and position at which to insert before it
+      std::pair<leaf_node*, uint32_t> insert_position(const_iterator it) const
+      {
+         if (it._leaf)
+            return {it._leaf, it._pos};
+         return {_last, _last ? _last->size : 0};
+      }
+
+      std::pair<const_iterator, bool> insert_unique(value_type& v)
+      {
+         auto it = lower_bound(key(v));
+         if (it != end() && !key_compare{}(key(v), key(*it)))
+            return {it, false};
+         auto [leaf, pos] = insert_position(it);
+         return {insert_at(leaf, pos, v), true};
+      }
+      void insert_equal(value_type& v)
+      {
+         auto [leaf, pos] = insert_position(upper_bound(key(v)));
+         insert_at(leaf, pos, v);
+      }
+      void erase(const_iterator it) { erase_at(it._leaf, it._pos); }
+      void free_subtree(tree_node* n, uint32_t height) noexcept
+      {
+         if (!height)
+            return free_node(static_cast<leaf_node*>(n));
+         auto inner = static_cast<inner_node*>(n);
+         for (uint32_t i = 0; i < inner->size; ++i)
+            free_subtree(inner->children[i], height - 1);
+         free_node(inner);
+      }
+      void clear() noexcept
+      {
+         if (_root)
+            free_subtree(_root, _height);
+         _root = nullptr;
+         _first = _last = nullptr;
+         _height = 0;
+         _size = 0;
+      }
+      // Moves v after its key may have changed. If unique and the new key conflicts with
+      // another node, v remains in the index and this returns false.
+      template <bool unique>
+      bool post_modify(value_type& v)
+      {
+         auto it = iterator_to(v);
+         auto next = it;
+         ++next;
+         if ((it == begin() || key_compare{}(key(*std::prev(it)), key(v))) &&
+             (next == end() || key_compare{}(key(v), key(*next))))
+            return true;
+         erase(it);
+         if constexpr (unique)
+         {
+            auto pos = lower_bound(key(v));
+            bool conflict = pos != end() && !key_compare{}(key(v), key(*pos));
+            auto [leaf, i] = insert_position(pos);
+            insert_at(leaf, i, v);
+            return !conflict;
+         }
+         else
+         {
+            insert_equal(v);
+            return true;
+         }
+      }
+
+      tree_node* _root = nullptr;
+      leaf_node* _first = nullptr;
+      leaf_node* _last = nullptr;
+      uint32_t _height = 0;  // number of inner levels
+      std::size_t _size = 0;
+
+      template <typename U, typename Allocator, typename... Indices>
+      friend class undo_index;
+   };
+
    template <typename T, typename S>
    class chainbase_node_allocator;
 
@@ -291,7 +1216,8 @@ namespace chainbase
    }
 
    // Similar to boost::multi_index_container with an undo stack.
-   // Indices should be instances of ordered_unique.
+   // Indices should be instances of ordered_unique, hashed_unique, or btree_unique. The first
+   // index must be an ordered_unique index on id.
    template <typename T, typename Allocator, typename... Indices>
    class undo_index
    {
@@ -300,7 +1226,8 @@ namespace chainbase
       using value_type = T;
       using allocator_type = Allocator;
 
-      static_assert((... && is_valid_index<Indices>), "Only ordered_unique indices are supported");
+      static_assert((... && is_valid_index<Indices>),
+                    "Only ordered_unique, hashed_unique and btree_unique indices are supported");
 
       undo_index() = default;
       explicit undo_index(const Allocator& a)
@@ -340,6 +1267,8 @@ namespace chainbase
 
       static_assert(std::is_same_v<typename index0_set_type::key_type, id_type>,
                     "first index must be id");
+      static_assert(is_intrusive_index<boost::mp11::mp_first<boost::mp11::mp_list<Indices...>>>,
+                    "first index must be ordered_unique");
 
       using index0_type = boost::mp11::mp_first<boost::mp11::mp_list<Indices...>>;
       struct old_node : hook<index0_type, Allocator>, value_holder<T>
@@ -476,6 +1405,14 @@ namespace chainbase
          if (!success)
             eosio::check(
                 false, "could not modify object, most likely a uniqueness constraint was violated");
+         if (backup && unchanged(obj, *backup))
+         {
+            // The modifier was a no-op; drop the backup so the undo stack doesn't grow and
+            // the object isn't reported as modified.
+            assert(backup == &_old_values.front());
+            to_node(obj)._mtime = to_old_node(*backup)._mtime;
+            _old_values.pop_front_and_dispose([this](pointer p) { dispose_old(*p); });
+         }
       }
 
       // Allows testing whether a value has been removed from the undo_index.
@@ -720,6 +1657,211 @@ namespace chainbase
                  {_removed_values.begin(), get_removed_values_end(_undo_stack.back())}};
       }
 
+      // Ids of the objects which changed since a revision, each sorted. An object which was
+      // created and then modified is only created, one which was modified and then removed is
+      // only removed, and one which was created and then removed isn't listed.
+      struct changes
+      {
+         std::vector<id_type> created;
+         std::vector<id_type> modified;
+         std::vector<id_type> removed;
+      };
+
+      // Returns the changes since the state at revision, or nullopt if revision is outside
+      // undo_stack_revision_range(). Committed changes are no longer tracked. Revisions are reused
+      // after undo, so a caller which keeps a revision across undos must check it still names
+      // the same state.
+      std::optional<changes> changes_since(int64_t revision) const
+      {
+         auto [begin, end] = undo_stack_revision_range();
+         if (revision < begin || revision > end)
+            return std::nullopt;
+         changes result;
+         if (revision == end)
+            return result;
+         auto& state = _undo_stack[revision - begin];
+         for (auto it = get<0>().lower_bound(state.old_next_id); it != get<0>().end(); ++it)
+            result.created.push_back(it->id);
+         for (auto it = _old_values.begin(), end = get_old_values_end(state); it != end; ++it)
+            if (it->id < state.old_next_id &&
+                get_removed_field(to_old_node(*it)._current->_item) != erased_flag)
+               result.modified.push_back(it->id);
+         for (auto it = _removed_values.begin(), end = get_removed_values_end(state); it != end;
+              ++it)
+            if (it->id < state.old_next_id)
+               result.removed.push_back(it->id);
+         for (auto* ids : {&result.modified, &result.removed})
+         {
+            std::sort(ids->begin(), ids->end());
+            ids->erase(std::unique(ids->begin(), ids->end()), ids->end());
+         }
+         return result;
+      }
+
+      // Memory the undo stack holds for one session: copies of the objects it modified, and
+      // the objects it removed. Bytes count nodes, not memory the objects own.
+      struct session_undo_stats
+      {
+         int64_t revision = 0;  // The revision the session produces
+         uint64_t old_values = 0;
+         uint64_t old_value_bytes = 0;
+         uint64_t removed_values = 0;
+         uint64_t removed_value_bytes = 0;
+      };
+
+      // Returns one entry per undo session, oldest first
+      std::vector<session_undo_stats> undo_stats() const
+      {
+         std::vector<session_undo_stats> result(_undo_stack.size());
+         auto begin = undo_stack_revision_range().first;
+         auto old_it = _old_values.begin();
+         auto removed_it = _removed_values.begin();
+         for (size_t i = _undo_stack.size(); i-- > 0;)
+         {
+            auto& stats = result[i];
+            stats.revision = begin + i + 1;
+            for (auto end = get_old_values_end(_undo_stack[i]); old_it != end; ++old_it)
+               ++stats.old_values;
+            for (auto end = get_removed_values_end(_undo_stack[i]); removed_it != end;
+                 ++removed_it)
+               ++stats.removed_values;
+            stats.old_value_bytes = stats.old_values * sizeof(old_node);
+            stats.removed_value_bytes = stats.removed_values * sizeof(node);
+         }
+         return result;
+      }
+
+      // Returns a revision r such that objects in the current committed state have an mtime
+      // of at most r. Call advance_snapshot_revision() before changing the committed state to
+      // make sure later changes get an mtime greater than r.
+      uint64_t snapshot_revision() const
+      {
+         if (!_undo_stack.empty())
+            return _undo_stack.front().ctime - 1;
+         return _monotonic_revision;
+      }
+
+      // Objects in the committed state which are created or modified after this call will
+      // have an mtime greater than the current snapshot_revision().
+      void advance_snapshot_revision()
+      {
+         if (_undo_stack.empty())
+            ++_monotonic_revision;
+      }
+
+      // The next id as of the committed state
+      id_type committed_next_id() const
+      {
+         if (_undo_stack.empty())
+            return _next_id;
+         return _undo_stack.front().old_next_id;
+      }
+
+      // Calls f(value, mtime) for each object in the committed state (the state which
+      // undo_all() would produce) in id order. This does not modify the undo stack.
+      template <typename F>
+      void for_each_committed(F&& f) const
+      {
+         if (_undo_stack.empty())
+         {
+            for (auto& v : get<0>())
+               f(v, to_node(v)._mtime);
+            return;
+         }
+
+         // Committed values of objects which were modified or removed. If an object has
+         // more than one backup which predates the undo stack, the oldest one wins.
+         auto& base = _undo_stack.front();
+         std::vector<std::pair<const value_type*, uint64_t>> backups;
+         for (auto it = _old_values.begin(), end = get_old_values_end(base); it != end; ++it)
+            if (to_old_node(*it)._mtime < base.ctime)
+               backups.emplace_back(&*it, to_old_node(*it)._mtime);
+         auto by_id = [](const auto& a, const auto& b) { return a.first->id < b.first->id; };
+         auto same_id = [](const auto& a, const auto& b) { return a.first->id == b.first->id; };
+         std::reverse(backups.begin(), backups.end());
+         std::stable_sort(backups.begin(), backups.end(), by_id);
+         backups.erase(std::unique(backups.begin(), backups.end(), same_id), backups.end());
+         auto num_modified = backups.size();
+         for (auto it = _removed_values.begin(), end = get_removed_values_end(base); it != end;
+              ++it)
+         {
+            std::pair<const value_type*, uint64_t> removed{&*it, to_node(*it)._mtime};
+            if (it->id < base.old_next_id &&
+                !std::binary_search(backups.begin(), backups.begin() + num_modified, removed,
+                                    by_id))
+               backups.push_back(removed);
+         }
+         std::sort(backups.begin(), backups.end(), by_id);
+
+         auto b = backups.begin();
+         for (auto& v : get<0>())
+         {
+            if (!(v.id < base.old_next_id))
+               break;
+            for (; b != backups.end() && b->first->id < v.id; ++b)
+               f(*b->first, b->second);
+            if (b != backups.end() && b->first->id == v.id)
+            {
+               f(*b->first, b->second);
+               ++b;
+            }
+            else
+               f(v, to_node(v)._mtime);
+         }
+         for (; b != backups.end(); ++b)
+            f(*b->first, b->second);
+      }
+
+      // Inserts an object with a specific id, or replaces the existing object with that id.
+      // This is intended for restoring snapshots and may not be used while there is an
+      // undo session.
+      template <typename Constructor>
+      const value_type& restore(id_type id, Constructor&& c)
+      {
+         if (!_undo_stack.empty())
+            eosio::check(false, "cannot restore objects while there is an existing undo stack");
+         if (auto* existing = find(id))
+         {
+            modify(*existing, [&](value_type& v) {
+               c(v);
+               v.id = id;
+            });
+            return *existing;
+         }
+         auto p = alloc_traits::allocate(_allocator, 1);
+         auto guard0 = scope_exit{[&] { alloc_traits::deallocate(_allocator, p, 1); }};
+         auto constructor = [&](value_type& v) {
+            c(v);
+            v.id = id;
+         };
+         alloc_traits::construct(_allocator, &*p, constructor, propagate_allocator(_allocator));
+         auto guard1 = scope_exit{[&] { alloc_traits::destroy(_allocator, &*p); }};
+         if (!insert_impl(p->_item))
+            eosio::check(
+                false, "could not insert object, most likely a uniqueness constraint was violated");
+         on_create(p->_item);
+         if (!(id < _next_id))
+         {
+            _next_id = id;
+            ++_next_id;
+         }
+         guard1.cancel();
+         guard0.cancel();
+         return p->_item;
+      }
+
+      // Finishes restoring a snapshot which was taken at snapshot_revision() == revision.
+      // Later changes get an mtime greater than revision.
+      void restore_revision(id_type next_id, uint64_t revision)
+      {
+         if (!_undo_stack.empty())
+            eosio::check(false, "cannot restore objects while there is an existing undo stack");
+         if (!empty() && !(get<0>().rbegin()->id < next_id))
+            eosio::check(false, "next id is too small");
+         _next_id = next_id;
+         _monotonic_revision = std::max(_monotonic_revision, revision + 1);
+      }
+
       auto begin() const { return get<0>().begin(); }
       auto end() const { return get<0>().end(); }
 
@@ -890,37 +2032,46 @@ namespace chainbase
          if constexpr (N < sizeof...(Indices))
          {
             auto& idx = std::get<N>(_indices);
-            auto iter = idx.iterator_to(p);
-            bool fixup = false;
-            if (iter != idx.begin())
+            using index = boost::mp11::mp_at_c<boost::mp11::mp_list<Indices...>, N>;
+            if constexpr (!is_intrusive_index<index>)
             {
-               auto copy = iter;
-               --copy;
-               if (!idx.value_comp()(*copy, p))
-                  fixup = true;
+               if (!idx.template post_modify<unique>(p))
+                  return false;
             }
-            ++iter;
-            if (iter != idx.end())
-            {
-               if (!idx.value_comp()(p, *iter))
-                  fixup = true;
-            }
-            if (fixup)
+            else
             {
-               auto iter2 = idx.iterator_to(p);
-               idx.erase(iter2);
-               if constexpr (unique)
+               auto iter = idx.iterator_to(p);
+               bool fixup = false;
+               if (iter != idx.begin())
                {
-                  auto [new_pos, inserted] = idx.insert_unique(p);
-                  if (!inserted)
-                  {
-                     idx.insert_before(new_pos, p);
-                     return false;
-                  }
+                  auto copy = iter;
+                  --copy;
+                  if (!idx.value_comp()(*copy, p))
+                     fixup = true;
                }
-               else
+               ++iter;
+               if (iter != idx.end())
                {
-                  idx.insert_equal(p);
+                  if (!idx.value_comp()(p, *iter))
+                     fixup = true;
+               }
+               if (fixup)
+               {
+                  auto iter2 = idx.iterator_to(p);
+                  idx.erase(iter2);
+                  if constexpr (unique)
+                  {
+                     auto [new_pos, inserted] = idx.insert_unique(p);
+                     if (!inserted)
+                     {
+                        idx.insert_before(new_pos, p);
+                        return false;
+                     }
+                  }
+                  else
+                  {
+                     idx.insert_equal(p);
+                  }
                }
             }
             return post_modify<unique, N + 1>(p);
@@ -941,16 +2092,16 @@ namespace chainbase
 
       void on_create(const value_type& value) noexcept
       {
-         if (!_undo_stack.empty())
-         {
-            // Not in old_values, removed_values, or new_ids
-            to_node(value)._mtime = _monotonic_revision;
-         }
+         // If there's an undo session, this is not in old_values, removed_values, or new_ids.
+         // Otherwise the mtime is tracked for snapshot_revision().
+         to_node(value)._mtime = _monotonic_revision;
       }
 
       value_type* on_modify(const value_type& obj)
       {
-         if (!_undo_stack.empty())
+         if (_undo_stack.empty())
+            to_node(obj)._mtime = _monotonic_revision;
+         else
          {
             auto& undo_info = _undo_stack.back();
             if (to_node(obj)._mtime >= undo_info.ctime)
@@ -982,6 +2133,17 @@ namespace chainbase
             clear_impl<N + 1>();
          }
       }
+      // Whether a modify left obj byte-identical to old. Objects which are neither trivially
+      // copyable nor equality comparable are assumed to have changed.
+      static bool unchanged(const value_type& obj, const value_type& old)
+      {
+         if constexpr (std::is_trivially_copyable_v<value_type>)
+            return !memcmp(&obj, &old, sizeof(value_type));
+         else if constexpr (std::equality_comparable<value_type>)
+            return obj == old;
+         else
+            return false;
+      }
       void dispose_node(node& node_ref) noexcept
       {
          node* p{&node_ref};
@@ -1031,6 +2193,10 @@ namespace chainbase
          return static_cast<old_node&>(
              *boost::intrusive::get_parent_from_member(&obj, &value_holder<value_type>::_item));
       }
+      static const old_node& to_old_node(const value_type& obj)
+      {
+         return to_old_node(const_cast<value_type&>(obj));
+      }
 
       auto get_old_values_end(const undo_state& info)
       {
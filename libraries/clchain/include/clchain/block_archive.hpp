@@ -0,0 +1,24 @@
+#pragma once
+
+#include <eosio/stream.hpp>
+
+namespace subchain
+{
+   // Storage for serialized blocks which have been trimmed out of block_log::blocks.
+   // Block numbers in an archive are contiguous: [begin_num(), end_num()).
+   class block_archive
+   {
+     public:
+      virtual ~block_archive() {}
+
+      virtual uint32_t begin_num() const = 0;
+      virtual uint32_t end_num() const = 0;
+
+      // Returns the serialized block_with_id. The stream points into the archive's
+      // storage and remains valid until the next get or append.
+      virtual eosio::input_stream get(uint32_t num) const = 0;
+
+      // num must be end_num(), or any number if the archive is empty
+      virtual void append(uint32_t num, const char* data, size_t size) = 0;
+   };
+}  // namespace subchain
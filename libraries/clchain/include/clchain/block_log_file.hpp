@@ -0,0 +1,52 @@
+#pragma once
+
+#include <clchain/block_archive.hpp>
+
+#include <string>
+
+namespace subchain
+{
+   // Append-only block_archive backed by two files in a directory:
+   //
+   // blocks.log:    records of [uint32_t size][serialized block_with_id]
+   // blocks.index:  [uint32_t magic][uint32_t begin_num] followed by one uint64_t
+   //                offset into blocks.log per block
+   //
+   // Both files are memory mapped read-only; get() returns a view into the
+   // mapping without copying. Reopening the directory resumes where the
+   // previous process left off. A record which was only partially written
+   // (e.g. the process was killed) is discarded on open.
+   class block_log_file : public block_archive
+   {
+     public:
+      explicit block_log_file(const std::string& dir);
+      block_log_file(const block_log_file&) = delete;
+      ~block_log_file();
+
+      block_log_file& operator=(const block_log_file&) = delete;
+
+      uint32_t begin_num() const override { return _begin_num; }
+      uint32_t end_num() const override { return _begin_num + _num_blocks; }
+      eosio::input_stream get(uint32_t num) const override;
+      void append(uint32_t num, const char* data, size_t size) override;
+
+     private:
+      struct mapping
+      {
+         const char* data = nullptr;
+         size_t size = 0;
+      };
+
+      void map(mapping& m, int fd, size_t size) const;
+      void unmap(mapping& m) const;
+      const char* index_pos() const;
+
+      int _log_fd = -1;
+      int _index_fd = -1;
+      uint32_t _begin_num = 1;
+      uint32_t _num_blocks = 0;
+      uint64_t _log_size = 0;
+      mutable mapping _log;
+      mutable mapping _index;
+   };
+}  // namespace subchain
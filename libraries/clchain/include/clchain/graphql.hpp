@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cctype>
 #include <charconv>
 #include <eosio/asset.hpp>
@@ -127,28 +128,63 @@ namespace clchain
          return generate_gql_partial_name((Raw*)nullptr) + "!";
    }
 
+   // Binary type of the scalar which Raw holds after unwrapping optionals, pointers and
+   // containers, or nullptr if it holds an object
+   template <typename Raw>
+   const char* get_gql_bin_type_name(Raw*)
+   {
+      using T = eosio::remove_cvref_t<Raw>;
+      if constexpr (eosio::is_std_optional<T>() || eosio::is_serializable_container<T>())
+         return get_gql_bin_type_name((typename T::value_type*)nullptr);
+      else if constexpr (std::is_pointer<T>())
+         return get_gql_bin_type_name((std::remove_const_t<std::remove_pointer_t<T>>*)nullptr);
+      else if constexpr (eosio::is_std_unique_ptr<T>())
+         return get_gql_bin_type_name((typename T::element_type*)nullptr);
+      else if constexpr (eosio::is_std_reference_wrapper<T>())
+         return get_gql_bin_type_name((typename T::type*)nullptr);
+      else if constexpr (eosio::reflection::has_for_each_field_v<T> && !has_get_gql_name<T>::value)
+         return nullptr;
+      else
+      {
+         using eosio::get_type_name;
+         return get_type_name((T*)nullptr);
+      }
+   }
+
+   // Writes " @bin(type: ...)" for fields which hold scalars
+   template <typename Raw, typename S>
+   void write_gql_bin_directive(Raw*, S& stream)
+   {
+      if (auto name = get_gql_bin_type_name((Raw*)nullptr))
+      {
+         write_str(" @bin(type: \"", stream);
+         write_str(name, stream);
+         write_str("\")", stream);
+      }
+   }
+
    template <typename Raw, typename S>
-   void fill_gql_schema(Raw*, S& stream, std::set<std::type_index>& defined_types)
+   void fill_gql_schema(Raw*, S& stream, std::set<std::type_index>& defined_types, bool bin_types)
    {
       using T = eosio::remove_cvref_t<Raw>;
       if constexpr (eosio::is_std_optional<T>())
-         fill_gql_schema((typename T::value_type*)nullptr, stream, defined_types);
+         fill_gql_schema((typename T::value_type*)nullptr, stream, defined_types, bin_types);
       else if constexpr (std::is_pointer<T>())
          fill_gql_schema((std::remove_const_t<std::remove_pointer_t<T>>*)nullptr, stream,
-                         defined_types);
+                         defined_types, bin_types);
       else if constexpr (eosio::is_std_unique_ptr<T>())
-         fill_gql_schema((typename T::element_type*)nullptr, stream, defined_types);
+         fill_gql_schema((typename T::element_type*)nullptr, stream, defined_types, bin_types);
       else if constexpr (eosio::is_std_reference_wrapper<T>())
-         fill_gql_schema((typename T::type*)nullptr, stream, defined_types);
+         fill_gql_schema((typename T::type*)nullptr, stream, defined_types, bin_types);
       else if constexpr (eosio::is_serializable_container<T>())
-         fill_gql_schema((typename T::value_type*)nullptr, stream, defined_types);
+         fill_gql_schema((typename T::value_type*)nullptr, stream, defined_types, bin_types);
       else if constexpr (eosio::reflection::has_for_each_field_v<T> && !has_get_gql_name<T>::value)
       {
          if (defined_types.insert(typeid(T)).second)
          {
             eosio::for_each_field<T>([&](const char*, auto member) {
                fill_gql_schema((eosio::remove_cvref_t<decltype(member((T*)nullptr))>*)nullptr,
-                               stream, defined_types);
+                               stream, defined_types, bin_types);
             });
             eosio::for_each_method<T>([&](const char* name, auto member, auto... arg_names) {
                using mf = eosio::member_fn<decltype(member)>;
@@ -157,22 +193,23 @@ namespace clchain
                {
                   eosio::for_each_named_type(
                       [&](auto* p, const char*) {  //
-                         fill_gql_schema(p, stream, defined_types);
+                         fill_gql_schema(p, stream, defined_types, bin_types);
                       },
                       typename mf::arg_types{}, arg_names...);
-                  fill_gql_schema((ret*)nullptr, stream, defined_types);
+                  fill_gql_schema((ret*)nullptr, stream, defined_types, bin_types);
                }
             });
             write_str("type ", stream);
             write_str(generate_gql_partial_name((Raw*)nullptr), stream);
             write_str(" {\n", stream);
             eosio::for_each_field<T>([&](const char* name, auto member) {
+               using type = eosio::remove_cvref_t<decltype(member((T*)nullptr))>;
                write_str("    ", stream);
                write_str(name, stream);
                write_str(": ", stream);
-               write_str(generate_gql_whole_name(
-                             (eosio::remove_cvref_t<decltype(member((T*)nullptr))>*)nullptr),
-                         stream);
+               write_str(generate_gql_whole_name((type*)nullptr), stream);
+               if (bin_types)
+                  write_gql_bin_directive((type*)nullptr, stream);
                write_str("\n", stream);
             });
             eosio::for_each_method<T>([&](const char* name, auto member, auto... arg_names) {
@@ -200,6 +237,8 @@ namespace clchain
                   }
                   write_str(": ", stream);
                   write_str(generate_gql_whole_name((ret*)nullptr), stream);
+                  if (bin_types)
+                     write_gql_bin_directive((ret*)nullptr, stream);
                   write_str("\n", stream);
                }
             });
@@ -208,21 +247,25 @@ namespace clchain
       }
    }
 
+   // If bin_types is set, fields which hold scalars are annotated with their binary types for
+   // clients of gql_query_bin
    template <typename Raw, typename S>
-   void fill_gql_schema(Raw*, S& stream)
+   void fill_gql_schema(Raw*, S& stream, bool bin_types = false)
    {
       std::set<std::type_index> defined_types;
-      fill_gql_schema((Raw*)nullptr, stream, defined_types);
+      if (bin_types)
+         write_str("directive @bin(type: String!) on FIELD_DEFINITION\n", stream);
+      fill_gql_schema((Raw*)nullptr, stream, defined_types, bin_types);
    }
 
    template <typename T>
-   std::string get_gql_schema(T* p = nullptr)
+   std::string get_gql_schema(T* p = nullptr, bool bin_types = false)
    {
       eosio::size_stream ss;
-      fill_gql_schema((T*)nullptr, ss);
+      fill_gql_schema((T*)nullptr, ss, bin_types);
       std::string result(ss.size, 0);
       eosio::fixed_buf_stream fbs(result.data(), result.size());
-      fill_gql_schema((T*)nullptr, fbs);
+      fill_gql_schema((T*)nullptr, fbs, bin_types);
       eosio::check(fbs.pos == fbs.end, eosio::convert_stream_error(eosio::stream_error::underrun));
       return result;
    }
@@ -559,6 +602,35 @@ namespace clchain
       }
    }
 
+   inline constexpr uint32_t gql_no_field = ~uint32_t(0);
+
+   // Returns the position within eosio_for_each_field of the field or const method of T which
+   // queries select as name, or gql_no_field. The names are sorted once per type, so lookups
+   // are binary searches instead of a walk over every field.
+   template <typename T>
+   uint32_t gql_field_index(std::string_view name)
+   {
+      static const auto fields = [] {
+         std::vector<std::pair<std::string_view, uint32_t>> result;
+         uint32_t index = 0;
+         eosio_for_each_field((T*)nullptr, [&](std::string_view name, auto&& member, auto...) {
+            using member_type = decltype(member((T*)nullptr));
+            if constexpr (!eosio::is_non_const_member_fn<member_type>())
+               result.emplace_back(name, index);
+            ++index;
+         });
+         std::stable_sort(result.begin(), result.end(),
+                          [](auto& a, auto& b) { return a.first < b.first; });
+         return result;
+      }();
+      auto it = std::lower_bound(fields.begin(), fields.end(), name, [](auto& field, auto name) {
+         return field.first < name;
+      });
+      if (it == fields.end() || it->first != name)
+         return gql_no_field;
+      return it->second;
+   }
+
    template <typename T, typename OS, typename E>
    auto gql_query(const T& value, gql_stream& input_stream, OS& output_stream, const E& error)
        -> std::enable_if_t<std::is_arithmetic_v<T> || std::is_same_v<T, std::string>, bool>
@@ -629,7 +701,6 @@ namespace clchain
       output_stream.write('{');
       while (input_stream.current_type == gql_stream::name)
       {
-         bool found = false;
          bool ok = true;
          auto alias = input_stream.current_value;
          auto field_name = alias;
@@ -642,80 +713,78 @@ namespace clchain
             field_name = input_stream.current_value;
             input_stream.skip();
          }
-         eosio_for_each_field((T*)nullptr, [&](std::string_view name, auto&& member,
+         auto field_index = gql_field_index<T>(field_name);
+         if (field_index == gql_no_field)
+            return error((std::string)field_name + " not found");
+         uint32_t index = 0;
+         eosio_for_each_field((T*)nullptr, [&](std::string_view, auto&& member,
                                                auto... arg_names) {
             using member_type = decltype(member((T*)nullptr));
+            if (index++ != field_index)
+               return;
             if constexpr (eosio::is_non_const_member_fn<member_type>())
                return;
             else
             {
-               if (found)
-                  return;
-               if (name == field_name)
+               if (first)
                {
-                  found = true;
-                  if (first)
-                  {
-                     increase_indent(output_stream);
-                     first = false;
-                  }
-                  else
-                     output_stream.write(',');
-                  write_newline(output_stream);
-                  to_json(alias, output_stream);
-                  write_colon(output_stream);
-                  if constexpr (std::is_member_object_pointer_v<member_type>)
-                  {
-                     if (!gql_query(value.*member(&value), input_stream, output_stream, error))
-                        ok = false;
-                  }
-                  else
+                  increase_indent(output_stream);
+                  first = false;
+               }
+               else
+                  output_stream.write(',');
+               write_newline(output_stream);
+               to_json(alias, output_stream);
+               write_colon(output_stream);
+               if constexpr (std::is_member_object_pointer_v<member_type>)
+               {
+                  if (!gql_query(value.*member(&value), input_stream, output_stream, error))
+                     ok = false;
+               }
+               else
+               {
+                  using mf = eosio::member_fn<member_type>;
+                  eosio::tuple_from_type_list<typename mf::arg_types> args;
+                  bool filled[mf::num_args] = {};
+                  if (input_stream.current_puncuator == '(')
                   {
-                     using mf = eosio::member_fn<member_type>;
-                     eosio::tuple_from_type_list<typename mf::arg_types> args;
-                     bool filled[mf::num_args] = {};
-                     if (input_stream.current_puncuator == '(')
+                     input_stream.skip();
+                     if (input_stream.current_puncuator == ')')
+                        return (ok = error("empty arg list")), void();
+                     while (input_stream.current_type == gql_stream::name)
                      {
-                        input_stream.skip();
-                        if (input_stream.current_puncuator == ')')
-                           return (ok = error("empty arg list")), void();
-                        while (input_stream.current_type == gql_stream::name)
-                        {
-                           bool found = false;
-                           if (!gql_parse_args<0>(args, filled, found, input_stream, error,
-                                                  arg_names...))
-                              return (ok = false), void();
-                           if (!found)
-                              return (ok = error("unknown arg '" +
-                                                 (std::string)input_stream.current_value + "'")),
-                                     void();
-                        }
-                        if (input_stream.current_puncuator != ')')
-                           return (ok = error("expected )")), void();
-                        input_stream.skip();
+                        bool found = false;
+                        if (!gql_parse_args<0>(args, filled, found, input_stream, error,
+                                               arg_names...))
+                           return (ok = false), void();
+                        if (!found)
+                           return (ok = error("unknown arg '" +
+                                              (std::string)input_stream.current_value + "'")),
+                                  void();
                      }
-                     gql_mark_optional<0>(args, filled);
-                     if constexpr (mf::num_args > 0)
-                        for (int i = 0; i < mf::num_args; ++i)
-                           if (!filled[i])
-                              return (ok = error("function missing required arg '" +
-                                                 std::string(std::data({arg_names...})[i]) + "'")),
-                                     void();
-                     auto result = std::apply(
-                         [&](auto&&... args) {
-                            return (value.*member(&value))(std::move(args)...);
-                         },
-                         args);
-                     if (!gql_query(result, input_stream, output_stream, error))
-                        return (ok = false), void();
+                     if (input_stream.current_puncuator != ')')
+                        return (ok = error("expected )")), void();
+                     input_stream.skip();
                   }
+                  gql_mark_optional<0>(args, filled);
+                  if constexpr (mf::num_args > 0)
+                     for (int i = 0; i < mf::num_args; ++i)
+                        if (!filled[i])
+                           return (ok = error("function missing required arg '" +
+                                              std::string(std::data({arg_names...})[i]) + "'")),
+                                  void();
+                  auto result = std::apply(
+                      [&](auto&&... args) {
+                         return (value.*member(&value))(std::move(args)...);
+                      },
+                      args);
+                  if (!gql_query(result, input_stream, output_stream, error))
+                     return (ok = false), void();
                }
             }
          });
          if (!ok)
             return false;
-         if (!found)
-            return error((std::string)field_name + " not found");
       }
       if (input_stream.current_puncuator != '}')
          return error("expected }");
@@ -771,60 +840,177 @@ namespace clchain
       return error("expected end of input");
    }
 
-   template <typename Stream = eosio::time_point_include_z_stream<eosio::string_stream>, typename T>
-   std::string gql_query(const T& value, std::string_view query, std::string_view variables)
+   // Responses written to gql_pretty_stream are indented for reading. Other streams get compact
+   // JSON: the indent and newline hooks do nothing and colons have no trailing space.
+   //
+   // Nesting eosio::pretty_stream and eosio::time_point_include_z_stream doesn't work, since
+   // each is detected by overloads on its exact type; this type supports both.
+   template <typename S>
+   struct gql_pretty_stream : eosio::pretty_stream<S>
+   {
+      using eosio::pretty_stream<S>::pretty_stream;
+   };
+
+   template <typename S>
+   constexpr bool time_point_include_z(const gql_pretty_stream<S>*)
+   {
+      return true;
+   }
+
+   template <typename S>
+   void increase_indent(gql_pretty_stream<S>& s)
+   {
+      eosio::increase_indent(static_cast<eosio::pretty_stream<S>&>(s));
+   }
+
+   template <typename S>
+   void decrease_indent(gql_pretty_stream<S>& s)
+   {
+      eosio::decrease_indent(static_cast<eosio::pretty_stream<S>&>(s));
+   }
+
+   template <typename S>
+   void write_colon(gql_pretty_stream<S>& s)
+   {
+      eosio::write_colon(static_cast<eosio::pretty_stream<S>&>(s));
+   }
+
+   template <typename S>
+   void write_newline(gql_pretty_stream<S>& s)
+   {
+      eosio::write_newline(static_cast<eosio::pretty_stream<S>&>(s));
+   }
+
+   // Writes a response containing the output of f(output_stream, error). If f fails, returns
+   // false with the message in error; output_stream then holds a partial response.
+   template <typename OS, typename F>
+   bool gql_write_response(OS& output_stream, std::string& error, F&& f)
    {
-      gql_stream input_stream{query};
-      std::string result;
-      Stream output_stream(result);
       output_stream.write('{');
       increase_indent(output_stream);
       write_newline(output_stream);
-      write_str("\"data\": ", output_stream);
+      write_str("\"data\"", output_stream);
+      write_colon(output_stream);
+      if (!f(output_stream, [&](const auto& e) {
+             error = e;
+             return false;
+          }))
+         return false;
+      decrease_indent(output_stream);
+      write_newline(output_stream);
+      output_stream.write('}');
+      return true;
+   }
+
+   template <typename OS>
+   void gql_write_error(OS& error_stream, const std::string& error)
+   {
+      error_stream.write('{');
+      increase_indent(error_stream);
+      write_newline(error_stream);
+      write_str("\"errors\"", error_stream);
+      write_colon(error_stream);
+      error_stream.write('{');
+      increase_indent(error_stream);
+      write_newline(error_stream);
+      write_str("\"message\"", error_stream);
+      write_colon(error_stream);
+      eosio::to_json(error, error_stream);
+      decrease_indent(error_stream);
+      write_newline(error_stream);
+      error_stream.write('}');
+      decrease_indent(error_stream);
+      write_newline(error_stream);
+      error_stream.write('}');
+   }
+
+   // Wraps the output of f(output_stream, error) in a response. If f fails, the response
+   // only contains the error.
+   template <typename Stream, typename F>
+   std::string gql_response(F&& f)
+   {
+      std::string result;
       std::string error;
-      bool ok = true;
-      if (!variables.empty())
-      {
-         error = "variables not supported; argument must be empty";
-         ok = false;
-      }
-      else
-         ok = gql_query_root(value, input_stream, output_stream, [&](const auto& e) {
-            error = e;
-            return false;
-         });
-      if (!ok)
+      Stream output_stream(result);
+      if (!gql_write_response(output_stream, error, f))
       {
          result.clear();
          Stream error_stream(result);
-         error_stream.write('{');
-         increase_indent(error_stream);
-         write_newline(error_stream);
-         write_str("\"errors\": {", error_stream);
-         increase_indent(error_stream);
-         write_newline(error_stream);
-         write_str("\"message\": ", error_stream);
-         eosio::to_json(error, error_stream);
-         decrease_indent(error_stream);
-         write_newline(error_stream);
-         error_stream.write('}');
-         decrease_indent(error_stream);
-         write_newline(error_stream);
-         error_stream.write('}');
-         return result;
+         gql_write_error(error_stream, error);
       }
-      decrease_indent(output_stream);
-      write_newline(output_stream);
-      output_stream.write('}');
       return result;
    }
 
-   template <typename T>
-   std::string format_gql_query(const T& value, std::string_view query)
+   // Output stream which passes its output to flush(data, size) in chunks of chunk_size
+   // bytes. finish() passes what remains.
+   template <typename F>
+   struct chunked_stream
+   {
+      F flush_chunk;
+      size_t chunk_size;
+      std::vector<char> buffer;
+      size_t num_flushed = 0;
+
+      chunked_stream(size_t chunk_size, F flush_chunk)
+          : flush_chunk(std::forward<F>(flush_chunk)), chunk_size(std::max(chunk_size, size_t(1)))
+      {
+         buffer.reserve(this->chunk_size);
+      }
+
+      void write(char c)
+      {
+         buffer.push_back(c);
+         if (buffer.size() >= chunk_size)
+            finish();
+      }
+
+      void write(const void* src, std::size_t sz)
+      {
+         auto s = reinterpret_cast<const char*>(src);
+         while (sz)
+         {
+            auto n = std::min(sz, chunk_size - buffer.size());
+            buffer.insert(buffer.end(), s, s + n);
+            s += n;
+            sz -= n;
+            if (buffer.size() >= chunk_size)
+               finish();
+         }
+      }
+
+      template <typename T>
+      void write_raw(const T& v)
+      {
+         write(&v, sizeof(v));
+      }
+
+      void finish()
+      {
+         if (buffer.empty())
+            return;
+         flush_chunk(buffer.data(), buffer.size());
+         num_flushed += buffer.size();
+         buffer.clear();
+      }
+   };
+
+   // Like gql_response, but passes the response to flush(data, size) in chunks of up to
+   // chunk_size bytes. If f fails before anything was flushed, the error response is passed
+   // instead. If f fails later, returns false with the message in error; the response which
+   // was passed is incomplete.
+   template <template <typename> typename Stream, typename Flush, typename F>
+   bool gql_response_chunked(size_t chunk_size, Flush&& flush, std::string& error, F&& f)
    {
-      return gql_query<
-          eosio::time_point_include_z_stream<eosio::pretty_stream<eosio::string_stream>>>(value,
-                                                                                          query);
+      Stream<chunked_stream<Flush&>> output_stream(chunk_size, flush);
+      if (!gql_write_response(output_stream, error, f))
+      {
+         if (output_stream.num_flushed)
+            return false;
+         output_stream.buffer.clear();
+         gql_write_error(output_stream, error);
+      }
+      output_stream.finish();
+      return true;
    }
 }  // namespace clchain
 
@@ -62,14 +62,21 @@ namespace clchain
       EOSIO_REFLECT2_FOR_EACH_FIELD(Connection<Config>, edges, pageInfo)
    }
 
-   // To enable cursors to function correctly, container must not have duplicate keys
+   // To enable cursors to function correctly, container must not have duplicate keys.
+   //
+   // Only objects for which filter returns true become edges. At most max_scan objects are
+   // examined; if the limit stops the scan early, then the page has fewer edges than requested
+   // and hasNextPage (or hasPreviousPage when paging backwards) is true. If the last object
+   // examined was filtered out, endCursor (startCursor) refers to it, so that the next page
+   // resumes the scan from there.
    template <typename Connection,
              typename Key,
              typename T,
              typename To_key,
              typename To_node,
              typename Lower_bound,
-             typename Upper_bound>
+             typename Upper_bound,
+             typename Filter>
    Connection make_connection(const std::optional<Key>& gt,
                               const std::optional<Key>& ge,
                               const std::optional<Key>& lt,
@@ -82,7 +89,9 @@ namespace clchain
                               To_key&& to_key,
                               To_node&& to_node,
                               Lower_bound&& lower_bound,
-                              Upper_bound&& upper_bound)
+                              Upper_bound&& upper_bound,
+                              Filter&& filter,
+                              uint32_t max_scan)
    {
       auto compare_it = [&](const auto& a, const auto& b) {
          if (a == container.end())
@@ -123,25 +132,52 @@ namespace clchain
       end = std::max(it, end, compare_it);
 
       Connection result;
-      auto add_edge = [&](const auto& it) {
+      auto to_cursor = [&](const auto& it) {
          auto bin = eosio::convert_to_bin(to_key(*it));
-         auto cursor = eosio::hex(bin.begin(), bin.end());
-         result.edges.push_back(Edge<typename Connection::config>{to_node(*it), std::move(cursor)});
+         return eosio::hex(bin.begin(), bin.end());
+      };
+      auto add_edge = [&](const auto& it) {
+         result.edges.push_back(Edge<typename Connection::config>{to_node(*it), to_cursor(it)});
       };
 
+      uint32_t num_scanned = 0;
       if (last && !first)
       {
+         bool skipped_last = false;
          result.pageInfo.hasNextPage = end != rangeEnd;
-         for (; it != end && (*last)-- > 0; --end)
-            add_edge(std::prev(end));
+         for (; it != end && *last > 0 && num_scanned < max_scan; --end, ++num_scanned)
+         {
+            skipped_last = !filter(*std::prev(end));
+            if (!skipped_last)
+            {
+               add_edge(std::prev(end));
+               --*last;
+            }
+         }
          result.pageInfo.hasPreviousPage = end != rangeBegin;
          std::reverse(result.edges.begin(), result.edges.end());
+         if (!result.edges.empty())
+         {
+            result.pageInfo.startCursor = result.edges.front().cursor;
+            result.pageInfo.endCursor = result.edges.back().cursor;
+         }
+         if (skipped_last)
+            result.pageInfo.startCursor = to_cursor(end);
       }
       else
       {
+         bool skipped_last = false;
          result.pageInfo.hasPreviousPage = it != rangeBegin;
-         for (; it != end && (!first || (*first)-- > 0); ++it)
-            add_edge(it);
+         for (; it != end && (!first || *first > 0) && num_scanned < max_scan; ++it, ++num_scanned)
+         {
+            skipped_last = !filter(*it);
+            if (!skipped_last)
+            {
+               add_edge(it);
+               if (first)
+                  --*first;
+            }
+         }
          result.pageInfo.hasNextPage = it != rangeEnd;
          if (last && *last < result.edges.size())
          {
@@ -149,13 +185,40 @@ namespace clchain
             result.edges.erase(result.edges.begin(),
                                result.edges.begin() + (result.edges.size() - *last));
          }
-      }
-
-      if (!result.edges.empty())
-      {
-         result.pageInfo.startCursor = result.edges.front().cursor;
-         result.pageInfo.endCursor = result.edges.back().cursor;
+         if (!result.edges.empty())
+         {
+            result.pageInfo.startCursor = result.edges.front().cursor;
+            result.pageInfo.endCursor = result.edges.back().cursor;
+         }
+         if (skipped_last)
+            result.pageInfo.endCursor = to_cursor(std::prev(it));
       }
       return result;
    }
+
+   template <typename Connection,
+             typename Key,
+             typename T,
+             typename To_key,
+             typename To_node,
+             typename Lower_bound,
+             typename Upper_bound>
+   Connection make_connection(const std::optional<Key>& gt,
+                              const std::optional<Key>& ge,
+                              const std::optional<Key>& lt,
+                              const std::optional<Key>& le,
+                              std::optional<uint32_t> first,
+                              std::optional<uint32_t> last,
+                              const std::optional<std::string>& before,
+                              const std::optional<std::string>& after,
+                              const T& container,
+                              To_key&& to_key,
+                              To_node&& to_node,
+                              Lower_bound&& lower_bound,
+                              Upper_bound&& upper_bound)
+   {
+      return make_connection<Connection, Key>(
+          gt, ge, lt, le, first, last, before, after, container, to_key, to_node, lower_bound,
+          upper_bound, [](const auto&) { return true; }, ~uint32_t(0));
+   }
 }  // namespace clchain
@@ -0,0 +1,780 @@
+#pragma once
+
+#include <clchain/graphql.hpp>
+#include <eosio/to_bin.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+namespace clchain
+{
+   // A selected field within a gql_plan. index is the field's position within
+   // eosio_for_each_field for the type containing it.
+   struct gql_plan_field
+   {
+      std::string alias;
+      uint32_t index = 0;
+
+      // Method args: a std::tuple holding the values given as literals. Args given as
+      // variables are listed in variables and are bound on each execution.
+      std::shared_ptr<const void> args;
+      std::vector<std::pair<uint32_t, std::string>> variables;
+
+      // Selection set of the field's type, after unwrapping optionals, pointers and containers
+      std::vector<gql_plan_field> selections;
+   };
+
+   // A query which has been parsed and checked against a root type by gql_prepare(). Executing
+   // it doesn't re-tokenize the query or look up fields by name.
+   struct gql_plan
+   {
+      std::string query;
+      std::vector<std::string> variables;
+      std::vector<gql_plan_field> selections;
+      std::string error;
+   };
+
+   // Variable values from a JSON object. Values refer to the JSON text.
+   struct gql_variables
+   {
+      std::vector<std::pair<std::string_view, gql_stream>> values;
+
+      const gql_stream* find(std::string_view name) const
+      {
+         for (auto& [n, value] : values)
+            if (n == name)
+               return &value;
+         return nullptr;
+      }
+   };
+
+   // Only scalar values are supported; JSON scalars tokenize the same as GraphQL scalars
+   template <typename E>
+   bool gql_parse_variables(std::string_view json, gql_variables& variables, const E& error)
+   {
+      gql_stream input_stream{json};
+      if (input_stream.current_type == gql_stream::eof)
+         return true;
+      if (input_stream.current_puncuator != '{')
+         return error("expected variables object");
+      input_stream.skip();
+      while (input_stream.current_type == gql_stream::string)
+      {
+         auto name = input_stream.current_value;
+         input_stream.skip();
+         if (input_stream.current_puncuator != ':')
+            return error("expected : in variables");
+         input_stream.skip();
+         if (input_stream.current_type != gql_stream::string &&
+             input_stream.current_type != gql_stream::integer &&
+             input_stream.current_type != gql_stream::floating &&
+             input_stream.current_type != gql_stream::name)
+            return error("variable '" + std::string(name) + "' must be a scalar");
+         variables.values.emplace_back(name, input_stream);
+         input_stream.skip();
+      }
+      if (input_stream.current_puncuator != '}')
+         return error("expected } in variables");
+      input_stream.skip();
+      if (input_stream.current_type != gql_stream::eof)
+         return error("expected end of variables");
+      return true;
+   }
+
+   template <typename T>
+   constexpr bool gql_is_object()
+   {
+      return eosio::reflection::has_for_each_field_v<T> && !has_get_gql_name<T>::value;
+   }
+
+   template <int i, typename... Args, typename E, typename... Arg_names>
+   bool gql_plan_args(std::tuple<Args...>& args,
+                      bool filled[],
+                      bool& found,
+                      gql_plan_field& field,
+                      const std::vector<std::string>& variables,
+                      gql_stream& input_stream,
+                      const E& error,
+                      const char* arg_name,
+                      Arg_names... arg_names)
+   {
+      constexpr bool is_optional =
+          eosio::is_std_optional<eosio::remove_cvref_t<decltype(std::get<i>(args))>>();
+      if (input_stream.current_value != arg_name)
+         return gql_plan_args<i + 1>(args, filled, found, field, variables, input_stream, error,
+                                     arg_names...);
+      input_stream.skip();
+      if (input_stream.current_puncuator != ':')
+         return error("expected :");
+      if (filled[i])
+         return error("duplicate arg");
+      input_stream.skip();
+      if (input_stream.current_puncuator == '$')
+      {
+         input_stream.skip();
+         if (input_stream.current_type != gql_stream::name)
+            return error("expected variable name");
+         if (std::find(variables.begin(), variables.end(), input_stream.current_value) ==
+             variables.end())
+            return error("variable '$" + std::string(input_stream.current_value) +
+                         "' is not defined");
+         field.variables.emplace_back(i, input_stream.current_value);
+         input_stream.skip();
+      }
+      else if constexpr (is_optional)
+      {
+         if (input_stream.current_type == gql_stream::name && input_stream.current_value == "null")
+            input_stream.skip();
+         else
+         {
+            std::get<i>(args).emplace();
+            if (!gql_parse_arg(*std::get<i>(args), input_stream, error))
+               return false;
+         }
+      }
+      else if (!gql_parse_arg(std::get<i>(args), input_stream, error))
+         return false;
+      filled[i] = true;
+      found = true;
+      return true;
+   }
+
+   template <int i, typename... Args, typename E>
+   bool gql_plan_args(std::tuple<Args...>& args,
+                      bool filled[],
+                      bool& found,
+                      gql_plan_field& field,
+                      const std::vector<std::string>& variables,
+                      gql_stream& input_stream,
+                      const E& error)
+   {
+      static_assert(i == sizeof...(Args), "mismatched arg names");
+      return true;
+   }
+
+   // Parses the selection set (if any) which applies to Raw
+   template <typename Raw, typename E>
+   bool gql_plan_selections(std::vector<gql_plan_field>& selections,
+                            const std::vector<std::string>& variables,
+                            gql_stream& input_stream,
+                            const E& error)
+   {
+      using T = eosio::remove_cvref_t<Raw>;
+      if constexpr (eosio::is_std_optional<T>() || eosio::is_serializable_container<T>())
+         return gql_plan_selections<typename T::value_type>(selections, variables, input_stream,
+                                                            error);
+      else if constexpr (std::is_pointer<T>())
+         return gql_plan_selections<std::remove_pointer_t<T>>(selections, variables,
+                                                              input_stream, error);
+      else if constexpr (eosio::is_std_unique_ptr<T>())
+         return gql_plan_selections<typename T::element_type>(selections, variables,
+                                                              input_stream, error);
+      else if constexpr (eosio::is_std_reference_wrapper<T>())
+         return gql_plan_selections<typename T::type>(selections, variables, input_stream,
+                                                      error);
+      else if constexpr (!gql_is_object<T>())
+         return true;
+      else
+      {
+         if (input_stream.current_puncuator != '{')
+            return error("expected {");
+         input_stream.skip();
+         while (input_stream.current_type == gql_stream::name)
+         {
+            bool ok = true;
+            auto alias = input_stream.current_value;
+            auto field_name = alias;
+            input_stream.skip();
+            if (input_stream.current_puncuator == ':')
+            {
+               input_stream.skip();
+               if (input_stream.current_type != gql_stream::name)
+                  return error("expected name after :");
+               field_name = input_stream.current_value;
+               input_stream.skip();
+            }
+            auto field_index = gql_field_index<T>(field_name);
+            if (field_index == gql_no_field)
+               return error((std::string)field_name + " not found");
+            uint32_t index = 0;
+            eosio_for_each_field((T*)nullptr, [&](std::string_view, auto&& member,
+                                                  auto... arg_names) {
+               using member_type = decltype(member((T*)nullptr));
+               if (index++ != field_index)
+                  return;
+               if constexpr (!eosio::is_non_const_member_fn<member_type>())
+               {
+                  auto& field = selections.emplace_back();
+                  field.alias = alias;
+                  field.index = field_index;
+                  if constexpr (std::is_member_object_pointer_v<member_type>)
+                  {
+                     using ret =
+                         eosio::remove_cvref_t<decltype(((T*)nullptr)->*member((T*)nullptr))>;
+                     ok = gql_plan_selections<ret>(field.selections, variables, input_stream,
+                                                   error);
+                  }
+                  else
+                  {
+                     using mf = eosio::member_fn<member_type>;
+                     using ret = eosio::remove_cvref_t<typename mf::return_type>;
+                     using args_type = eosio::tuple_from_type_list<typename mf::arg_types>;
+                     auto args = std::make_shared<args_type>();
+                     bool filled[mf::num_args] = {};
+                     if (input_stream.current_puncuator == '(')
+                     {
+                        input_stream.skip();
+                        if (input_stream.current_puncuator == ')')
+                           return (ok = error("empty arg list")), void();
+                        while (input_stream.current_type == gql_stream::name)
+                        {
+                           bool found = false;
+                           if (!gql_plan_args<0>(*args, filled, found, field, variables,
+                                                 input_stream, error, arg_names...))
+                              return (ok = false), void();
+                           if (!found)
+                              return (ok = error("unknown arg '" +
+                                                 (std::string)input_stream.current_value + "'")),
+                                     void();
+                        }
+                        if (input_stream.current_puncuator != ')')
+                           return (ok = error("expected )")), void();
+                        input_stream.skip();
+                     }
+                     gql_mark_optional<0>(*args, filled);
+                     if constexpr (mf::num_args > 0)
+                        for (int i = 0; i < mf::num_args; ++i)
+                           if (!filled[i])
+                              return (ok = error("function missing required arg '" +
+                                                 std::string(std::data({arg_names...})[i]) + "'")),
+                                     void();
+                     field.args = std::move(args);
+                     ok = gql_plan_selections<ret>(field.selections, variables, input_stream,
+                                                   error);
+                  }
+               }
+            });
+            if (!ok)
+               return false;
+         }
+         if (input_stream.current_puncuator != '}')
+            return error("expected }");
+         input_stream.skip();
+         return true;
+      }
+   }
+
+   // Parses "($name: Type ...)" following "query [name]"
+   template <typename E>
+   bool gql_plan_variable_definitions(std::vector<std::string>& variables,
+                                      gql_stream& input_stream,
+                                      const E& error)
+   {
+      input_stream.skip();
+      while (input_stream.current_puncuator == '$')
+      {
+         input_stream.skip();
+         if (input_stream.current_type != gql_stream::name)
+            return error("expected variable name");
+         if (std::find(variables.begin(), variables.end(), input_stream.current_value) !=
+             variables.end())
+            return error("duplicate variable");
+         variables.emplace_back(input_stream.current_value);
+         input_stream.skip();
+         if (input_stream.current_puncuator != ':')
+            return error("expected :");
+         input_stream.skip();
+         if (input_stream.current_type != gql_stream::name && input_stream.current_puncuator != '[')
+            return error("expected variable type");
+         while (input_stream.current_type == gql_stream::name ||
+                input_stream.current_puncuator == '[' || input_stream.current_puncuator == ']' ||
+                input_stream.current_puncuator == '!')
+            input_stream.skip();
+         if (input_stream.current_puncuator == '=')
+            return error("variable defaults not supported");
+      }
+      if (input_stream.current_puncuator != ')')
+         return error("expected )");
+      input_stream.skip();
+      return true;
+   }
+
+   template <typename T, typename E>
+   bool gql_plan_root(gql_plan& plan, gql_stream& input_stream, const E& error)
+   {
+      if (input_stream.current_type == gql_stream::name)
+      {
+         if (input_stream.current_value == "query")
+         {
+            input_stream.skip();
+            if (input_stream.current_type == gql_stream::name)
+               input_stream.skip();
+            if (input_stream.current_puncuator == '(' &&
+                !gql_plan_variable_definitions(plan.variables, input_stream, error))
+               return false;
+            if (input_stream.current_puncuator == '@')
+               return error("directives not supported");
+         }
+         else if (input_stream.current_value == "subscriptions")
+            return error("subscriptions not supported");
+         else if (input_stream.current_value == "mutation")
+            return error("mutations not supported");
+         else if (input_stream.current_value == "fragment")
+            return error("fragments not supported");
+         else
+            return error("expected query");
+      }
+      if (!gql_plan_selections<T>(plan.selections, plan.variables, input_stream, error))
+         return false;
+      if (input_stream.current_type == gql_stream::eof)
+         return true;
+      if (input_stream.current_type == gql_stream::name)
+      {
+         if (input_stream.current_value == "query")
+            return error("multiple queries not supported");
+         if (input_stream.current_value == "fragment")
+            return error("fragments not supported");
+         if (input_stream.current_value == "subscription")
+            return error("subscriptions not supported");
+         if (input_stream.current_value == "mutation")
+            return error("mutations not supported");
+      }
+      return error("expected end of input");
+   }
+
+   // Parses query against T. If it fails, the returned plan's error is set.
+   template <typename T>
+   gql_plan gql_prepare(std::string_view query)
+   {
+      gql_plan plan;
+      plan.query = query;
+      gql_stream input_stream{query};
+      if (!gql_plan_root<T>(plan, input_stream, [&](const auto& e) {
+             plan.error = e;
+             return false;
+          }))
+      {
+         plan.variables.clear();
+         plan.selections.clear();
+      }
+      return plan;
+   }
+
+   template <int i, typename... Args, typename E>
+   bool gql_bind_arg(std::tuple<Args...>& args,
+                     uint32_t index,
+                     const std::string& name,
+                     const gql_stream* value,
+                     const E& error)
+   {
+      if constexpr (i < sizeof...(Args))
+      {
+         if (index != i)
+            return gql_bind_arg<i + 1>(args, index, name, value, error);
+         auto& arg = std::get<i>(args);
+         if constexpr (eosio::is_std_optional<eosio::remove_cvref_t<decltype(arg)>>())
+         {
+            if (!value ||
+                (value->current_type == gql_stream::name && value->current_value == "null"))
+            {
+               arg.reset();
+               return true;
+            }
+            auto input_stream = *value;
+            arg.emplace();
+            return gql_parse_arg(*arg, input_stream, error);
+         }
+         else
+         {
+            if (!value)
+               return error("missing variable '$" + name + "'");
+            auto input_stream = *value;
+            return gql_parse_arg(arg, input_stream, error);
+         }
+      }
+      else
+         return error("invalid arg index");
+   }
+
+   // Output stream for gql_execute which writes the selected fields in the eosio binary
+   // format instead of JSON:
+   //
+   // * An object is its selected fields in selection order, without names
+   // * A nullable value is a bool followed, if true, by the value
+   // * A list is a varuint32 count followed by the elements
+   // * Anything else is a scalar, which has the type given by get_gql_schema(p, true)
+   template <typename S>
+   struct gql_bin_stream : S
+   {
+      using S::S;
+   };
+
+   template <typename T>
+   struct is_gql_bin_stream : std::false_type
+   {
+   };
+
+   template <typename S>
+   struct is_gql_bin_stream<gql_bin_stream<S>> : std::true_type
+   {
+   };
+
+   template <typename Raw, typename OS, typename E>
+   bool gql_execute(const Raw& value,
+                    const std::vector<gql_plan_field>& selections,
+                    const gql_variables& variables,
+                    OS& output_stream,
+                    const E& error);
+
+   // One function per field of T, indexed by gql_plan_field::index, so gql_execute jumps
+   // straight to each selected field instead of walking eosio_for_each_field
+   template <typename T, typename OS, typename E>
+   struct gql_field_dispatch
+   {
+      using fn = bool (*)(const T&, const gql_plan_field&, const gql_variables&, OS&, const E&);
+
+      static const std::vector<fn>& table()
+      {
+         static const auto result = [] {
+            std::vector<fn> result;
+            eosio_for_each_field((T*)nullptr, [&](std::string_view, auto&& member, auto...) {
+               using member_type = decltype(member((T*)nullptr));
+               if constexpr (eosio::is_non_const_member_fn<member_type>())
+                  result.push_back(nullptr);
+               else
+                  result.push_back(&execute<std::decay_t<decltype(member)>>);
+            });
+            return result;
+         }();
+         return result;
+      }
+
+      // M is the captureless lambda which eosio_for_each_field passes for the field
+      template <typename M>
+      static bool execute(const T& value,
+                          const gql_plan_field& field,
+                          const gql_variables& variables,
+                          OS& output_stream,
+                          const E& error)
+      {
+         M member{};
+         using member_type = decltype(member((T*)nullptr));
+         if constexpr (std::is_member_object_pointer_v<member_type>)
+            return gql_execute(value.*member(&value), field.selections, variables, output_stream,
+                               error);
+         else
+         {
+            using mf = eosio::member_fn<member_type>;
+            using args_type = eosio::tuple_from_type_list<typename mf::arg_types>;
+            auto call = [&](const args_type& args) {
+               auto result = std::apply(
+                   [&](const auto&... args) { return (value.*member(&value))(args...); }, args);
+               return gql_execute(result, field.selections, variables, output_stream, error);
+            };
+            auto& planned = *static_cast<const args_type*>(field.args.get());
+            if (field.variables.empty())
+               return call(planned);
+
+            // Only copy the planned args when some of them come from variables
+            auto args = planned;
+            for (auto& [i, name] : field.variables)
+               if (!gql_bind_arg<0>(args, i, name, variables.find(name), error))
+                  return false;
+            return call(args);
+         }
+      }
+   };
+
+   template <typename Raw, typename OS, typename E>
+   bool gql_execute(const Raw& value,
+                    const std::vector<gql_plan_field>& selections,
+                    const gql_variables& variables,
+                    OS& output_stream,
+                    const E& error)
+   {
+      using T = eosio::remove_cvref_t<Raw>;
+      constexpr bool bin = is_gql_bin_stream<OS>::value;
+      if constexpr (eosio::is_std_optional<T>() || std::is_pointer<T>() ||
+                    eosio::is_std_unique_ptr<T>())
+      {
+         if constexpr (bin)
+            output_stream.write(char(bool(value)));
+         if (value)
+            return gql_execute(*value, selections, variables, output_stream, error);
+         if constexpr (!bin)
+            write_str("null", output_stream);
+         return true;
+      }
+      else if constexpr (eosio::is_std_reference_wrapper<T>())
+         return gql_execute(value.get(), selections, variables, output_stream, error);
+      else if constexpr (eosio::is_serializable_container<T>() && bin)
+      {
+         eosio::varuint32_to_bin(value.size(), output_stream);
+         for (auto& v : value)
+            if (!gql_execute(v, selections, variables, output_stream, error))
+               return false;
+         return true;
+      }
+      else if constexpr (eosio::is_serializable_container<T>())
+      {
+         output_stream.write('[');
+         bool first = true;
+         for (auto& v : value)
+         {
+            if (first)
+               increase_indent(output_stream);
+            else
+               output_stream.write(',');
+            write_newline(output_stream);
+            first = false;
+            if (!gql_execute(v, selections, variables, output_stream, error))
+               return false;
+         }
+         if (!first)
+         {
+            decrease_indent(output_stream);
+            write_newline(output_stream);
+         }
+         output_stream.write(']');
+         return true;
+      }
+      else if constexpr (!gql_is_object<T>() && bin)
+      {
+         eosio::to_bin(value, output_stream);
+         return true;
+      }
+      else if constexpr (!gql_is_object<T>())
+      {
+         eosio::to_json(value, output_stream);
+         return true;
+      }
+      else if constexpr (bin)
+      {
+         auto& dispatch = gql_field_dispatch<T, OS, E>::table();
+         for (auto& field : selections)
+            if (!dispatch[field.index](value, field, variables, output_stream, error))
+               return false;
+         return true;
+      }
+      else
+      {
+         auto& dispatch = gql_field_dispatch<T, OS, E>::table();
+         bool first = true;
+         output_stream.write('{');
+         for (auto& field : selections)
+         {
+            if (first)
+            {
+               increase_indent(output_stream);
+               first = false;
+            }
+            else
+               output_stream.write(',');
+            write_newline(output_stream);
+            to_json(field.alias, output_stream);
+            write_colon(output_stream);
+
+            if (!dispatch[field.index](value, field, variables, output_stream, error))
+               return false;
+         }
+         if (!first)
+         {
+            decrease_indent(output_stream);
+            write_newline(output_stream);
+         }
+         output_stream.write('}');
+         return true;
+      }
+   }
+
+   // Executes a plan which gql_prepare<T>() created
+   template <typename Stream = eosio::time_point_include_z_stream<eosio::string_stream>, typename T>
+   std::string gql_query(const T& value, const gql_plan& plan, std::string_view variables)
+   {
+      return gql_response<Stream>([&](auto& output_stream, const auto& error) {
+         if (!plan.error.empty())
+            return error(plan.error);
+         gql_variables vars;
+         if (!gql_parse_variables(variables, vars, error))
+            return false;
+         return gql_execute(value, plan.selections, vars, output_stream, error);
+      });
+   }
+
+   // Like gql_query, but the response is binary: a 0 byte followed by the data as described at
+   // gql_bin_stream, or a 1 byte followed by the error message as a string
+   template <typename T>
+   std::string gql_query_bin(const T& value, const gql_plan& plan, std::string_view variables)
+   {
+      std::string result;
+      std::string error;
+      gql_bin_stream<eosio::string_stream> output_stream(result);
+      output_stream.write(char(0));
+      gql_variables vars;
+      auto set_error = [&](const auto& e) {
+         error = e;
+         return false;
+      };
+      if (!plan.error.empty())
+         set_error(plan.error);
+      else if (gql_parse_variables(variables, vars, set_error) &&
+               gql_execute(value, plan.selections, vars, output_stream, set_error))
+         return result;
+      result.clear();
+      output_stream.write(char(1));
+      eosio::to_bin(error, output_stream);
+      return result;
+   }
+
+   // Like gql_query, but passes the response to flush(data, size) in chunks of up to chunk_size
+   // bytes instead of returning it. Returns false if execution failed after part of the
+   // response was passed; error then holds the message.
+   template <template <typename> typename Stream = eosio::time_point_include_z_stream,
+             typename T,
+             typename Flush>
+   bool gql_query_chunked(const T& value,
+                          const gql_plan& plan,
+                          std::string_view variables,
+                          size_t chunk_size,
+                          Flush&& flush,
+                          std::string& error)
+   {
+      return gql_response_chunked<Stream>(
+          chunk_size, flush, error, [&](auto& output_stream, const auto& error) {
+             if (!plan.error.empty())
+                return error(plan.error);
+             gql_variables vars;
+             if (!gql_parse_variables(variables, vars, error))
+                return false;
+             return gql_execute(value, plan.selections, vars, output_stream, error);
+          });
+   }
+
+   // Plans for recently-executed queries, keyed by the query's hash. When full, the cache
+   // is cleared; the typical client sends a small, fixed set of queries.
+   template <typename T>
+   struct gql_plan_cache
+   {
+      size_t max_plans = 256;
+      std::unordered_map<size_t, std::unique_ptr<gql_plan>> plans;
+
+      const gql_plan& get(std::string_view query)
+      {
+         auto hash = std::hash<std::string_view>{}(query);
+         auto it = plans.find(hash);
+         if (it != plans.end() && it->second->query == query)
+            return *it->second;
+         if (it == plans.end() && plans.size() >= max_plans)
+            plans.clear();
+         auto& plan = plans[hash];
+         plan = std::make_unique<gql_plan>(gql_prepare<T>(query));
+         return *plan;
+      }
+   };
+
+   // Responses of recently-executed queries, keyed by query text and variables. The responses
+   // are only valid for the state they were computed from; revision identifies that state,
+   // and get() clears the cache when it's given a different one. Callers also clear() it when
+   // the state changes without a change in revision. Least-recently-used responses are
+   // evicted to keep the total size of keys and responses within max_bytes.
+   struct gql_result_cache
+   {
+      struct entry
+      {
+         std::string key;
+         std::string response;
+      };
+
+      size_t max_bytes = 4 * 1024 * 1024;
+      size_t bytes = 0;
+      uint64_t revision = 0;
+      std::list<entry> entries;  // most recently used first
+      std::unordered_map<std::string_view, std::list<entry>::iterator> index;
+
+      static std::string make_key(std::string_view query, std::string_view variables)
+      {
+         std::string key;
+         key.reserve(sizeof(uint32_t) + query.size() + variables.size());
+         auto query_size = uint32_t(query.size());
+         key.append(reinterpret_cast<const char*>(&query_size), sizeof(query_size));
+         key.append(query);
+         key.append(variables);
+         return key;
+      }
+
+      const std::string* get(uint64_t revision,
+                             std::string_view query,
+                             std::string_view variables)
+      {
+         if (revision != this->revision)
+         {
+            clear();
+            this->revision = revision;
+            return nullptr;
+         }
+         auto it = index.find(make_key(query, variables));
+         if (it == index.end())
+            return nullptr;
+         entries.splice(entries.begin(), entries, it->second);
+         return &it->second->response;
+      }
+
+      void put(uint64_t revision,
+               std::string_view query,
+               std::string_view variables,
+               std::string response)
+      {
+         if (revision != this->revision)
+         {
+            clear();
+            this->revision = revision;
+         }
+         auto key = make_key(query, variables);
+         auto size = key.size() + response.size();
+         if (size > max_bytes || index.count(key))
+            return;
+         while (bytes + size > max_bytes)
+         {
+            auto& last = entries.back();
+            bytes -= last.key.size() + last.response.size();
+            index.erase(last.key);
+            entries.pop_back();
+         }
+         entries.push_front({std::move(key), std::move(response)});
+         index[entries.front().key] = entries.begin();
+         bytes += size;
+      }
+
+      void clear()
+      {
+         index.clear();
+         entries.clear();
+         bytes = 0;
+      }
+   };
+
+   template <typename Stream = eosio::time_point_include_z_stream<eosio::string_stream>, typename T>
+   std::string gql_query(const T& value,
+                         gql_plan_cache<T>& cache,
+                         std::string_view query,
+                         std::string_view variables)
+   {
+      return gql_query<Stream>(value, cache.get(query), variables);
+   }
+
+   // Plans query, then executes it. Selection sets are resolved once, not once per list item.
+   template <typename Stream = eosio::time_point_include_z_stream<eosio::string_stream>, typename T>
+   std::string gql_query(const T& value, std::string_view query, std::string_view variables = {})
+   {
+      return gql_query<Stream>(value, gql_prepare<T>(query), variables);
+   }
+
+   template <typename T>
+   std::string format_gql_query(const T& value, std::string_view query)
+   {
+      return gql_query<gql_pretty_stream<eosio::string_stream>>(value, query);
+   }
+}  // namespace clchain
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <clchain/block_archive.hpp>
+
+#include <vector>
+
+namespace subchain
+{
+   // block_archive which the host stores, e.g. in a file. This keeps irreversible blocks out
+   // of wasm memory. The host provides these imports in the clchain module:
+   //
+   // block_archive_begin_num() -> uint32_t
+   // block_archive_end_num() -> uint32_t
+   // block_archive_get_size(num) -> uint32_t
+   // block_archive_get(num, dest)                  copies the block into dest
+   // block_archive_append(num, data, size)
+   class host_block_archive : public block_archive
+   {
+     public:
+      uint32_t begin_num() const override;
+      uint32_t end_num() const override;
+
+      // The stream points into a buffer which is reused by the next get()
+      eosio::input_stream get(uint32_t num) const override;
+      void append(uint32_t num, const char* data, size_t size) override;
+
+     private:
+      mutable std::vector<char> buffer;
+   };
+}  // namespace subchain
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <clchain/block_archive.hpp>
 #include <clchain/graphql_connection.hpp>
 #include <eosio/bytes.hpp>
 #include <eosio/fixed_bytes.hpp>
 #include <eosio/name.hpp>
 #include <eosio/time.hpp>
 
+#include <map>
+
 namespace subchain
 {
    struct creator_action
@@ -67,6 +70,85 @@ namespace subchain
       return get_eosio_num(a) < get_eosio_num(b);
    };
 
+   // Block numbers available from a block_log: the archive's, then the in-memory blocks'.
+   // Numbers between the two (blocks which were never archived) are skipped.
+   struct block_num_range
+   {
+      struct iterator
+      {
+         using iterator_category = std::bidirectional_iterator_tag;
+         using value_type = uint32_t;
+         using difference_type = int64_t;
+         using pointer = const uint32_t*;
+         using reference = uint32_t;
+
+         const block_num_range* range = nullptr;
+         uint32_t num = 0;
+
+         uint32_t operator*() const { return num; }
+         iterator& operator++()
+         {
+            if (++num == range->archive_end)
+               num = range->blocks_begin;
+            return *this;
+         }
+         iterator& operator--()
+         {
+            if (num == range->blocks_begin)
+               num = range->archive_end;
+            --num;
+            return *this;
+         }
+         iterator operator++(int)
+         {
+            auto result = *this;
+            ++*this;
+            return result;
+         }
+         iterator operator--(int)
+         {
+            auto result = *this;
+            --*this;
+            return result;
+         }
+         friend bool operator==(iterator a, iterator b) { return a.num == b.num; }
+         friend bool operator!=(iterator a, iterator b) { return a.num != b.num; }
+      };
+
+      // [archive_begin, archive_end) then [blocks_begin, blocks_end). archive_end is never
+      // above blocks_begin, and an empty segment is positioned at the other's boundary.
+      uint32_t archive_begin = 0;
+      uint32_t archive_end = 0;
+      uint32_t blocks_begin = 0;
+      uint32_t blocks_end = 0;
+
+      block_num_range() = default;
+      block_num_range(const block_num_range&) = delete;
+      block_num_range& operator=(const block_num_range&) = delete;
+
+      iterator begin() const
+      {
+         return {this, archive_begin == archive_end ? blocks_begin : archive_begin};
+      }
+      iterator end() const { return {this, blocks_end}; }
+
+      iterator lower_bound(uint32_t num) const
+      {
+         if (num < archive_end)
+            return {this, std::max(num, archive_begin)};
+         if (num < blocks_end)
+            return {this, std::max(num, blocks_begin)};
+         return end();
+      }
+
+      iterator upper_bound(uint32_t num) const
+      {
+         if (num == ~uint32_t(0))
+            return end();
+         return lower_bound(num + 1);
+      }
+   };
+
    struct block_log
    {
       enum status
@@ -85,7 +167,53 @@ namespace subchain
       std::vector<std::unique_ptr<block_with_id>> blocks;
       uint32_t irreversible = 0;
 
-      auto lower_bound_by_num(uint32_t num) const
+      // If set, trim() moves irreversible blocks here instead of discarding them, and lookups
+      // by num fall back to it. Lookups by eosio num only search blocks.
+      block_archive* archive = nullptr;
+
+      // Blocks decoded from archive, kept until release_archived(). Callers may hold pointers
+      // to several of them at once, e.g. while a query builds its response.
+      mutable std::map<uint32_t, std::unique_ptr<block_with_id>> archived_blocks;
+
+      // Attach an archive. If blocks is empty, resumes from the archive's last block,
+      // which becomes irreversible.
+      void open(block_archive& a)
+      {
+         archive = &a;
+         release_archived();
+         if (blocks.empty() && archive->begin_num() != archive->end_num())
+         {
+            auto b = std::make_unique<block_with_id>();
+            auto bin = archive->get(archive->end_num() - 1);
+            eosio::from_bin(*b, bin);
+            irreversible = b->num;
+            blocks.push_back(std::move(b));
+         }
+      }
+
+      void release_archived() const { archived_blocks.clear(); }
+
+      // Fills range with the block numbers available from either archive or blocks
+      void get_range(block_num_range& range) const
+      {
+         range.blocks_begin = blocks.empty() ? 0 : blocks.front()->num;
+         range.blocks_end = blocks.empty() ? 0 : blocks.back()->num + 1;
+         range.archive_begin = range.archive_end = range.blocks_begin;
+         if (archive && archive->begin_num() != archive->end_num())
+         {
+            range.archive_begin = archive->begin_num();
+            range.archive_end = archive->end_num();
+            if (blocks.empty())
+               range.blocks_begin = range.blocks_end = range.archive_end;
+            else if (range.archive_begin >= range.blocks_begin)
+               range.archive_begin = range.archive_end = range.blocks_begin;
+            else
+               range.archive_end = std::min(range.archive_end, range.blocks_begin);
+         }
+      }
+
+      // Position in blocks of the first block at or after num
+      auto lower_bound_in_blocks(uint32_t num) const
       {
          if (blocks.empty())
             return blocks.end();
@@ -97,11 +225,26 @@ namespace subchain
          return blocks.end();
       }
 
-      auto upper_bound_by_num(uint32_t num) const
+      // Position in blocks of the first block after num
+      auto upper_bound_in_blocks(uint32_t num) const
       {
          if (num == ~uint32_t(0))
             return blocks.end();
-         return lower_bound_by_num(num + 1);
+         return lower_bound_in_blocks(num + 1);
+      }
+
+      // First block number at or after num which is available from either archive or blocks
+      block_num_range::iterator lower_bound_by_num(const block_num_range& range,
+                                                   uint32_t num) const
+      {
+         return range.lower_bound(num);
+      }
+
+      // First block number after num which is available from either archive or blocks
+      block_num_range::iterator upper_bound_by_num(const block_num_range& range,
+                                                   uint32_t num) const
+      {
+         return range.upper_bound(num);
       }
 
       const block_with_id* head() const
@@ -111,12 +254,22 @@ namespace subchain
          return &*blocks.back();
       }
 
+      // A block found in archive remains valid until release_archived()
       const block_with_id* block_by_num(uint32_t num) const
       {
-         auto it = lower_bound_by_num(num);
+         auto it = lower_bound_in_blocks(num);
          if (it != blocks.end() && (*it)->num == num)
             return &**it;
-         return nullptr;
+         if (!archive || num < archive->begin_num() || num >= archive->end_num())
+            return nullptr;
+         auto& b = archived_blocks[num];
+         if (!b)
+         {
+            b = std::make_unique<block_with_id>();
+            auto bin = archive->get(num);
+            eosio::from_bin(*b, bin);
+         }
+         return &*b;
       }
 
       const block_with_id* block_by_eosio_num(uint32_t num) const
@@ -129,9 +282,11 @@ namespace subchain
 
       const block_with_id* block_before_num(uint32_t num) const
       {
-         auto it = lower_bound_by_num(num);
+         auto it = lower_bound_in_blocks(num);
          if (it != blocks.begin())
             return &*it[-1];
+         if (archive && num > archive->begin_num() && archive->begin_num() != archive->end_num())
+            return block_by_num(std::min(num, archive->end_num()) - 1);
          return nullptr;
       }
 
@@ -146,7 +301,7 @@ namespace subchain
       std::pair<status, size_t> add_block(const block_with_id& block)
       {
          size_t num_forked = 0;
-         auto it = lower_bound_by_num(block.num);
+         auto it = lower_bound_in_blocks(block.num);
          if (it != blocks.end() && block.id == it[0]->id)
             return {duplicate, 0};
          if (it == blocks.begin() && block.num != 1)
@@ -166,7 +321,7 @@ namespace subchain
       {
          if (block_num <= irreversible)
             return 0;
-         auto it = lower_bound_by_num(block_num);
+         auto it = lower_bound_in_blocks(block_num);
          if (it == blocks.end() || it[0]->num != block_num)
             return 0;
          size_t num_removed = blocks.end() - it;
@@ -174,10 +329,24 @@ namespace subchain
          return num_removed;
       }
 
-      // Keep only 1 irreversible block
+      // Keep only 1 irreversible block. If archive is set, then the trimmed blocks and
+      // the kept block are appended to it.
       void trim()
       {
-         auto it = lower_bound_by_num(irreversible);
+         auto it = lower_bound_in_blocks(irreversible);
+         if (archive)
+         {
+            auto end = it;
+            if (end != blocks.end() && (*end)->num == irreversible)
+               ++end;
+            for (auto i = blocks.begin(); i != end; ++i)
+            {
+               if (archive->begin_num() != archive->end_num() && (*i)->num < archive->end_num())
+                  continue;
+               auto bin = eosio::convert_to_bin(**i);
+               archive->append((*i)->num, bin.data(), bin.size());
+            }
+         }
          blocks.erase(blocks.begin(), it);
       }
    };
@@ -203,13 +372,16 @@ namespace subchain
                              std::optional<std::string> before,
                              std::optional<std::string> after) const
       {
+         block_num_range range;
+         log.get_range(range);
          return clchain::make_connection<BlockConnection, uint32_t>(
-             gt, ge, lt, le, first, last, before, after,     //
-             log.blocks,                                     //
-             [](auto& block) { return block->num; },         //
-             [](auto& block) { return std::cref(*block); },  //
-             [&](auto& blocks, auto block_num) { return log.lower_bound_by_num(block_num); },
-             [&](auto& blocks, auto block_num) { return log.upper_bound_by_num(block_num); });
+             gt, ge, lt, le, first, last, before, after,  //
+             range,                                       //
+             [](uint32_t num) { return num; },            //
+             [&](uint32_t num) { return std::cref(*log.block_by_num(num)); },
+             [&](auto& range, auto block_num) { return log.lower_bound_by_num(range, block_num); },
+             [&](auto& range, auto block_num) { return log.upper_bound_by_num(range, block_num); },
+             [&](uint32_t num) { return log.block_by_num(num) != nullptr; }, ~uint32_t(0));
       }
 
       const block_with_id* head() const { return log.head(); }
@@ -0,0 +1,172 @@
+#include <clchain/block_log_file.hpp>
+
+#include <eosio/check.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace subchain
+{
+   namespace
+   {
+      constexpr uint32_t index_magic = 0x314c4243;  // "CBL1"
+      constexpr size_t index_header_size = 2 * sizeof(uint32_t);
+
+      int open_file(const std::string& path)
+      {
+         int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+         eosio::check(fd >= 0, "unable to open " + path + ": " + std::strerror(errno));
+         return fd;
+      }
+
+      uint64_t file_size(int fd)
+      {
+         struct stat st;
+         eosio::check(::fstat(fd, &st) == 0, std::string("fstat failed: ") + std::strerror(errno));
+         return st.st_size;
+      }
+
+      void write_at(int fd, uint64_t pos, const void* data, size_t size)
+      {
+         auto p = reinterpret_cast<const char*>(data);
+         while (size)
+         {
+            auto n = ::pwrite(fd, p, size, pos);
+            if (n < 0 && errno == EINTR)
+               continue;
+            eosio::check(n > 0, std::string("write failed: ") + std::strerror(errno));
+            p += n;
+            pos += n;
+            size -= n;
+         }
+      }
+
+      void truncate(int fd, uint64_t size)
+      {
+         eosio::check(::ftruncate(fd, size) == 0,
+                      std::string("ftruncate failed: ") + std::strerror(errno));
+      }
+   }  // namespace
+
+   block_log_file::block_log_file(const std::string& dir)
+   {
+      ::mkdir(dir.c_str(), 0755);
+      _log_fd = open_file(dir + "/blocks.log");
+      _index_fd = open_file(dir + "/blocks.index");
+
+      _log_size = file_size(_log_fd);
+      auto index_size = file_size(_index_fd);
+      if (index_size < index_header_size)
+      {
+         uint32_t header[2] = {index_magic, _begin_num};
+         truncate(_index_fd, 0);
+         write_at(_index_fd, 0, header, sizeof(header));
+         index_size = index_header_size;
+      }
+      map(_index, _index_fd, index_size);
+      map(_log, _log_fd, _log_size);
+
+      uint32_t magic;
+      memcpy(&magic, _index.data, sizeof(magic));
+      eosio::check(magic == index_magic, "blocks.index has an unknown format");
+      memcpy(&_begin_num, _index.data + sizeof(magic), sizeof(_begin_num));
+
+      // Drop index entries (and trailing log bytes) which don't describe a complete record
+      uint64_t valid_log_size = 0;
+      uint64_t max_blocks = (index_size - index_header_size) / sizeof(uint64_t);
+      while (_num_blocks < max_blocks)
+      {
+         uint64_t offset;
+         memcpy(&offset, index_pos() + _num_blocks * sizeof(uint64_t), sizeof(offset));
+         uint32_t size;
+         if (offset != valid_log_size || offset + sizeof(size) > _log_size)
+            break;
+         memcpy(&size, _log.data + offset, sizeof(size));
+         if (offset + sizeof(size) + size > _log_size)
+            break;
+         valid_log_size = offset + sizeof(size) + size;
+         ++_num_blocks;
+      }
+      if (_num_blocks != max_blocks)
+         truncate(_index_fd, index_header_size + _num_blocks * sizeof(uint64_t));
+      if (valid_log_size != _log_size)
+      {
+         _log_size = valid_log_size;
+         truncate(_log_fd, _log_size);
+      }
+   }
+
+   block_log_file::~block_log_file()
+   {
+      unmap(_log);
+      unmap(_index);
+      if (_log_fd >= 0)
+         ::close(_log_fd);
+      if (_index_fd >= 0)
+         ::close(_index_fd);
+   }
+
+   void block_log_file::map(mapping& m, int fd, size_t size) const
+   {
+      unmap(m);
+      if (!size)
+         return;
+      void* p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+      eosio::check(p != MAP_FAILED, std::string("mmap failed: ") + std::strerror(errno));
+      m.data = reinterpret_cast<const char*>(p);
+      m.size = size;
+   }
+
+   void block_log_file::unmap(mapping& m) const
+   {
+      if (m.data)
+         ::munmap(const_cast<char*>(m.data), m.size);
+      m = {};
+   }
+
+   const char* block_log_file::index_pos() const { return _index.data + index_header_size; }
+
+   eosio::input_stream block_log_file::get(uint32_t num) const
+   {
+      eosio::check(num >= _begin_num && num - _begin_num < _num_blocks,
+                   "block is not in blocks.log");
+      auto index_end = index_header_size + uint64_t(_num_blocks) * sizeof(uint64_t);
+      if (_index.size < index_end)
+         map(_index, _index_fd, index_end);
+      if (_log.size < _log_size)
+         map(_log, _log_fd, _log_size);
+
+      uint64_t offset;
+      memcpy(&offset, index_pos() + uint64_t(num - _begin_num) * sizeof(uint64_t),
+             sizeof(offset));
+      uint32_t size;
+      memcpy(&size, _log.data + offset, sizeof(size));
+      auto data = _log.data + offset + sizeof(size);
+      return {data, data + size};
+   }
+
+   void block_log_file::append(uint32_t num, const char* data, size_t size)
+   {
+      if (!_num_blocks && num != _begin_num)
+      {
+         _begin_num = num;
+         write_at(_index_fd, sizeof(index_magic), &_begin_num, sizeof(_begin_num));
+      }
+      eosio::check(num == end_num(), "blocks.log: block is not the next block");
+      eosio::check(size <= UINT32_MAX, "blocks.log: block is too large");
+
+      // The log record goes first; the index entry makes it visible
+      uint32_t record_size = size;
+      uint64_t offset = _log_size;
+      write_at(_log_fd, offset, &record_size, sizeof(record_size));
+      write_at(_log_fd, offset + sizeof(record_size), data, size);
+      write_at(_index_fd, index_header_size + uint64_t(_num_blocks) * sizeof(uint64_t), &offset,
+               sizeof(offset));
+      _log_size = offset + sizeof(record_size) + size;
+      ++_num_blocks;
+   }
+}  // namespace subchain
@@ -0,0 +1,38 @@
+#include <clchain/host_block_archive.hpp>
+
+#include <eosio/check.hpp>
+
+namespace
+{
+   extern "C"
+   {
+      // clang-format off
+      [[clang::import_module("clchain"), clang::import_name("block_archive_begin_num")]] uint32_t block_archive_begin_num();
+      [[clang::import_module("clchain"), clang::import_name("block_archive_end_num")]]   uint32_t block_archive_end_num();
+      [[clang::import_module("clchain"), clang::import_name("block_archive_get_size")]]  uint32_t block_archive_get_size(uint32_t num);
+      [[clang::import_module("clchain"), clang::import_name("block_archive_get")]]       void     block_archive_get(uint32_t num, char* dest);
+      [[clang::import_module("clchain"), clang::import_name("block_archive_append")]]    void     block_archive_append(uint32_t num, const char* data, uint32_t size);
+      // clang-format on
+   }
+}  // namespace
+
+namespace subchain
+{
+   uint32_t host_block_archive::begin_num() const { return block_archive_begin_num(); }
+
+   uint32_t host_block_archive::end_num() const { return block_archive_end_num(); }
+
+   eosio::input_stream host_block_archive::get(uint32_t num) const
+   {
+      eosio::check(num >= begin_num() && num < end_num(), "block is not in the archive");
+      buffer.resize(block_archive_get_size(num));
+      block_archive_get(num, buffer.data());
+      return {buffer.data(), buffer.size()};
+   }
+
+   void host_block_archive::append(uint32_t num, const char* data, size_t size)
+   {
+      eosio::check(size <= UINT32_MAX, "block is too large");
+      block_archive_append(num, data, size);
+   }
+}  // namespace subchain
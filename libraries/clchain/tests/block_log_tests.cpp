@@ -0,0 +1,201 @@
+#include <clchain/block_log_file.hpp>
+#include <clchain/subchain.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <filesystem>
+
+using subchain::block_log;
+using subchain::block_with_id;
+
+namespace
+{
+   eosio::checksum256 make_id(uint32_t num, uint8_t fork)
+   {
+      return eosio::checksum256(std::array<uint8_t, 32>{uint8_t(num >> 24), uint8_t(num >> 16),
+                                                        uint8_t(num >> 8), uint8_t(num), fork});
+   }
+
+   block_with_id make_block(uint32_t num, uint8_t fork = 0, uint8_t prev_fork = 0)
+   {
+      block_with_id b;
+      b.num = num;
+      b.id = make_id(num, fork);
+      b.previous = num > 1 ? make_id(num - 1, prev_fork) : eosio::checksum256{};
+      b.eosioBlock.num = num + 1000;
+      b.eosioBlock.id = make_id(num + 1000, fork);
+      return b;
+   }
+
+   void add_blocks(block_log& log, uint32_t begin, uint32_t end)
+   {
+      for (uint32_t num = begin; num < end; ++num)
+         REQUIRE(log.add_block(make_block(num)).first == block_log::appended);
+   }
+
+   struct temp_dir
+   {
+      std::filesystem::path path;
+
+      temp_dir()
+      {
+         std::string pattern = (std::filesystem::temp_directory_path() / "clchain-XXXXXX");
+         REQUIRE(mkdtemp(pattern.data()));
+         path = pattern;
+      }
+      ~temp_dir() { std::filesystem::remove_all(path); }
+   };
+
+   std::vector<uint32_t> connection_nums(const subchain::BlockConnection& c)
+   {
+      std::vector<uint32_t> result;
+      for (auto& edge : c.edges)
+         result.push_back(edge.node.get().num);
+      return result;
+   }
+
+   std::vector<uint32_t> iota(uint32_t begin, uint32_t end)
+   {
+      std::vector<uint32_t> result;
+      for (uint32_t num = begin; num < end; ++num)
+         result.push_back(num);
+      return result;
+   }
+}  // namespace
+
+TEST_CASE("block_log trims into the archive and reads back", "[block_log]")
+{
+   temp_dir dir;
+   {
+      subchain::block_log_file archive{dir.path.string()};
+      block_log log;
+      log.open(archive);
+      add_blocks(log, 1, 11);
+      log.irreversible = 7;
+      log.trim();
+
+      CHECK(log.blocks.front()->num == 7);
+      CHECK(archive.begin_num() == 1);
+      CHECK(archive.end_num() == 8);
+      for (uint32_t num = 1; num <= 10; ++num)
+      {
+         auto* b = log.block_by_num(num);
+         REQUIRE(b);
+         CHECK(b->num == num);
+         CHECK(b->id == make_id(num, 0));
+         CHECK(b->eosioBlock.num == num + 1000);
+      }
+      CHECK(!log.block_by_num(11));
+      CHECK(log.block_before_num(7)->num == 6);
+      CHECK(log.block_before_num(3)->num == 2);
+
+      // Trimming again doesn't duplicate the kept block
+      log.irreversible = 9;
+      log.trim();
+      CHECK(archive.end_num() == 10);
+      CHECK(log.block_by_num(8)->num == 8);
+   }
+
+   // A new process resumes from the archive's last block
+   subchain::block_log_file archive{dir.path.string()};
+   block_log log;
+   log.open(archive);
+   CHECK(log.irreversible == 9);
+   REQUIRE(log.blocks.size() == 1);
+   CHECK(log.head()->num == 9);
+   CHECK(log.add_block(make_block(10, 1)).first == block_log::appended);
+   CHECK(log.block_by_num(10)->id == make_id(10, 1));
+   CHECK(log.block_by_num(4)->id == make_id(4, 0));
+   CHECK(log.add_block(make_block(9, 1, 0)).first == block_log::unlinkable);
+}
+
+TEST_CASE("block_log keeps several archived blocks alive", "[block_log]")
+{
+   temp_dir dir;
+   subchain::block_log_file archive{dir.path.string()};
+   block_log log;
+   log.open(archive);
+   add_blocks(log, 1, 20);
+   log.irreversible = 15;
+   log.trim();
+
+   std::vector<const block_with_id*> held;
+   for (uint32_t num = 1; num <= 19; ++num)
+      held.push_back(log.block_by_num(num));
+   for (uint32_t num = 1; num <= 19; ++num)
+   {
+      CHECK(held[num - 1]->num == num);
+      CHECK(log.block_by_num(num) == held[num - 1]);
+   }
+
+   log.release_archived();
+   CHECK(log.archived_blocks.empty());
+   CHECK(log.block_by_num(3)->num == 3);
+}
+
+TEST_CASE("BlockLog connection spans archive and memory", "[block_log]")
+{
+   temp_dir dir;
+   subchain::block_log_file archive{dir.path.string()};
+   block_log log;
+   log.open(archive);
+   add_blocks(log, 1, 13);
+   log.irreversible = 6;
+   log.trim();
+   subchain::BlockLog root{log};
+
+   auto all = root.blocks({}, {}, {}, {}, {}, {}, {}, {});
+   CHECK(connection_nums(all) == iota(1, 13));
+
+   auto page = root.blocks({}, 4, {}, 9, 3, {}, {}, {});
+   CHECK(connection_nums(page) == std::vector<uint32_t>{4, 5, 6});
+   CHECK(page.pageInfo.hasNextPage);
+   auto next = root.blocks({}, 4, {}, 9, 3, {}, {}, page.pageInfo.endCursor);
+   CHECK(connection_nums(next) == std::vector<uint32_t>{7, 8, 9});
+   CHECK(!next.pageInfo.hasNextPage);
+
+   auto tail = root.blocks({}, {}, {}, {}, {}, 8, {}, {});
+   CHECK(connection_nums(tail) == iota(5, 13));
+   CHECK(tail.pageInfo.hasPreviousPage);
+}
+
+TEST_CASE("BlockLog connection skips blocks missing from both", "[block_log]")
+{
+   temp_dir dir;
+   subchain::block_log_file archive{dir.path.string()};
+   {
+      block_log first;
+      first.open(archive);
+      add_blocks(first, 1, 6);
+      first.irreversible = 5;
+      first.trim();
+   }
+   REQUIRE(archive.end_num() == 6);
+
+   // Blocks 6 and 7 are in neither the archive nor memory
+   block_log log;
+   for (uint32_t num = 8; num <= 11; ++num)
+      log.blocks.push_back(std::make_unique<block_with_id>(make_block(num)));
+   log.irreversible = 8;
+   log.archive = &archive;
+   subchain::BlockLog root{log};
+
+   subchain::block_num_range range;
+   log.get_range(range);
+   CHECK(*log.lower_bound_by_num(range, 6) == 8);
+   CHECK(*log.upper_bound_by_num(range, 5) == 8);
+   CHECK(*std::prev(log.lower_bound_by_num(range, 8)) == 5);
+   CHECK(!log.block_by_num(6));
+   CHECK(!log.block_by_num(7));
+
+   auto expected = std::vector<uint32_t>{1, 2, 3, 4, 5, 8, 9, 10, 11};
+   CHECK(connection_nums(root.blocks({}, {}, {}, {}, {}, {}, {}, {})) == expected);
+   CHECK(connection_nums(root.blocks({}, 4, 10, {}, {}, {}, {}, {})) ==
+         std::vector<uint32_t>{4, 5, 8, 9});
+   CHECK(connection_nums(root.blocks({}, 6, {}, 7, {}, {}, {}, {})).empty());
+
+   auto page = root.blocks({}, {}, {}, {}, 5, {}, {}, {});
+   CHECK(connection_nums(page) == std::vector<uint32_t>{1, 2, 3, 4, 5});
+   auto next = root.blocks({}, {}, {}, {}, 5, {}, {}, page.pageInfo.endCursor);
+   CHECK(connection_nums(next) == std::vector<uint32_t>{8, 9, 10, 11});
+}
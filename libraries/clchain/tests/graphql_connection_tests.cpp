@@ -0,0 +1,177 @@
+#include <clchain/graphql_connection.hpp>
+
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <vector>
+
+namespace
+{
+   constexpr const char KeyConnection_name[] = "KeyConnection";
+   constexpr const char KeyEdge_name[] = "KeyEdge";
+   using KeyConnection = clchain::Connection<
+       clchain::ConnectionConfig<uint32_t, KeyConnection_name, KeyEdge_name>>;
+
+   struct page_args
+   {
+      std::optional<uint32_t> first;
+      std::optional<uint32_t> last;
+      std::optional<std::string> before;
+      std::optional<std::string> after;
+      std::optional<uint32_t> gt;
+   };
+
+   template <typename Filter>
+   KeyConnection page(const std::vector<uint32_t>& keys,
+                      const page_args& args,
+                      Filter&& filter,
+                      uint32_t max_scan)
+   {
+      return clchain::make_connection<KeyConnection, uint32_t>(
+          args.gt, std::nullopt, std::nullopt, std::nullopt, args.first, args.last, args.before,
+          args.after, keys, [](uint32_t key) { return key; }, [](uint32_t key) { return key; },
+          [](auto& keys, uint32_t key) { return std::lower_bound(keys.begin(), keys.end(), key); },
+          [](auto& keys, uint32_t key) { return std::upper_bound(keys.begin(), keys.end(), key); },
+          filter, max_scan);
+   }
+
+   KeyConnection page(const std::vector<uint32_t>& keys, const page_args& args)
+   {
+      return page(
+          keys, args, [](auto) { return true; }, ~uint32_t(0));
+   }
+
+   std::vector<uint32_t> nodes(const KeyConnection& connection)
+   {
+      std::vector<uint32_t> result;
+      for (auto& edge : connection.edges)
+         result.push_back(edge.node);
+      return result;
+   }
+
+   std::vector<uint32_t> make_keys(uint32_t n)
+   {
+      std::vector<uint32_t> keys(n);
+      for (uint32_t i = 0; i < n; ++i)
+         keys[i] = i;
+      return keys;
+   }
+
+   using key_list = std::vector<uint32_t>;
+}  // namespace
+
+TEST_CASE("connection filter resumes from skipped rows", "[graphql]")
+{
+   auto keys = make_keys(100);
+   auto filter = [](uint32_t key) { return key % 10 == 0; };
+   key_list expected{0, 10, 20, 30, 40, 50, 60, 70, 80, 90};
+
+   SECTION("forward")
+   {
+      key_list found;
+      page_args args{.first = 5};
+      for (int i = 0;; ++i)
+      {
+         REQUIRE(i < 20);
+         auto connection = page(keys, args, filter, 15);
+         CHECK(connection.edges.size() <= 5);
+         CHECK(connection.pageInfo.hasPreviousPage == (i > 0));
+         auto n = nodes(connection);
+         found.insert(found.end(), n.begin(), n.end());
+         if (!connection.pageInfo.hasNextPage)
+            break;
+         REQUIRE(!connection.pageInfo.endCursor.empty());
+         args.after = connection.pageInfo.endCursor;
+      }
+      CHECK(found == expected);
+
+      // The first page stops after 15 rows, on a row the filter skipped
+      auto first = page(keys, {.first = 5}, filter, 15);
+      CHECK(nodes(first) == key_list{0, 10});
+      CHECK(first.pageInfo.hasNextPage);
+      CHECK(first.pageInfo.endCursor == page(keys, {.first = 15}).edges.back().cursor);
+   }
+
+   SECTION("backward")
+   {
+      key_list found;
+      page_args args{.last = 5};
+      for (int i = 0;; ++i)
+      {
+         REQUIRE(i < 20);
+         auto connection = page(keys, args, filter, 15);
+         CHECK(connection.edges.size() <= 5);
+         CHECK(connection.pageInfo.hasNextPage == (i > 0));
+         auto n = nodes(connection);
+         found.insert(found.begin(), n.begin(), n.end());
+         if (!connection.pageInfo.hasPreviousPage)
+            break;
+         REQUIRE(!connection.pageInfo.startCursor.empty());
+         args.before = connection.pageInfo.startCursor;
+      }
+      CHECK(found == expected);
+
+      // The first page stops after rows 99 through 85; 85 was skipped
+      auto last = page(keys, {.last = 5}, filter, 15);
+      CHECK(nodes(last) == key_list{90});
+      CHECK(last.pageInfo.hasPreviousPage);
+      CHECK(last.pageInfo.startCursor == page(keys, {.last = 15}).edges.front().cursor);
+   }
+
+   SECTION("a page which matches nothing still advances")
+   {
+      auto connection = page(keys, {.first = 5, .gt = 0}, filter, 5);
+      CHECK(connection.edges.empty());
+      CHECK(connection.pageInfo.hasNextPage);
+      auto next = page(keys, {.first = 5, .after = connection.pageInfo.endCursor}, filter, 5);
+      CHECK(nodes(next) == key_list{10});
+   }
+}
+
+TEST_CASE("connection first and last together", "[graphql]")
+{
+   auto keys = make_keys(10);
+   auto both = page(keys, {.first = 5, .last = 2});
+   CHECK(nodes(both) == key_list{3, 4});
+   CHECK(both.pageInfo.hasPreviousPage);
+   CHECK(both.pageInfo.hasNextPage);
+   CHECK(both.pageInfo.startCursor == both.edges.front().cursor);
+   CHECK(both.pageInfo.endCursor == both.edges.back().cursor);
+
+   // last larger than the page from first keeps all of it
+   auto all = page(keys, {.first = 3, .last = 5});
+   CHECK(nodes(all) == key_list{0, 1, 2});
+   CHECK(!all.pageInfo.hasPreviousPage);
+   CHECK(all.pageInfo.hasNextPage);
+
+   auto even = page(
+       keys, {.first = 4, .last = 2}, [](uint32_t key) { return key % 2 == 0; }, 100);
+   CHECK(nodes(even) == key_list{4, 6});
+   CHECK(even.pageInfo.hasPreviousPage);
+   CHECK(even.pageInfo.hasNextPage);
+}
+
+TEST_CASE("connection empty results", "[graphql]")
+{
+   auto check_empty = [](const KeyConnection& connection) {
+      CHECK(connection.edges.empty());
+      CHECK(!connection.pageInfo.hasPreviousPage);
+      CHECK(!connection.pageInfo.hasNextPage);
+      CHECK(connection.pageInfo.startCursor.empty());
+      CHECK(connection.pageInfo.endCursor.empty());
+   };
+   check_empty(page({}, {}));
+   check_empty(page({}, {.first = 3}));
+   check_empty(page({}, {.last = 3}));
+   check_empty(page(make_keys(10), {.gt = 20}));
+
+   // Nothing matches; the whole range was scanned, so there's no next page
+   auto keys = make_keys(10);
+   auto none = page(
+       keys, {.first = 3}, [](auto) { return false; }, 100);
+   CHECK(none.edges.empty());
+   CHECK(!none.pageInfo.hasNextPage);
+   auto none_back = page(
+       keys, {.last = 3}, [](auto) { return false; }, 100);
+   CHECK(none_back.edges.empty());
+   CHECK(!none_back.pageInfo.hasPreviousPage);
+}
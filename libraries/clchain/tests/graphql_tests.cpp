@@ -0,0 +1,169 @@
+#include <clchain/graphql_plan.hpp>
+#include <eosio/reflection2.hpp>
+
+#include <catch2/catch.hpp>
+
+namespace
+{
+   struct item
+   {
+      uint32_t id = 0;
+      std::string name;
+   };
+   EOSIO_REFLECT(item, id, name)
+
+   struct root
+   {
+      uint32_t num = 7;
+      std::string text = "hi";
+      std::vector<item> items{{1, "one"}, {2, "two"}, {3, "three"}};
+      std::optional<item> missing;
+
+      const item* byId(uint32_t id) const
+      {
+         for (auto& i : items)
+            if (i.id == id)
+               return &i;
+         return nullptr;
+      }
+
+      std::vector<item> range(uint32_t ge, std::optional<uint32_t> lt) const
+      {
+         std::vector<item> result;
+         for (auto& i : items)
+            if (i.id >= ge && (!lt || i.id < *lt))
+               result.push_back(i);
+         return result;
+      }
+
+      std::string echo(std::string s) const { return s; }
+   };
+   EOSIO_REFLECT2(root,
+                  num,
+                  text,
+                  items,
+                  missing,
+                  method(byId, "id"),
+                  method(range, "ge", "lt"),
+                  method(echo, "s"))
+
+   std::string query(std::string_view q, std::string_view variables = {})
+   {
+      return clchain::gql_query(root{}, q, variables);
+   }
+
+   std::string error(const std::string& message)
+   {
+      return R"({"errors":{"message":)" + eosio::convert_to_json(message) + "}}";
+   }
+}  // namespace
+
+TEST_CASE("graphql fields", "[graphql]")
+{
+   CHECK(query("{num text}") == R"({"data":{"num":7,"text":"hi"}})");
+   CHECK(query("query { num }") == R"({"data":{"num":7}})");
+   CHECK(query("query Named { num }") == R"({"data":{"num":7}})");
+   CHECK(query("{items{id} missing{id}}") ==
+         R"({"data":{"items":[{"id":1},{"id":2},{"id":3}],"missing":null}})");
+   CHECK(query("{a: num b: num items{x: name}}") ==
+         R"({"data":{"a":7,"b":7,"items":[{"x":"one"},{"x":"two"},{"x":"three"}]}})");
+   CHECK(query(" {\n  num , # comment\n  text\n}\n") == R"({"data":{"num":7,"text":"hi"}})");
+}
+
+TEST_CASE("graphql method args", "[graphql]")
+{
+   CHECK(query("{byId(id: 2) {name}}") == R"({"data":{"byId":{"name":"two"}}})");
+   CHECK(query("{byId(id: 5) {name}}") == R"({"data":{"byId":null}})");
+   CHECK(query("{range(ge: 2) {id}}") == R"({"data":{"range":[{"id":2},{"id":3}]}})");
+   CHECK(query("{range(ge: 1, lt: 3) {id}}") == R"({"data":{"range":[{"id":1},{"id":2}]}})");
+   CHECK(query("{range(lt: 3, ge: 2) {id}}") == R"({"data":{"range":[{"id":2}]}})");
+   CHECK(query("{range(ge: 1, lt: null) {id}}") ==
+         R"({"data":{"range":[{"id":1},{"id":2},{"id":3}]}})");
+   CHECK(query(R"({echo(s: "a b")})") == R"({"data":{"echo":"a b"}})");
+}
+
+TEST_CASE("graphql variables", "[graphql]")
+{
+   auto q = "query ($id: Int!) { byId(id: $id) {name} }";
+   CHECK(query(q, R"({"id": 3})") == R"({"data":{"byId":{"name":"three"}}})");
+   CHECK(query(q, R"({"id": 1, "unused": "x"})") == R"({"data":{"byId":{"name":"one"}}})");
+   CHECK(query(q, "{}") == error("missing variable '$id'"));
+
+   auto r = "query q($ge: Int!, $lt: Int) { range(ge: $ge, lt: $lt) {id} }";
+   CHECK(query(r, R"({"ge": 2})") == R"({"data":{"range":[{"id":2},{"id":3}]}})");
+   CHECK(query(r, R"({"ge": 1, "lt": null})") ==
+         R"({"data":{"range":[{"id":1},{"id":2},{"id":3}]}})");
+   CHECK(query(r, R"({"ge": 1, "lt": 2})") == R"({"data":{"range":[{"id":1}]}})");
+   CHECK(query("query ($s: String!) { echo(s: $s) }", R"({"s": "x y"})") ==
+         R"({"data":{"echo":"x y"}})");
+
+   // A plan binds variables per execution; the literal args it holds are unchanged
+   auto plan = clchain::gql_prepare<root>("query ($lt: Int) { range(ge: 2, lt: $lt) {id} }");
+   REQUIRE(plan.error.empty());
+   CHECK(clchain::gql_query(root{}, plan, R"({"lt": 3})") == R"({"data":{"range":[{"id":2}]}})");
+   CHECK(clchain::gql_query(root{}, plan, "{}") == R"({"data":{"range":[{"id":2},{"id":3}]}})");
+   CHECK(clchain::gql_query(root{}, plan, R"({"lt": 4})") ==
+         R"({"data":{"range":[{"id":2},{"id":3}]}})");
+}
+
+TEST_CASE("graphql errors", "[graphql]")
+{
+   for (auto q : {
+            "{nope}",
+            "{num",
+            "{items}",
+            "{num{id}}",
+            "{byId {name}}",
+            "{byId(id: 1, bad: 2) {name}}",
+            "{byId(id: \"x\") {name}}",
+            "query ($id: Int!) { byId(id: $other) {name} }",
+            "mutation { num }",
+        })
+   {
+      INFO(q);
+      auto result = query(q, R"({"id": 1})");
+      CHECK(result.starts_with(R"({"errors":{"message":)"));
+   }
+   CHECK(query("{num}", "[1]").starts_with(R"({"errors":)"));
+   CHECK(query("{num}", R"({"a": {"b": 1}})").starts_with(R"({"errors":)"));
+}
+
+TEST_CASE("graphql binary response", "[graphql]")
+{
+   auto query_bin = [](std::string_view q, std::string_view variables = {}) {
+      return clchain::gql_query_bin(root{}, clchain::gql_prepare<root>(q), variables);
+   };
+   auto bin = [](const auto&... values) {
+      std::vector<char> result;
+      eosio::vector_stream stream{result};
+      (eosio::to_bin(values, stream), ...);
+      return std::string(result.begin(), result.end());
+   };
+   auto ok = char(0);
+   auto error = char(1);
+
+   CHECK(query_bin("{num text}") == bin(ok, uint32_t(7), std::string("hi")));
+
+   // Lists have a varuint32 count (1 byte when below 128); objects are their selected fields
+   // in selection order
+   CHECK(query_bin("{items{name id}}") ==
+         bin(ok, uint8_t(3), std::string("one"), uint32_t(1), std::string("two"),
+             uint32_t(2), std::string("three"), uint32_t(3)));
+
+   // Nullable values have a bool prefix
+   CHECK(query_bin("{missing{id} byId(id: 2){id} other: byId(id: 9){id}}") ==
+         bin(ok, false, true, uint32_t(2), false));
+
+   CHECK(query_bin("query ($ge: Int!) { range(ge: $ge) {id} }", R"({"ge": 3})") ==
+         bin(ok, uint8_t(1), uint32_t(3)));
+
+   // Errors are a string after the 1 byte; the partial response is dropped
+   CHECK(query_bin("{num nope}")[0] == error);
+   CHECK(query_bin("query ($ge: Int!) { num range(ge: $ge) {id} }", "{}") ==
+         bin(error, std::string("missing variable '$ge'")));
+
+   auto schema = clchain::get_gql_schema<root>(nullptr, true);
+   CHECK(schema.find(R"(num: Float! @bin(type: "uint32"))") != std::string::npos);
+   CHECK(schema.find(R"(name: String! @bin(type: "string"))") != std::string::npos);
+   CHECK(schema.find("items: [item!]!\n") != std::string::npos);
+}
@@ -0,0 +1,161 @@
+#include <boost/multi_index/key.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index_container.hpp>
+#include <chainbase/chainbase.hpp>
+#include <chainbase/node_pool.hpp>
+#include <chainbase/snapshot.hpp>
+
+#include <catch2/catch.hpp>
+
+namespace
+{
+   struct by_id;
+
+   struct test_object : public chainbase::object<0, test_object>
+   {
+      CHAINBASE_DEFAULT_CONSTRUCTOR(test_object)
+
+      id_type id;
+      uint32_t value = 0;
+   };
+   EOSIO_REFLECT(test_object, value)
+
+   using test_index = chainbase::generic_index<boost::multi_index_container<
+       test_object,
+       boost::multi_index::indexed_by<
+           boost::multi_index::ordered_unique<boost::multi_index::tag<by_id>,
+                                              boost::multi_index::key<&test_object::id>>>,
+       chainbase::pool_allocator<test_object>>>;
+
+   std::vector<std::pair<int64_t, uint32_t>> contents(const test_index& index)
+   {
+      std::vector<std::pair<int64_t, uint32_t>> result;
+      for (auto& obj : index)
+         result.emplace_back(obj.id._id, obj.value);
+      return result;
+   }
+
+   const test_object& add(test_index& index, uint32_t value)
+   {
+      return index.emplace([&](auto& obj) { obj.value = value; });
+   }
+
+   void set(test_index& index, int64_t id, uint32_t value)
+   {
+      index.modify(index.get(id), [&](auto& obj) { obj.value = value; });
+   }
+
+   struct snapshot
+   {
+      std::vector<char> bin;
+      uint64_t revision = 0;
+   };
+
+   snapshot write(test_index& index, std::optional<uint64_t> base)
+   {
+      snapshot result;
+      eosio::vector_stream stream{result.bin};
+      result.revision = chainbase::write_snapshot(index, base, stream);
+      return result;
+   }
+
+   // Number of objects stored in a section
+   uint32_t num_objects(const snapshot& s, bool delta)
+   {
+      eosio::input_stream stream{s.bin};
+      uint64_t revision, base, next_id;
+      eosio::from_bin(revision, stream);
+      if (delta)
+         eosio::from_bin(base, stream);
+      eosio::from_bin(next_id, stream);
+      auto num_runs = eosio::varuint32_from_bin(stream);
+      for (uint32_t i = 0; i < 2 * num_runs; ++i)
+         eosio::varuint32_from_bin(stream);
+      return eosio::varuint32_from_bin(stream);
+   }
+
+   uint64_t read(test_index& index, std::optional<uint64_t> base, const snapshot& s)
+   {
+      eosio::input_stream stream{s.bin};
+      auto revision = chainbase::read_snapshot(index, base, stream);
+      CHECK(stream.remaining() == 0);
+      return revision;
+   }
+}  // namespace
+
+TEST_CASE("snapshot_revision has no side effects", "[snapshot]")
+{
+   test_index index;
+   add(index, 1);
+   auto r = index.snapshot_revision();
+   CHECK(index.snapshot_revision() == r);
+   index.advance_snapshot_revision();
+   CHECK(index.snapshot_revision() == r + 1);
+}
+
+TEST_CASE("snapshot round trip", "[snapshot]")
+{
+   test_index source;
+   for (uint32_t i = 0; i < 6; ++i)
+      add(source, i * 10);
+   source.remove(source.get(2));
+
+   auto full = write(source, std::nullopt);
+   CHECK(num_objects(full, false) == 5);
+
+   test_index dest;
+   add(dest, 99);  // replaced by the snapshot
+   CHECK(read(dest, std::nullopt, full) == full.revision);
+   CHECK(contents(dest) == contents(source));
+   CHECK(dest.committed_next_id() == source.committed_next_id());
+
+   SECTION("a change right after writing is in the next delta")
+   {
+      set(source, 1, 11);
+      auto delta = write(source, full.revision);
+      CHECK(num_objects(delta, true) == 1);
+      read(dest, full.revision, delta);
+      CHECK(contents(dest) == contents(source));
+   }
+
+   SECTION("deltas chain")
+   {
+      set(source, 3, 33);
+      source.remove(source.get(4));
+      add(source, 60);
+      auto delta1 = write(source, full.revision);
+      CHECK(num_objects(delta1, true) == 2);
+
+      add(source, 70);
+      auto delta2 = write(source, delta1.revision);
+      CHECK(num_objects(delta2, true) == 1);
+
+      // Deltas only apply to the state they were written against
+      CHECK_THROWS(read(dest, full.revision, delta2));
+      read(dest, full.revision, delta1);
+      read(dest, delta1.revision, delta2);
+      CHECK(contents(dest) == contents(source));
+
+      // Objects created after restoring don't reuse ids
+      CHECK(add(dest, 80).id == add(source, 80).id);
+   }
+
+   SECTION("only the committed state is written")
+   {
+      auto committed = contents(source);
+      auto session = source.start_undo_session(true);
+      set(source, 0, 1000);
+      add(source, 2000);
+      auto delta1 = write(source, full.revision);
+      CHECK(num_objects(delta1, true) == 0);
+      read(dest, full.revision, delta1);
+      CHECK(contents(dest) == committed);
+
+      session.push();
+      source.commit(source.revision());
+      auto delta2 = write(source, delta1.revision);
+      CHECK(num_objects(delta2, true) == 2);
+      read(dest, delta1.revision, delta2);
+      CHECK(contents(dest) == contents(source));
+   }
+}
@@ -0,0 +1,391 @@
+// Randomized tests which run the same operations on an undo_index and on a simple model of
+// it, and check that the two agree after every operation.
+
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/key.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index_container.hpp>
+#include <chainbase/chainbase.hpp>
+#include <chainbase/node_pool.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <map>
+#include <random>
+
+namespace
+{
+   struct by_id;
+   struct by_key;
+
+   struct model_object : public chainbase::object<0, model_object>
+   {
+      CHAINBASE_DEFAULT_CONSTRUCTOR(model_object)
+
+      id_type id;
+      uint32_t key = 0;
+      uint32_t value = 0;
+   };
+
+   // Few distinct hashes, so that most lookups probe past other keys
+   struct colliding_hash
+   {
+      std::size_t operator()(uint32_t key) const { return key & 7; }
+   };
+
+   template <typename KeyIndex>
+   using model_index = chainbase::generic_index<boost::multi_index_container<
+       model_object,
+       boost::multi_index::indexed_by<
+           boost::multi_index::ordered_unique<boost::multi_index::tag<by_id>,
+                                              boost::multi_index::key<&model_object::id>>,
+           KeyIndex>,
+       chainbase::pool_allocator<model_object>>>;
+
+   using hashed_key = boost::multi_index::hashed_unique<  //
+       boost::multi_index::tag<by_key>,
+       boost::multi_index::key<&model_object::key>,
+       colliding_hash>;
+
+   using btree_key = chainbase::btree_unique<  //
+       boost::multi_index::tag<by_key>,
+       boost::multi_index::key<&model_object::key>>;
+
+   template <typename KeyIndex>
+   constexpr bool is_ordered = !std::is_same_v<KeyIndex, hashed_key>;
+
+   struct model
+   {
+      std::map<int64_t, std::pair<uint32_t, uint32_t>> rows;  // id => key, value
+      std::map<uint32_t, int64_t> ids;                        // key => id
+      int64_t next_id = 0;
+
+      const int64_t* find_key(uint32_t key) const
+      {
+         auto it = ids.find(key);
+         return it == ids.end() ? nullptr : &it->second;
+      }
+      void set(int64_t id, uint32_t key, uint32_t value)
+      {
+         auto [it, inserted] = rows.try_emplace(id);
+         if (!inserted)
+            ids.erase(it->second.first);
+         it->second = {key, value};
+         ids[key] = id;
+      }
+      void remove(int64_t id)
+      {
+         ids.erase(rows[id].first);
+         rows.erase(id);
+      }
+   };
+
+   struct model_config
+   {
+      uint32_t num_keys;
+      uint32_t num_ops;
+      uint32_t phase_length;  // Alternates between growing and shrinking
+      uint32_t check_every;   // Steps between full comparisons, besides those after undo
+   };
+
+   template <typename KeyIndex>
+   void check_equal(const model_index<KeyIndex>& index,
+                    const model& m,
+                    uint32_t num_keys,
+                    std::mt19937& rng)
+   {
+      REQUIRE(index.size() == m.rows.size());
+      auto it = m.rows.begin();
+      for (auto& obj : index)
+      {
+         REQUIRE(obj.id._id == it->first);
+         REQUIRE(obj.key == it->second.first);
+         REQUIRE(obj.value == it->second.second);
+         ++it;
+      }
+      auto& by_key_index = index.template get<by_key>();
+      REQUIRE(size_t(std::distance(by_key_index.begin(), by_key_index.end())) == m.rows.size());
+      for (uint32_t key = 0; key < num_keys; ++key)
+      {
+         auto found = by_key_index.find(key);
+         if (auto* id = m.find_key(key))
+         {
+            REQUIRE(found != by_key_index.end());
+            REQUIRE(found->id._id == *id);
+         }
+         else
+            REQUIRE(found == by_key_index.end());
+      }
+      if constexpr (is_ordered<KeyIndex>)
+      {
+         auto it = m.ids.begin();
+         for (auto& obj : by_key_index)
+         {
+            REQUIRE(obj.id._id == it->second);
+            ++it;
+         }
+         if (!m.ids.empty())
+            REQUIRE(std::prev(by_key_index.end())->id._id == m.ids.rbegin()->second);
+         for (int i = 0; i < 8; ++i)
+         {
+            auto key = std::uniform_int_distribution<uint32_t>{0, num_keys}(rng);
+            auto lower = m.ids.lower_bound(key);
+            auto upper = m.ids.upper_bound(key);
+            auto index_lower = by_key_index.lower_bound(key);
+            auto index_upper = by_key_index.upper_bound(key);
+            REQUIRE((lower == m.ids.end()) == (index_lower == by_key_index.end()));
+            if (lower != m.ids.end())
+               REQUIRE(index_lower->id._id == lower->second);
+            REQUIRE((upper == m.ids.end()) == (index_upper == by_key_index.end()));
+            if (upper != m.ids.end())
+               REQUIRE(index_upper->id._id == upper->second);
+         }
+      }
+   }
+
+   template <typename KeyIndex>
+   void run_model(uint32_t seed, const model_config& config)
+   {
+      auto num_keys = config.num_keys;
+      std::mt19937 rng{seed};
+      auto random = [&](uint32_t n) {
+         return std::uniform_int_distribution<uint32_t>{0, n - 1}(rng);
+      };
+      auto random_row = [&](model& m) {
+         return std::next(m.rows.begin(), random(m.rows.size()));
+      };
+      auto unused_key = [&](model& m) {
+         for (;;)
+            if (auto key = random(num_keys); !m.find_key(key))
+               return key;
+      };
+
+      model_index<KeyIndex> index;
+      model current;
+      std::vector<model> sessions;  // The state at the start of each undo session
+
+      for (uint32_t i = 0; i < config.num_ops; ++i)
+      {
+         // Growing phases mostly emplace and shrinking phases mostly remove
+         bool grow = (i / config.phase_length) % 2 == 0;
+         uint32_t emplace_end = grow ? 60 : 15;
+         uint32_t modify_end = emplace_end + 10;
+         uint32_t swap_end = modify_end + 5;
+         uint32_t remove_end = swap_end + (grow ? 10 : 55);
+         auto op = random(100);
+         if (op < emplace_end && current.rows.size() < num_keys - 8)
+         {
+            auto key = random(num_keys);
+            auto value = random(1000);
+            auto emplace = [&] {
+               return index.emplace([&](auto& obj) {
+                  obj.key = key;
+                  obj.value = value;
+               });
+            };
+            if (current.find_key(key))
+               CHECK_THROWS(emplace());
+            else
+            {
+               REQUIRE(emplace().id._id == current.next_id);
+               current.set(current.next_id++, key, value);
+            }
+         }
+         else if (op < modify_end && !current.rows.empty())
+         {
+            // A conflicting key would remove the object instead of reverting it, unless the
+            // session has a backup; that's covered by other tests.
+            auto it = random_row(current);
+            auto key = random(3) ? unused_key(current) : it->second.first;
+            auto value = random(1000);
+            index.modify(index.get(it->first), [&](auto& obj) {
+               obj.key = key;
+               obj.value = value;
+            });
+            current.set(it->first, key, value);
+         }
+         else if (op < swap_end && current.rows.size() >= 2)
+         {
+            // Swapping keys leaves transient duplicates for undo to resolve
+            auto a = random_row(current);
+            auto b = std::next(a) == current.rows.end() ? current.rows.begin() : std::next(a);
+            auto temp = unused_key(current);
+            auto a_key = a->second.first;
+            auto b_key = b->second.first;
+            index.modify(index.get(a->first), [&](auto& obj) { obj.key = temp; });
+            index.modify(index.get(b->first), [&](auto& obj) { obj.key = a_key; });
+            index.modify(index.get(a->first), [&](auto& obj) { obj.key = b_key; });
+            current.set(a->first, temp, a->second.second);
+            current.set(b->first, a_key, b->second.second);
+            current.set(a->first, b_key, a->second.second);
+         }
+         else if (op < remove_end && !current.rows.empty())
+         {
+            auto id = random_row(current)->first;
+            index.remove(index.get(id));
+            current.remove(id);
+         }
+         else if (op < 91 && sessions.size() < 8)
+         {
+            index.start_undo_session(true).push();
+            sessions.push_back(current);
+         }
+         else if (op < 94 && !sessions.empty())
+         {
+            index.undo();
+            current = std::move(sessions.back());
+            sessions.pop_back();
+            check_equal<KeyIndex>(index, current, num_keys, rng);
+            continue;
+         }
+         else if (op < 97 && !sessions.empty())
+         {
+            index.squash();
+            sessions.pop_back();
+         }
+         else if (!sessions.empty())
+         {
+            index.commit(index.revision());
+            sessions.clear();
+         }
+         REQUIRE(index.size() == current.rows.size());
+         if (i % config.check_every == 0)
+            check_equal<KeyIndex>(index, current, num_keys, rng);
+      }
+
+      while (!sessions.empty())
+      {
+         index.undo();
+         current = std::move(sessions.back());
+         sessions.pop_back();
+         check_equal<KeyIndex>(index, current, num_keys, rng);
+      }
+   }
+}  // namespace
+
+TEST_CASE("hashed_unique matches the model", "[undo_index]")
+{
+   for (uint32_t seed = 1; seed <= 20; ++seed)
+   {
+      INFO("seed " << seed);
+      run_model<hashed_key>(seed, {64, 2000, 100, 1});
+   }
+}
+
+TEST_CASE("btree_unique matches the model", "[undo_index]")
+{
+   // Enough keys for several levels of inner nodes, in phases long enough to split and then
+   // merge most of the leaves
+   for (uint32_t seed = 1; seed <= 2; ++seed)
+   {
+      INFO("seed " << seed);
+      run_model<btree_key>(seed, {16384, 20000, 5000, 50});
+   }
+}
+
+TEST_CASE("hashed_unique modify conflicts", "[undo_index]")
+{
+   model_index<hashed_key> index;
+   auto& a = index.emplace([](auto& obj) { obj.key = 1; });
+   auto& b = index.emplace([](auto& obj) { obj.key = 9; });  // same hash as 1
+   auto& by_key_index = index.get<by_key>();
+
+   SECTION("reverted when the session has a backup")
+   {
+      index.start_undo_session(true).push();
+      CHECK_THROWS(index.modify(b, [](auto& obj) { obj.key = 1; }));
+      CHECK(index.size() == 2);
+      CHECK(by_key_index.find(9)->id == b.id);
+      index.undo();
+      CHECK(by_key_index.find(1)->id == a.id);
+      CHECK(by_key_index.find(9)->id == b.id);
+   }
+
+   SECTION("removed without one")
+   {
+      CHECK_THROWS(index.modify(b, [](auto& obj) { obj.key = 1; }));
+      CHECK(index.size() == 1);
+      CHECK(by_key_index.find(1)->id == a.id);
+      CHECK(by_key_index.find(9) == by_key_index.end());
+   }
+}
+
+TEST_CASE("btree_unique ordering", "[undo_index]")
+{
+   model_index<btree_key> index;
+   auto& by_key_index = index.get<by_key>();
+   CHECK(by_key_index.begin() == by_key_index.end());
+   CHECK(by_key_index.lower_bound(0) == by_key_index.end());
+
+   // Even keys, inserted out of order, across many leaves
+   for (uint32_t i = 0; i < 5000; ++i)
+      index.emplace([&](auto& obj) { obj.key = (i * 7919 % 5000) * 2; });
+
+   uint32_t expected = 0;
+   for (auto& obj : by_key_index)
+   {
+      REQUIRE(obj.key == expected);
+      expected += 2;
+   }
+   CHECK(expected == 10000);
+   for (auto it = by_key_index.rbegin(); it != by_key_index.rend(); ++it)
+   {
+      expected -= 2;
+      REQUIRE(it->key == expected);
+   }
+   for (uint32_t key = 0; key < 10001; ++key)
+   {
+      auto lower = by_key_index.lower_bound(key);
+      auto upper = by_key_index.upper_bound(key);
+      uint32_t expected_lower = (key + 1) / 2 * 2;
+      uint32_t expected_upper = key / 2 * 2 + 2;
+      REQUIRE((lower == by_key_index.end()) == (expected_lower >= 10000));
+      REQUIRE((upper == by_key_index.end()) == (expected_upper >= 10000));
+      if (lower != by_key_index.end())
+         REQUIRE(lower->key == expected_lower);
+      if (upper != by_key_index.end())
+         REQUIRE(upper->key == expected_upper);
+      REQUIRE((by_key_index.find(key) != by_key_index.end()) == (key % 2 == 0 && key < 10000));
+   }
+   CHECK(std::prev(by_key_index.end())->key == 9998);
+   CHECK(by_key_index.iterator_to(*by_key_index.find(1234))->key == 1234);
+}
+
+TEST_CASE("btree_unique undo after merges", "[undo_index]")
+{
+   model_index<btree_key> index;
+   auto& by_key_index = index.get<by_key>();
+   for (uint32_t i = 0; i < 5000; ++i)
+      index.emplace([&](auto& obj) { obj.key = i; });
+
+   auto keys = [&] {
+      std::vector<uint32_t> result;
+      for (auto& obj : by_key_index)
+         result.push_back(obj.key);
+      return result;
+   };
+   auto before = keys();
+
+   index.start_undo_session(true).push();
+   // Removing most keys merges leaves and then inner nodes
+   std::vector<uint32_t> kept;
+   for (uint32_t i = 0; i < 5000; ++i)
+   {
+      if (i % 50 == 0)
+         kept.push_back(i);
+      else
+         index.remove(*by_key_index.find(i));
+   }
+   CHECK(keys() == kept);
+   // Moving the remaining keys past the end reorders them through the merged leaves
+   for (auto key : kept)
+      index.modify(*by_key_index.find(key), [](auto& obj) { obj.key += 10000; });
+   CHECK(by_key_index.begin()->key == 10000);
+
+   index.undo();
+   CHECK(keys() == before);
+   for (uint32_t i = 0; i < 5000; i += 97)
+      REQUIRE(by_key_index.find(i)->id._id == i);
+   CHECK(by_key_index.lower_bound(4999)->key == 4999);
+   CHECK(by_key_index.upper_bound(4999) == by_key_index.end());
+}
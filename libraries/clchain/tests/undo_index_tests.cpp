@@ -0,0 +1,290 @@
+#include <boost/multi_index/key.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index_container.hpp>
+#include <chainbase/chainbase.hpp>
+#include <chainbase/node_pool.hpp>
+
+#include <catch2/catch.hpp>
+#include <set>
+
+namespace
+{
+   struct by_id;
+
+   struct test_object : public chainbase::object<0, test_object>
+   {
+      CHAINBASE_DEFAULT_CONSTRUCTOR(test_object)
+
+      id_type id;
+      uint32_t value = 0;
+   };
+
+   using test_index = chainbase::generic_index<boost::multi_index_container<
+       test_object,
+       boost::multi_index::indexed_by<
+           boost::multi_index::ordered_unique<boost::multi_index::tag<by_id>,
+                                              boost::multi_index::key<&test_object::id>>>,
+       chainbase::pool_allocator<test_object>>>;
+
+   // Not trivially copyable, so a no-op modify is only detected through operator==
+   struct member_object : public chainbase::object<1, member_object>
+   {
+      CHAINBASE_DEFAULT_CONSTRUCTOR(member_object)
+
+      id_type id;
+      std::string account;
+      bool participating = false;
+
+      bool operator==(const member_object&) const = default;
+   };
+
+   using member_index = chainbase::generic_index<boost::multi_index_container<
+       member_object,
+       boost::multi_index::indexed_by<
+           boost::multi_index::ordered_unique<boost::multi_index::tag<by_id>,
+                                              boost::multi_index::key<&member_object::id>>>,
+       chainbase::pool_allocator<member_object>>>;
+
+   const test_object& add(test_index& index, uint32_t value)
+   {
+      return index.emplace([&](auto& obj) { obj.value = value; });
+   }
+
+   void set(test_index& index, int64_t id, uint32_t value)
+   {
+      index.modify(index.get(id), [&](auto& obj) { obj.value = value; });
+   }
+
+   template <typename Id>
+   std::vector<int64_t> ids(const std::vector<Id>& v)
+   {
+      std::vector<int64_t> result;
+      for (auto id : v)
+         result.push_back(id._id);
+      return result;
+   }
+
+   using id_list = std::vector<int64_t>;
+}  // namespace
+
+TEST_CASE("changes_since", "[undo_index]")
+{
+   test_index index;
+   for (uint32_t i = 0; i < 4; ++i)
+      add(index, i);
+   auto base = index.revision();
+
+   index.start_undo_session(true).push();
+   set(index, 0, 10);
+   index.remove(index.get(1));
+   add(index, 4);
+
+   index.start_undo_session(true).push();
+   set(index, 4, 40);  // created, then modified
+   set(index, 2, 20);
+   index.remove(index.get(2));  // modified, then removed
+   index.remove(index.get(0));
+   index.remove(index.get(4));  // created, then removed
+   add(index, 5);
+
+   CHECK(index.undo_stack_revision_range() == std::pair<int64_t, int64_t>{base, base + 2});
+   CHECK(!index.changes_since(base - 1));
+   CHECK(!index.changes_since(base + 3));
+
+   auto all = index.changes_since(base);
+   REQUIRE(all);
+   CHECK(ids(all->created) == id_list{5});
+   CHECK(ids(all->modified) == id_list{});
+   CHECK(ids(all->removed) == id_list{0, 1, 2});
+
+   auto last = index.changes_since(base + 1);
+   REQUIRE(last);
+   CHECK(ids(last->created) == id_list{5});
+   CHECK(ids(last->modified) == id_list{});
+   CHECK(ids(last->removed) == id_list{0, 2, 4});
+
+   auto none = index.changes_since(base + 2);
+   REQUIRE(none);
+   CHECK(none->created.empty());
+   CHECK(none->modified.empty());
+   CHECK(none->removed.empty());
+
+   SECTION("committed changes are no longer tracked")
+   {
+      index.commit(base + 1);
+      CHECK(!index.changes_since(base));
+      CHECK(index.changes_since(base + 1));
+   }
+
+   SECTION("a revision is reused after undo")
+   {
+      index.undo();
+      index.start_undo_session(true).push();
+      set(index, 3, 30);
+      // The same revision now names a different state; the index can't tell the difference
+      auto reused = index.changes_since(base + 1);
+      REQUIRE(reused);
+      CHECK(ids(reused->created) == id_list{});
+      CHECK(ids(reused->modified) == id_list{3});
+      CHECK(ids(reused->removed) == id_list{});
+   }
+}
+
+TEST_CASE("no-op modify", "[undo_index]")
+{
+   member_index index;
+   for (auto account : {"alice", "pip", "egeon", "ahab"})
+      index.emplace([&](auto& obj) { obj.account = account; });
+   auto base = index.revision();
+   index.start_undo_session(true).push();
+
+   // Like clear_participating: modify every row, though none of them change
+   for (auto& obj : index)
+      index.modify(obj, [](auto& obj) { obj.participating = false; });
+   auto stats = index.undo_stats();
+   REQUIRE(stats.size() == 1);
+   CHECK(stats[0].old_values == 0);
+   auto changes = index.changes_since(base);
+   REQUIRE(changes);
+   CHECK(changes->modified.empty());
+
+   index.modify(index.get(2), [](auto& obj) { obj.participating = true; });
+   CHECK(index.undo_stats()[0].old_values == 1);
+   changes = index.changes_since(base);
+   REQUIRE(changes);
+   CHECK(ids(changes->modified) == id_list{2});
+
+   index.undo();
+   CHECK(!index.get(2).participating);
+
+   SECTION("trivially copyable objects")
+   {
+      test_index index;
+      add(index, 7);
+      index.start_undo_session(true).push();
+      set(index, 0, 7);
+      CHECK(index.undo_stats()[0].old_values == 0);
+      set(index, 0, 8);
+      CHECK(index.undo_stats()[0].old_values == 1);
+   }
+}
+
+TEST_CASE("node_pool", "[undo_index]")
+{
+   using chainbase::node_pool;
+   constexpr auto g = node_pool::granularity;
+   node_pool pool;
+   auto check_stats = [&](uint64_t live, uint64_t free, uint64_t block_size) {
+      auto stats = pool.get_stats();
+      CHECK(stats.live_nodes == live);
+      CHECK(stats.free_nodes == free);
+      CHECK(stats.live_bytes == live * block_size);
+      CHECK(stats.free_bytes == free * block_size);
+   };
+
+   auto a = pool.allocate(g + 1);
+   auto b = pool.allocate(2 * g);
+   auto c = pool.allocate(g + 1);
+   CHECK(a != b);
+   CHECK(b != c);
+   check_stats(3, 0, 2 * g);
+   CHECK(pool.get_stats().slab_bytes == node_pool::slab_size);
+
+   pool.deallocate(b, 2 * g);
+   check_stats(2, 1, 2 * g);
+   CHECK(pool.allocate(g + 1) == b);
+   check_stats(3, 0, 2 * g);
+
+   // Other size classes don't draw from this one's free list
+   pool.deallocate(a, g + 1);
+   auto d = pool.allocate(g);
+   CHECK(d != a);
+   CHECK(pool.get_stats().free_nodes == 1);
+   pool.deallocate(d, g);
+   CHECK(pool.allocate(g) == d);
+   CHECK(pool.allocate(2 * g) == a);
+
+   auto large = pool.allocate(node_pool::max_size + 1);
+   CHECK(pool.get_stats().large_nodes == 1);
+   CHECK(pool.get_stats().large_bytes == node_pool::max_size + 1);
+   CHECK(pool.get_stats().live_nodes == 4);
+   pool.deallocate(large, node_pool::max_size + 1);
+   CHECK(pool.get_stats().large_nodes == 0);
+   CHECK(pool.get_stats().large_bytes == 0);
+
+   // Each size class carves its own slab
+   CHECK(pool.get_stats().slab_bytes == 2 * node_pool::slab_size);
+}
+
+TEST_CASE("node_pool sessions", "[undo_index]")
+{
+   auto& pool = chainbase::get_node_pool();
+   auto live = [&] { return pool.get_stats().live_nodes; };
+   auto live_before = live();
+   {
+      test_index index;
+      for (uint32_t i = 0; i < 100; ++i)
+         add(index, i);
+
+      // The undo stack keeps its storage once allocated
+      {
+         auto session = index.start_undo_session(true);
+         auto inner = index.start_undo_session(true);
+      }
+      auto live_committed = live();
+
+      // Modifies 50 rows, removes 25, and adds 25. Returns the new rows' addresses.
+      auto block = [&](uint32_t value) {
+         std::vector<int64_t> all;
+         for (auto& obj : index)
+            all.push_back(obj.id._id);
+         for (size_t i = 0; i < 50; ++i)
+            set(index, all[i], value);
+         for (size_t i = all.size() - 25; i < all.size(); ++i)
+            index.remove(index.get(all[i]));
+         std::set<const void*> created;
+         for (uint32_t i = 0; i < 25; ++i)
+            created.insert(&add(index, value));
+         return created;
+      };
+
+      for (uint32_t round = 0; round < 3; ++round)
+      {
+         std::set<const void*> undone;
+         chainbase::node_pool::stats in_session;
+         {
+            auto session = index.start_undo_session(true);
+            undone = block(2);
+            in_session = pool.get_stats();
+            CHECK(in_session.live_nodes > live_committed);
+         }
+         CHECK(live() == live_committed);
+         CHECK(pool.get_stats().free_nodes ==
+               in_session.free_nodes + in_session.live_nodes - live_committed);
+
+         // Undo freed those rows, so the next block gets them back
+         {
+            auto session = index.start_undo_session(true);
+            CHECK(block(3) == undone);
+            session.push();
+            auto inner = index.start_undo_session(true);
+            block(4);
+            inner.squash();
+         }
+         CHECK(index.undo_stack_revision_range().second ==
+               index.undo_stack_revision_range().first + 1);
+         index.undo();
+         CHECK(live() == live_committed);
+
+         {
+            auto session = index.start_undo_session(true);
+            block(5);
+            session.push();
+         }
+         index.commit(index.revision());
+         CHECK(index.size() == 100);
+         CHECK(live() == live_committed);
+      }
+   }
+   CHECK(live() == live_before);
+}
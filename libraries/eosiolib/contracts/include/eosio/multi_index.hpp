@@ -496,6 +496,201 @@ namespace eosio
          static constexpr eosio::fixed_bytes<32> true_lowest() { return eosio::fixed_bytes<32>(); }
       };
 
+#ifdef EOSIO_MULTI_INDEX_ITEM_CACHE
+      // Maps uint64_t keys to non-null pointers, using open addressing with linear probing
+      template <typename V>
+      class pointer_map
+      {
+        public:
+         V* find(uint64_t key) const
+         {
+            if (slots.empty())
+               return nullptr;
+            for (size_t i = home(key);; i = (i + 1) & mask())
+               if (!slots[i].value || slots[i].key == key)
+                  return slots[i].value;
+         }
+
+         // key must not be present
+         void insert(uint64_t key, V* value)
+         {
+            if ((count + 1) * 2 > slots.size())
+               grow();
+            size_t i = home(key);
+            while (slots[i].value)
+               i = (i + 1) & mask();
+            slots[i] = {key, value};
+            ++count;
+         }
+
+         void erase(uint64_t key)
+         {
+            if (slots.empty())
+               return;
+            size_t i = home(key);
+            for (; slots[i].value; i = (i + 1) & mask())
+               if (slots[i].key == key)
+                  break;
+            if (!slots[i].value)
+               return;
+            --count;
+            // Shift later members of the probe sequence back so lookups don't stop early
+            for (size_t j = (i + 1) & mask(); slots[j].value; j = (j + 1) & mask())
+            {
+               size_t h = home(slots[j].key);
+               if (((j - h) & mask()) >= ((j - i) & mask()))
+               {
+                  slots[i] = slots[j];
+                  i = j;
+               }
+            }
+            slots[i].value = nullptr;
+         }
+
+         template <typename F>
+         void for_each(F&& f) const
+         {
+            for (auto& slot : slots)
+               if (slot.value)
+                  f(slot.value);
+         }
+
+         void swap(pointer_map& other)
+         {
+            std::swap(slots, other.slots);
+            std::swap(count, other.count);
+            std::swap(shift, other.shift);
+         }
+
+        private:
+         struct slot
+         {
+            uint64_t key = 0;
+            V* value = nullptr;
+         };
+         std::vector<slot> slots;
+         size_t count = 0;
+         uint32_t shift = 64;
+
+         size_t mask() const { return slots.size() - 1; }
+         size_t home(uint64_t key) const { return (key * 0x9e37'79b9'7f4a'7c15) >> shift; }
+
+         void grow()
+         {
+            auto old = std::move(slots);
+            slots.assign(old.empty() ? 16 : old.size() * 2, {});
+            shift = 64 - __builtin_ctzll(slots.size());
+            count = 0;
+            for (auto& slot : old)
+               if (slot.value)
+                  insert(slot.key, slot.value);
+         }
+      };
+
+      // Owns the items a multi_index has loaded, and finds them by primary key or by primary
+      // iterator. Item storage is allocated in chunks and recycled through a free list.
+      template <typename Item>
+      class item_cache
+      {
+        public:
+         item_cache() = default;
+         item_cache(const item_cache&) = delete;
+         item_cache(item_cache&& other) { swap(other); }
+         item_cache& operator=(const item_cache&) = delete;
+         item_cache& operator=(item_cache&& other)
+         {
+            swap(other);
+            return *this;
+         }
+         ~item_cache()
+         {
+            by_primary_key.for_each([](Item* item) { item->~Item(); });
+         }
+
+         Item* find_by_primary_key(uint64_t pk) const { return by_primary_key.find(pk); }
+         Item* find_by_primary_itr(int32_t itr) const { return by_primary_itr.find(uint32_t(itr)); }
+
+         // Constructs an item. add() indexes it once its primary key and iterator are known.
+         template <typename... A>
+         Item* create(A&&... a)
+         {
+            block* b = allocate();
+            struct release_on_throw
+            {
+               item_cache* self;
+               block* b;
+               ~release_on_throw()
+               {
+                  if (b)
+                     self->release(b);
+               }
+            } guard{this, b};
+            auto* result = new (b->storage) Item(std::forward<A>(a)...);
+            guard.b = nullptr;
+            return result;
+         }
+
+         void add(Item* item, uint64_t pk, int32_t itr)
+         {
+            by_primary_key.insert(pk, item);
+            by_primary_itr.insert(uint32_t(itr), item);
+         }
+
+         void destroy(Item* item, uint64_t pk, int32_t itr)
+         {
+            by_primary_key.erase(pk);
+            by_primary_itr.erase(uint32_t(itr));
+            item->~Item();
+            release(reinterpret_cast<block*>(item));
+         }
+
+        private:
+         union block
+         {
+            block* next;
+            alignas(Item) unsigned char storage[sizeof(Item)];
+         };
+
+         pointer_map<Item> by_primary_key;
+         pointer_map<Item> by_primary_itr;
+         std::vector<std::unique_ptr<block[]>> chunks;
+         block* free_list = nullptr;
+         size_t chunk_size = 0;
+         size_t chunk_used = 0;
+
+         block* allocate()
+         {
+            if (auto* b = free_list)
+            {
+               free_list = b->next;
+               return b;
+            }
+            if (chunk_used == chunk_size)
+            {
+               chunk_size = chunk_size ? std::min(chunk_size * 2, size_t(256)) : 8;
+               chunks.push_back(std::make_unique<block[]>(chunk_size));
+               chunk_used = 0;
+            }
+            return &chunks.back()[chunk_used++];
+         }
+
+         void release(block* b)
+         {
+            b->next = free_list;
+            free_list = b;
+         }
+
+         void swap(item_cache& other)
+         {
+            by_primary_key.swap(other.by_primary_key);
+            by_primary_itr.swap(other.by_primary_itr);
+            std::swap(chunks, other.chunks);
+            std::swap(free_list, other.free_list);
+            std::swap(chunk_size, other.chunk_size);
+            std::swap(chunk_used, other.chunk_used);
+         }
+      };
+#endif
    }  // namespace _multi_index_detail
 
    /**
@@ -646,6 +841,14 @@ namespace eosio
          int32_t __iters[sizeof...(Indices) + (sizeof...(Indices) == 0)];
       };
 
+      // Loaded items. By default they're found by searching a vector, which is quadratic in
+      // the number of rows an action touches; defining EOSIO_MULTI_INDEX_ITEM_CACHE finds them
+      // through hash maps instead. Every source file of a contract must agree on it. The cache is
+      // experimental: neither test-sdk's verify action nor item-cache-bench's billed CPU has been
+      // run under cltester yet, so deployed contracts shouldn't define it.
+#ifdef EOSIO_MULTI_INDEX_ITEM_CACHE
+      mutable _multi_index_detail::item_cache<item> _item_cache;
+#else
       struct item_ptr
       {
          item_ptr(std::unique_ptr<item>&& i, uint64_t pk, int32_t pitr)
@@ -659,6 +862,7 @@ namespace eosio
       };
 
       mutable std::vector<item_ptr> _items_vector;
+#endif
 
       template <name::raw IndexName, typename Extractor, uint64_t Number, bool IsConst>
       struct index
@@ -1015,10 +1219,15 @@ namespace eosio
       {
          using namespace _multi_index_detail;
 
+#ifdef EOSIO_MULTI_INDEX_ITEM_CACHE
+         if (auto* cached = _item_cache.find_by_primary_itr(itr))
+            return *cached;
+#else
          auto itr2 = std::find_if(_items_vector.rbegin(), _items_vector.rend(),
                                   [&](const item_ptr& ptr) { return ptr._primary_itr == itr; });
          if (itr2 != _items_vector.rend())
             return *itr2->_item;
+#endif
 
          auto size = internal_use_do_not_use::db_get_i64(itr, nullptr, 0);
          eosio::check(size >= 0, "error reading iterator");
@@ -1032,7 +1241,7 @@ namespace eosio
 
          datastream<const char*> ds((char*)buffer, uint32_t(size));
 
-         auto itm = std::make_unique<item>(this, [&](auto& i) {
+         auto loader = [&](auto& i) {
             T& val = static_cast<T&>(i);
             ds >> val;
 
@@ -1042,13 +1251,20 @@ namespace eosio
 
                i.__iters[index_type::number()] = -1;
             });
-         });
+         };
+
+#ifdef EOSIO_MULTI_INDEX_ITEM_CACHE
+         const item* ptr = _item_cache.create(this, loader);
+         _item_cache.add(const_cast<item*>(ptr), ptr->primary_key(), itr);
+#else
+         auto itm = std::make_unique<item>(this, loader);
 
          const item* ptr = itm.get();
          auto pk = itm->primary_key();
          auto pitr = itm->__primary_itr;
 
          _items_vector.emplace_back(std::move(itm), pk, pitr);
+#endif
 
          if (max_stack_buffer_size < size_t(size))
          {
@@ -1872,7 +2088,7 @@ namespace eosio
                                                                      // shouldn't allow mutation.
                                                                      // Real fix can come in RC2.
 
-         auto itm = std::make_unique<item>(this, [&](auto& i) {
+         auto init = [&](auto& i) {
             T& obj = static_cast<T&>(i);
             constructor(obj);
 
@@ -1907,13 +2123,20 @@ namespace eosio
                        db_idx_store(_scope, index_type::name(), payer.value, obj.primary_key(),
                                     index_type::extract_secondary_key(obj));
             });
-         });
+         };
+
+#ifdef EOSIO_MULTI_INDEX_ITEM_CACHE
+         const item* ptr = _item_cache.create(this, init);
+         _item_cache.add(const_cast<item*>(ptr), ptr->primary_key(), ptr->__primary_itr);
+#else
+         auto itm = std::make_unique<item>(this, init);
 
          const item* ptr = itm.get();
          auto pk = itm->primary_key();
          auto pitr = itm->__primary_itr;
 
          _items_vector.emplace_back(std::move(itm), pk, pitr);
+#endif
 
          return {this, ptr};
       }
@@ -2157,11 +2380,16 @@ namespace eosio
        */
       const_iterator find(uint64_t primary) const
       {
+#ifdef EOSIO_MULTI_INDEX_ITEM_CACHE
+         if (auto* cached = _item_cache.find_by_primary_key(primary))
+            return iterator_to(*cached);
+#else
          auto itr2 =
              std::find_if(_items_vector.rbegin(), _items_vector.rend(),
                           [&](const item_ptr& ptr) { return ptr._item->primary_key() == primary; });
          if (itr2 != _items_vector.rend())
             return iterator_to(*(itr2->_item));
+#endif
 
          auto itr = internal_use_do_not_use::db_find_i64(_code.value, _scope,
                                                          static_cast<uint64_t>(TableName), primary);
@@ -2185,11 +2413,16 @@ namespace eosio
       const_iterator require_find(uint64_t primary,
                                   const char* error_msg = "unable to find key") const
       {
+#ifdef EOSIO_MULTI_INDEX_ITEM_CACHE
+         if (auto* cached = _item_cache.find_by_primary_key(primary))
+            return iterator_to(*cached);
+#else
          auto itr2 =
              std::find_if(_items_vector.rbegin(), _items_vector.rend(),
                           [&](const item_ptr& ptr) { return ptr._item->primary_key() == primary; });
          if (itr2 != _items_vector.rend())
             return iterator_to(*(itr2->_item));
+#endif
 
          auto itr = internal_use_do_not_use::db_find_i64(_code.value, _scope,
                                                          static_cast<uint64_t>(TableName), primary);
@@ -2299,12 +2532,17 @@ namespace eosio
                                                                     // Real fix can come in RC2.
 
          auto pk = objitem.primary_key();
+#ifdef EOSIO_MULTI_INDEX_ITEM_CACHE
+         eosio::check(_item_cache.find_by_primary_key(pk) == &objitem,
+                      "attempt to remove object that was not in multi_index");
+#else
          auto itr2 =
              std::find_if(_items_vector.rbegin(), _items_vector.rend(),
                           [&](const item_ptr& ptr) { return ptr._item->primary_key() == pk; });
 
          eosio::check(itr2 != _items_vector.rend(),
                       "attempt to remove object that was not in multi_index");
+#endif
 
          internal_use_do_not_use::db_remove_i64(objitem.__primary_itr);
 
@@ -2324,7 +2562,11 @@ namespace eosio
                    i);
          });
 
+#ifdef EOSIO_MULTI_INDEX_ITEM_CACHE
+         _item_cache.destroy(const_cast<item*>(&objitem), pk, objitem.__primary_itr);
+#else
          _items_vector.erase(--(itr2.base()));
+#endif
       }
 
       /**
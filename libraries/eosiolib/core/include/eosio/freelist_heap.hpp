@@ -0,0 +1,334 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace eosio
+{
+   // Single-threaded heap for long-running wasm programs. Unlike dsmalloc, it reuses freed
+   // memory:
+   //
+   // * Small blocks are kept on exact-size free lists and reused without coalescing.
+   // * Larger blocks are coalesced with free neighbours using boundary tags and kept in
+   //   power-of-two bins. Allocation picks the best fit in the smallest usable bin and
+   //   splits off the remainder.
+   // * If no free block fits, small free blocks are coalesced into the bins and the search
+   //   is repeated before the heap grows.
+   //
+   // Memory must provide:
+   //    char* begin():                        start of the heap
+   //    char* end():                          end of the memory currently available
+   //    char* grow(char* end, size_t bytes):  extend memory which currently ends at end by at
+   //                                          least bytes; returns the new end or nullptr
+   template <typename Memory>
+   class freelist_heap
+   {
+     public:
+      static constexpr size_t alignment = 16;
+      static constexpr size_t max_small = 256;
+
+      constexpr freelist_heap() = default;
+      constexpr explicit freelist_heap(const Memory& memory) : memory{memory} {}
+
+      void* allocate(size_t size)
+      {
+         if (size > max_request)
+            return nullptr;
+         if (!top && !init())
+            return nullptr;
+         auto bsize = block_size(size);
+         if (bsize <= small_limit && small[bsize / alignment])
+         {
+            auto b = small[bsize / alignment];
+            small[bsize / alignment] = next_free(b);
+            return payload(b);
+         }
+         auto b = take_from_bins(bsize);
+         if (!b && has_small)
+         {
+            consolidate();
+            b = take_from_bins(bsize);
+         }
+         if (!b)
+            b = take_from_top(bsize);
+         return b ? payload(b) : nullptr;
+      }
+
+      void* allocate_aligned(size_t size, size_t align)
+      {
+         if (align <= alignment)
+            return allocate(size);
+         if (size > max_request - align - min_block)
+            return nullptr;
+         auto p = static_cast<char*>(allocate(size + align + min_block));
+         if (!p)
+            return nullptr;
+         auto aligned = reinterpret_cast<char*>((uintptr_t(p) + align - 1) & ~(align - 1));
+         if (aligned == p)
+            return p;
+         if (size_t(aligned - p) < min_block)
+            aligned += align;
+         auto front = header(p);
+         auto front_size = aligned - p;
+         auto b = header(aligned);
+         set_head(b, size_of(front) - front_size, in_use | prev_in_use);
+         set_head(front, front_size, in_use | (head(front) & prev_in_use));
+         deallocate(p);
+         return aligned;
+      }
+
+      void* reallocate(void* p, size_t size)
+      {
+         if (!p)
+            return allocate(size);
+         if (size > max_request)
+            return nullptr;
+         auto b = header(p);
+         auto bsize = block_size(size);
+         auto old_size = size_of(b);
+         if (bsize <= old_size)
+            return p;
+         auto next = b + old_size;
+         if (old_size > small_limit)
+         {
+            if (next == top && grow_top(b + bsize))
+            {
+               set_head(b, bsize, head(b) & flags);
+               top = b + bsize;
+               set_head(top, 0, prev_in_use);
+               return p;
+            }
+            if (next != top && !(head(next) & in_use) && old_size + size_of(next) >= bsize)
+            {
+               unlink(next);
+               set_head(b, old_size + size_of(next), head(b) & flags);
+               split(b, bsize);
+               return p;
+            }
+         }
+         auto result = allocate(size);
+         if (result)
+         {
+            memcpy(result, p, old_size - word);
+            deallocate(p);
+         }
+         return result;
+      }
+
+      void deallocate(void* p)
+      {
+         if (!p)
+            return;
+         auto b = header(p);
+         auto size = size_of(b);
+         if (size <= small_limit)
+         {
+            set_next_free(b, small[size / alignment]);
+            small[size / alignment] = b;
+            has_small = true;
+         }
+         else
+            release(b);
+      }
+
+      // Bytes obtained from Memory
+      size_t footprint() const { return top ? heap_end - heap_begin : 0; }
+
+     private:
+      static constexpr size_t word = sizeof(size_t);
+      static constexpr size_t in_use = 1;
+      static constexpr size_t prev_in_use = 2;
+      static constexpr size_t flags = in_use | prev_in_use;
+      static constexpr size_t round_up(size_t size)
+      {
+         return (size + alignment - 1) & ~(alignment - 1);
+      }
+      static constexpr size_t min_block = round_up(4 * word);
+      static constexpr size_t small_limit = round_up(max_small + word);
+      static constexpr size_t num_small = small_limit / alignment + 1;
+      static constexpr size_t num_bins = sizeof(size_t) * 8;
+      static constexpr size_t max_request = ~size_t(0) / 2;
+
+      struct links
+      {
+         char* next;
+         char* prev;
+      };
+
+      static size_t block_size(size_t size)
+      {
+         auto result = round_up(size + word);
+         return result < min_block ? min_block : result;
+      }
+      static char* header(void* p) { return static_cast<char*>(p) - word; }
+      static void* payload(char* b) { return b + word; }
+      static size_t& head(char* b) { return *reinterpret_cast<size_t*>(b); }
+      static size_t size_of(char* b) { return head(b) & ~flags; }
+      static void set_head(char* b, size_t size, size_t f) { head(b) = size | f; }
+      static void set_foot(char* b, size_t size) { head(b + size - word) = size; }
+      static char*& next_free(char* b) { return *reinterpret_cast<char**>(b + word); }
+      static void set_next_free(char* b, char* next) { next_free(b) = next; }
+      static links& links_of(char* b) { return *reinterpret_cast<links*>(b + word); }
+      static size_t bin_of(size_t size)
+      {
+         size_t result = 0;
+         while (size >>= 1)
+            ++result;
+         return result;
+      }
+
+      bool init()
+      {
+         auto begin = memory.begin();
+         heap_begin = reinterpret_cast<char*>(round_up(uintptr_t(begin) + word) - word);
+         heap_end = memory.end();
+         top = heap_begin;
+         if (!grow_top(top))
+         {
+            top = nullptr;
+            return false;
+         }
+         set_head(top, 0, prev_in_use);
+         return true;
+      }
+
+      // Ensures that a block may start at new_top
+      bool grow_top(char* new_top)
+      {
+         if (new_top + word <= heap_end)
+            return true;
+         auto new_end = memory.grow(heap_end, new_top + word - heap_end);
+         if (!new_end)
+            return false;
+         heap_end = new_end;
+         return true;
+      }
+
+      void link(char* b)
+      {
+         auto& bin = bins[bin_of(size_of(b))];
+         links_of(b) = {bin, nullptr};
+         if (bin)
+            links_of(bin).prev = b;
+         bin = b;
+      }
+
+      void unlink(char* b)
+      {
+         auto& l = links_of(b);
+         if (l.prev)
+            links_of(l.prev).next = l.next;
+         else
+            bins[bin_of(size_of(b))] = l.next;
+         if (l.next)
+            links_of(l.next).prev = l.prev;
+      }
+
+      // Marks b in use, returning any remainder beyond size to the bins
+      void split(char* b, size_t size)
+      {
+         auto total = size_of(b);
+         if (total - size >= min_block)
+         {
+            set_head(b, size, in_use | (head(b) & prev_in_use));
+            auto rest = b + size;
+            set_head(rest, total - size, in_use | prev_in_use);
+            release(rest);
+         }
+         else
+         {
+            head(b) |= in_use;
+            head(b + total) |= prev_in_use;
+         }
+      }
+
+      char* take_from_bins(size_t size)
+      {
+         for (auto i = bin_of(size); i < num_bins; ++i)
+         {
+            char* best = nullptr;
+            for (auto b = bins[i]; b; b = links_of(b).next)
+            {
+               auto s = size_of(b);
+               if (s >= size && (!best || s < size_of(best)))
+               {
+                  best = b;
+                  if (s == size || i != bin_of(size))
+                     break;
+               }
+            }
+            if (best)
+            {
+               unlink(best);
+               split(best, size);
+               return best;
+            }
+         }
+         return nullptr;
+      }
+
+      char* take_from_top(size_t size)
+      {
+         if (!grow_top(top + size))
+            return nullptr;
+         auto b = top;
+         set_head(b, size, in_use | (head(b) & prev_in_use));
+         top = b + size;
+         set_head(top, 0, prev_in_use);
+         return b;
+      }
+
+      // Coalesces b with its free neighbours, then returns it to the bins or the top
+      void release(char* b)
+      {
+         auto size = size_of(b);
+         if (!(head(b) & prev_in_use))
+         {
+            auto prev_size = head(b - word);
+            b -= prev_size;
+            unlink(b);
+            size += prev_size;
+         }
+         auto prev_flag = head(b) & prev_in_use;
+         auto next = b + size;
+         if (next == top)
+         {
+            top = b;
+            set_head(top, 0, prev_flag);
+            return;
+         }
+         if (!(head(next) & in_use))
+         {
+            unlink(next);
+            size += size_of(next);
+         }
+         set_head(b, size, prev_flag);
+         set_foot(b, size);
+         head(b + size) &= ~prev_in_use;
+         link(b);
+      }
+
+      void consolidate()
+      {
+         for (auto& list : small)
+         {
+            while (list)
+            {
+               auto b = list;
+               list = next_free(b);
+               release(b);
+            }
+         }
+         has_small = false;
+      }
+
+      Memory memory = {};
+      char* heap_begin = nullptr;
+      char* heap_end = nullptr;
+      char* top = nullptr;
+      bool has_small = false;
+      char* small[num_small] = {};
+      char* bins[num_bins] = {};
+   };
+}  // namespace eosio
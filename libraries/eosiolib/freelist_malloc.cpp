@@ -0,0 +1,90 @@
+#include <eosio/freelist_heap.hpp>
+
+#include <errno.h>
+
+#ifdef EOSIO_NATIVE
+extern "C"
+{
+   size_t _current_memory();
+   size_t _grow_memory(size_t);
+}
+#define CURRENT_MEMORY _current_memory()
+#define GROW_MEMORY(X) _grow_memory(X)
+#else
+#define CURRENT_MEMORY __builtin_wasm_memory_size(0)
+#define GROW_MEMORY(X) __builtin_wasm_memory_grow(0, X)
+#endif
+
+extern "C" char __heap_base;
+
+// Drop-in replacement for simple_malloc.cpp which reuses freed memory. Link this instead of
+// simple-malloc in programs which run for longer than a single action.
+namespace eosio
+{
+   struct wasm_memory
+   {
+      static constexpr size_t wasm_page_size = 64 * 1024;
+
+      char* begin() const { return &__heap_base; }
+      char* end() const { return reinterpret_cast<char*>(CURRENT_MEMORY * wasm_page_size); }
+      char* grow(char* end, size_t bytes) const
+      {
+         [[clang::import_name("eosio_assert"), noreturn]] void eosio_assert(uint32_t, const char*);
+         if (end != this->end())
+            eosio_assert(false, "memory was grown outside of malloc");
+         size_t pages = (bytes + wasm_page_size - 1) / wasm_page_size;
+         if (GROW_MEMORY(pages) == -1)
+            eosio_assert(false, "failed to allocate pages");
+         return end + pages * wasm_page_size;
+      }
+   };
+
+   constinit freelist_heap<wasm_memory> _freelist_heap;
+}  // namespace eosio
+
+extern "C"
+{
+   void* malloc(size_t size)
+   {
+      if (size == 0)
+         return nullptr;
+      return eosio::_freelist_heap.allocate(size);
+   }
+
+   int posix_memalign(void** memptr, size_t alignment, size_t size)
+   {
+      if (alignment < sizeof(void*) || (alignment & (alignment - size_t(1))) != 0)
+         return EINVAL;
+      if (size == 0)
+      {
+         *memptr = nullptr;
+         return 0;
+      }
+      *memptr = eosio::_freelist_heap.allocate_aligned(size, alignment);
+      return *memptr ? 0 : ENOMEM;
+   }
+
+   void* calloc(size_t count, size_t size)
+   {
+      if (size && count > ~size_t(0) / size)
+         return nullptr;
+      if (void* ptr = malloc(count * size))
+      {
+         memset(ptr, 0, count * size);
+         return ptr;
+      }
+      return nullptr;
+   }
+
+   void* realloc(void* ptr, size_t size)
+   {
+      if (ptr && size == 0)
+      {
+         eosio::_freelist_heap.deallocate(ptr);
+         return nullptr;
+      }
+      return eosio::_freelist_heap.reallocate(ptr, size);
+   }
+
+   void free(void* ptr) { eosio::_freelist_heap.deallocate(ptr); }
+}
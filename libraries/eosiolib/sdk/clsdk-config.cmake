@@ -40,6 +40,12 @@ function(add_libs suffix)
         COMMAND ${WASI_SDK_PREFIX}/bin/llvm-ar d libc-no-malloc${suffix}.a dlmalloc.o
     )
 
+    add_library(freelist-malloc${suffix} EXCLUDE_FROM_ALL)
+    target_link_libraries(freelist-malloc${suffix} PUBLIC wasm-base${suffix})
+    target_include_directories(freelist-malloc${suffix} PRIVATE ${clsdk_DIR}/eosiolib/core/include)
+    target_sources(freelist-malloc${suffix} PRIVATE ${clsdk_DIR}/eosiolib/freelist_malloc.cpp)
+    add_dependencies(freelist-malloc${suffix} simple-malloc${suffix})
+
     add_library(eosio-core${suffix} INTERFACE)
     target_include_directories(eosio-core${suffix} INTERFACE ${clsdk_DIR}/eosiolib/core/include)
     target_link_libraries(eosio-core${suffix} INTERFACE
@@ -79,6 +85,19 @@ function(add_libs suffix)
         ${WASI_SDK_PREFIX}/lib/clang/11.0.0/lib/wasi/libclang_rt.builtins-wasm32.a
     )
 
+    # Contract with a free-list malloc/free
+    add_library(eosio-contract-freelist-malloc${suffix} INTERFACE)
+    target_link_libraries(eosio-contract-freelist-malloc${suffix} INTERFACE
+        -L${CMAKE_CURRENT_BINARY_DIR}
+        eosio-contract-base${suffix}
+        -lc++
+        -lc++abi
+        -lc-no-malloc${suffix}
+        freelist-malloc${suffix}
+        -leosio-contracts-wasi-polyfill${suffix}
+        ${WASI_SDK_PREFIX}/lib/clang/11.0.0/lib/wasi/libclang_rt.builtins-wasm32.a
+    )
+
     # Contract with full malloc/free
     add_library(eosio-contract-full-malloc${suffix} INTERFACE)
     target_link_libraries(eosio-contract-full-malloc${suffix} INTERFACE
@@ -174,6 +174,11 @@ namespace eosio
       uint32_t id;
       std::optional<block_info> head_block_info;
 
+      struct fork_tag
+      {
+      };
+      test_chain(fork_tag, uint32_t id);
+
      public:
       static const public_key default_pub_key;
       static const private_key default_priv_key;
@@ -184,6 +189,22 @@ namespace eosio
 
       test_chain& operator=(const test_chain&) = delete;
 
+      /**
+       * Creates a new chain with a copy of this chain's state and block history. The two chains
+       * then advance independently.
+       *
+       * This modifies this chain if a block is pending: a snapshot can't hold a pending block, so
+       * fork() finishes it first. Transactions pushed since the last finish_block() end up in a
+       * head block which both chains share, and this chain's next transaction starts a new
+       * block. Call finish_block() before forking to keep block boundaries explicit.
+       *
+       * The state is cached until this chain's head changes, so a suite can build a fixture
+       * once, then fork it for each test.
+       *
+       * Experimental: test-sdk's "fork" case hasn't been run under cltester yet.
+       */
+      test_chain fork();
+
       /**
        * Shuts down the chain to allow copying its state file. The chain's temporary path will
        * live until this object destructs.
@@ -15,6 +15,7 @@ namespace
       [[clang::import_name("tester_exec_deferred")]]               bool     tester_exec_deferred(uint32_t chain_index, void* cb_alloc_data, cb_alloc_type cb_alloc);
       [[clang::import_name("tester_execute")]]                     int32_t  tester_execute(const char* command, uint32_t command_size);
       [[clang::import_name("tester_finish_block")]]                void     tester_finish_block(uint32_t chain_index);
+      [[clang::import_name("tester_fork_chain")]]                  uint32_t tester_fork_chain(uint32_t chain);
       [[clang::import_name("tester_get_chain_path")]]              uint32_t tester_get_chain_path(uint32_t chain, char* dest, uint32_t dest_size);
       [[clang::import_name("tester_get_head_block_info")]]         void     tester_get_head_block_info(uint32_t chain_index, void* cb_alloc_data, cb_alloc_type cb_alloc);
       [[clang::import_name("tester_push_transaction")]]            void     tester_push_transaction(uint32_t chain_index, const char* args_packed, uint32_t args_packed_size, void* cb_alloc_data, cb_alloc_type cb_alloc);
@@ -189,6 +190,17 @@ eosio::test_chain::test_chain(const char* snapshot, uint64_t state_size)
    current_chain = this;
 }
 
+eosio::test_chain::test_chain(fork_tag, uint32_t id) : id{id}
+{
+   current_chain = this;
+}
+
+eosio::test_chain eosio::test_chain::fork()
+{
+   head_block_info.reset();
+   return {fork_tag{}, ::tester_fork_chain(id)};
+}
+
 eosio::test_chain::~test_chain()
 {
    current_chain = nullptr;
@@ -0,0 +1,4 @@
+#include "item-cache.hpp"
+
+EOSIO_ACTION_DISPATCHER(item_cache::actions)
+EOSIO_ABIGEN(actions(item_cache::actions))
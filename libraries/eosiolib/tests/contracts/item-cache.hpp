@@ -0,0 +1,159 @@
+#include <eosio/eosio.hpp>
+#include <eosio/multi_index.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Touches many rows per action, the way eden's distribute_monthly and gc_sessions do. Built
+// twice, with and without EOSIO_MULTI_INDEX_ITEM_CACHE; see item-cache-bench.cpp and test-sdk.
+namespace item_cache
+{
+   struct row
+   {
+      uint64_t id;
+      eosio::name owner;
+      int64_t balance;
+      std::string memo;
+
+      uint64_t primary_key() const { return id; }
+      uint64_t by_owner() const { return owner.value; }
+   };
+   EOSIO_REFLECT(row, id, owner, balance, memo)
+
+   using row_table = eosio::multi_index<
+       "rows"_n,
+       row,
+       eosio::indexed_by<"byowner"_n, eosio::const_mem_fun<row, uint64_t, &row::by_owner>>>;
+
+   using verify_table = eosio::multi_index<"verify"_n, row>;
+
+   class contract : public eosio::contract
+   {
+     public:
+      using eosio::contract::contract;
+
+      void fill(uint32_t count)
+      {
+         row_table table{get_self(), get_self().value};
+         for (uint32_t i = 0; i < count; ++i)
+            table.emplace(get_self(), [&](auto& r) {
+               r.id = i;
+               r.owner = eosio::name{uint64_t(i) << 32};
+               r.balance = i;
+               r.memo = "row";
+            });
+      }
+
+      // Scans the table, then looks up each row by primary key and modifies every fourth one
+      void touch(uint32_t passes)
+      {
+         row_table table{get_self(), get_self().value};
+         int64_t total = 0;
+         for (uint32_t pass = 0; pass < passes; ++pass)
+         {
+            std::vector<uint64_t> ids;
+            for (auto& r : table)
+               ids.push_back(r.id);
+            for (auto id : ids)
+            {
+               auto& r = table.get(id);
+               total += r.balance;
+               if (id % 4 == pass % 4)
+                  table.modify(r, eosio::same_payer, [&](auto& r) { ++r.balance; });
+            }
+            auto idx = table.get_index<"byowner"_n>();
+            for (auto it = idx.begin(); it != idx.end(); ++it)
+               total += it->balance;
+         }
+         eosio::check(total != 0, "table is empty");
+      }
+
+      // Randomly emplaces, modifies, and erases rows, checking find, erase, and reloading
+      // against a model. With EOSIO_MULTI_INDEX_ITEM_CACHE it also checks that an erased item's
+      // storage is reused. Leaves the table empty.
+      void verify(uint32_t count)
+      {
+         verify_table table{get_self(), get_self().value};
+         eosio::check(table.begin() == table.end(), "table isn't empty");
+         std::map<uint64_t, int64_t> model;
+         uint64_t state = count;
+         auto random = [&](uint64_t n) {
+            state = state * 6364136223846793005 + 1442695040888963407;
+            return (state >> 33) % n;
+         };
+         auto emplace = [&](uint64_t id, int64_t balance) {
+            model[id] = balance;
+            return table.emplace(get_self(), [&](auto& r) {
+               r.id = id;
+               r.owner = eosio::name{id};
+               r.balance = balance;
+               r.memo = "verify";
+            });
+         };
+         auto check_row = [&](uint64_t id) {
+            auto it = table.find(id);
+            auto expected = model.find(id);
+            if (expected == model.end())
+            {
+               eosio::check(it == table.end(), "found an erased row");
+               return;
+            }
+            eosio::check(it != table.end() && it->id == id && it->balance == expected->second,
+                         "found the wrong row");
+            eosio::check(&*it == &table.get(id), "loaded a row twice");
+         };
+
+         for (uint32_t i = 0; i < count * 4; ++i)
+         {
+            uint64_t id = random(count * 2);
+            auto it = table.find(id);
+            if (it == table.end())
+               emplace(id, i);
+            else if (random(2))
+            {
+               table.modify(it, eosio::same_payer, [&](auto& r) { r.balance = i; });
+               model[id] = i;
+            }
+            else
+            {
+               const void* erased = &*it;
+               table.erase(it);
+               model.erase(id);
+               auto reused = emplace(count * 2 + i, i);
+#ifdef EOSIO_MULTI_INDEX_ITEM_CACHE
+               eosio::check(&*reused == erased, "erased item's storage wasn't reused");
+#else
+               (void)reused;
+               (void)erased;
+#endif
+            }
+            check_row(id);
+            check_row(random(count * 2));
+         }
+
+         // A new table loads every row from the database again
+         verify_table reloaded{get_self(), get_self().value};
+         auto expected = model.begin();
+         for (auto& r : reloaded)
+         {
+            eosio::check(expected != model.end() && r.id == expected->first &&
+                             r.balance == expected->second,
+                         "reloaded the wrong row");
+            ++expected;
+         }
+         eosio::check(expected == model.end(), "reloaded too few rows");
+         for (auto& [id, balance] : model)
+            check_row(id);
+
+         for (auto it = table.begin(); it != table.end();)
+            it = table.erase(it);
+      }
+   };
+
+   EOSIO_ACTIONS(contract,
+                 "itemcache"_n,
+                 action(fill, count),
+                 action(touch, passes),
+                 action(verify, count))
+}  // namespace item_cache
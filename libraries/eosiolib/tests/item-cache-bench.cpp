@@ -0,0 +1,64 @@
+// Compares the billed CPU of contract actions which touch many rows, with multi_index's linear
+// search of loaded items and with EOSIO_MULTI_INDEX_ITEM_CACHE. Both builds of the contract
+// run on one chain under different accounts. EOSIO_MULTI_INDEX_ITEM_CACHE stays experimental until
+// this has recorded its numbers.
+//
+//    cltester item-cache-bench.wasm [rows] [passes]
+
+#include <eosio/tester.hpp>
+
+#include "contracts/item-cache.hpp"
+
+#include <cstdio>
+#include <string>
+
+using namespace eosio;
+
+int main(int argc, char** argv)
+{
+   uint32_t rows = argc > 1 ? std::stoul(argv[1]) : 500;
+   uint32_t passes = argc > 2 ? std::stoul(argv[2]) : 2;
+
+   struct build
+   {
+      name account;
+      const char* wasm;
+   };
+   const build builds[] = {
+       {"linear"_n, "test-contracts/item-cache.wasm"},
+       {"hashed"_n, "test-contracts/item-cache-hashed.wasm"},
+   };
+
+   test_chain chain;
+   for (auto& b : builds)
+   {
+      chain.create_code_account(b.account);
+      chain.set_code(b.account, b.wasm);
+      chain.as(b.account).with_code(b.account).act<item_cache::actions::fill>(rows);
+   }
+   chain.finish_block();
+
+   printf("%u rows, %u passes\n", rows, passes);
+   int64_t base = 0;
+   for (auto& b : builds)
+   {
+      int64_t best = 0;
+      uint32_t billed = 0;
+      for (int i = 0; i < 5; ++i)
+      {
+         chain.start_block();
+         auto trace =
+             chain.as(b.account).with_code(b.account).trace<item_cache::actions::touch>(passes);
+         expect(trace);
+         if (!best || trace.elapsed < best)
+         {
+            best = trace.elapsed;
+            billed = trace.cpu_usage_us;
+         }
+      }
+      if (!base)
+         base = best;
+      printf("%-8s elapsed %8lld us  billed %8u us  %5.2fx\n", b.account.to_string().c_str(),
+             (long long)best, billed, double(base) / best);
+   }
+}
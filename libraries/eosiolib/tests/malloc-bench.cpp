@@ -0,0 +1,140 @@
+// Compares freelist_heap (freelist_malloc.cpp) with this program's own malloc, which is
+// wasi-libc's dlmalloc; eden-micro-chain and other programs which link the full libc use it.
+// simple_malloc.cpp never frees, so its footprint would be the total bytes allocated, which
+// is reported for comparison.
+//
+//    cltester malloc-bench.wasm [ops]
+
+#include <eosio/freelist_heap.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+struct region
+{
+   char* base;
+   char* limit;
+   char* begin() const { return base; }
+   char* end() const { return base; }
+   char* grow(char* end, size_t bytes) const
+   {
+      auto result = end + (bytes + 0xffff) / 0x10000 * 0x10000;
+      return result <= limit ? result : nullptr;
+   }
+};
+
+// The program's malloc. Its footprint is how much wasm memory grew; run it before anything
+// else allocates much, since dlmalloc never returns memory.
+struct libc_heap
+{
+   size_t initial_pages = __builtin_wasm_memory_size(0);
+
+   void* allocate(size_t size) { return malloc(size); }
+   void deallocate(void* p) { free(p); }
+   void* reallocate(void* p, size_t size) { return realloc(p, size); }
+   size_t footprint() const { return (__builtin_wasm_memory_size(0) - initial_pages) * 0x10000; }
+};
+
+// Mimics the micro-chain: a set of up to max_live mostly node-sized objects with frequent
+// replacement, plus occasional large buffers (serialized blocks, query results).
+constexpr size_t max_live = 20'000;
+
+// Returns the total bytes allocated
+template <typename Heap>
+size_t run(const char* name, Heap& heap, uint32_t ops)
+{
+   struct allocation
+   {
+      void* p;
+      size_t size;
+   };
+   std::mt19937 rng(1234);
+   std::vector<allocation> live;
+   live.reserve(max_live);
+   size_t live_bytes = 0;
+   size_t peak_live = 0;
+   size_t total_allocated = 0;
+   auto size = [&] {
+      auto r = rng() % 1000;
+      if (r < 900)
+         return size_t(32 + rng() % 224);
+      if (r < 998)
+         return size_t(256 + rng() % 4096);
+      return size_t(16 * 1024 + rng() % (256 * 1024));
+   };
+
+   auto start = std::chrono::steady_clock::now();
+   for (uint32_t i = 0; i < ops; ++i)
+   {
+      auto r = rng() % 100;
+      if (live.empty() || (r < 50 && live.size() < max_live))
+      {
+         auto s = size();
+         auto p = heap.allocate(s);
+         if (!p)
+         {
+            printf("%-10s out of memory after %u ops\n", name, i);
+            return total_allocated;
+         }
+         live.push_back({p, s});
+         live_bytes += s;
+         total_allocated += s;
+      }
+      else if (r < 95)
+      {
+         auto k = rng() % live.size();
+         heap.deallocate(live[k].p);
+         live_bytes -= live[k].size;
+         live[k] = live.back();
+         live.pop_back();
+      }
+      else
+      {
+         auto& a = live[rng() % live.size()];
+         auto s = a.size + rng() % 1024;
+         auto p = heap.reallocate(a.p, s);
+         if (!p)
+         {
+            printf("%-10s out of memory after %u ops\n", name, i);
+            return total_allocated;
+         }
+         live_bytes += s - a.size;
+         total_allocated += s;
+         a = {p, s};
+      }
+      peak_live = std::max(peak_live, live_bytes);
+   }
+   auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                 std::chrono::steady_clock::now() - start)
+                 .count();
+   printf("%-10s %8.1f Mops/s  footprint %10zu  peak live %10zu  footprint/peak %6.2f\n",
+          name, ops / (us ? double(us) : 1.0), heap.footprint(), peak_live,
+          double(heap.footprint()) / peak_live);
+   for (auto& a : live)
+      heap.deallocate(a.p);
+   return total_allocated;
+}
+
+int main(int argc, char** argv)
+{
+   uint32_t ops = argc > 1 ? std::stoul(argv[1]) : 2'000'000;
+
+   libc_heap libc;
+   auto total_allocated = run("dlmalloc", libc, ops);
+   printf("%-10s %36s %10zu\n", "simple", "footprint (total allocated)", total_allocated);
+
+   size_t region_size = size_t(512) << 20;
+   auto base = static_cast<char*>(malloc(region_size));
+   if (!base)
+   {
+      printf("can't reserve region\n");
+      return 1;
+   }
+   eosio::freelist_heap<region> freelist{region{base, base + region_size}};
+   run("freelist", freelist, ops);
+   free(base);
+}
@@ -1,3 +1,4 @@
+#include <eosio/freelist_heap.hpp>
 #include <eosio/tester.hpp>
 
 #define CATCH_CONFIG_MAIN
@@ -5,6 +6,7 @@
 
 #include <bios/bios.hpp>
 #include "contracts/get-code.hpp"
+#include "contracts/item-cache.hpp"
 
 using namespace eosio;
 
@@ -59,3 +61,174 @@ TEST_CASE("get_code")
 
    // clsdk/bin/cleos push action getcode get '["eosio"]' -p getcode -j | jq .processed.action_traces[0].return_value_data
 }
+
+// Memory for freelist_heap which hands out a fixed buffer 64 KiB at a time
+struct test_heap_memory
+{
+   char* base;
+   char* limit;
+
+   char* begin() const { return base; }
+   char* end() const { return base; }
+   char* grow(char* end, size_t bytes) const
+   {
+      auto result = end + (bytes + 0xffff) / 0x10000 * 0x10000;
+      return result <= limit ? result : nullptr;
+   }
+};
+
+TEST_CASE("freelist_heap")
+{
+   std::vector<char> buffer(4 << 20);
+   eosio::freelist_heap<test_heap_memory> heap{
+       test_heap_memory{buffer.data(), buffer.data() + buffer.size()}};
+   auto fill = [](void* p, size_t size, char value) { memset(p, value, size); };
+   auto holds = [](void* p, size_t size, char value) {
+      for (size_t i = 0; i < size; ++i)
+         if (static_cast<char*>(p)[i] != value)
+            return false;
+      return true;
+   };
+
+   SECTION("blocks are aligned and don't overlap")
+   {
+      std::vector<std::pair<void*, size_t>> blocks;
+      for (size_t size : {1, 15, 16, 17, 100, 256, 257, 1000, 5000, 70000})
+      {
+         auto p = heap.allocate(size);
+         REQUIRE(p);
+         CHECK(uintptr_t(p) % 16 == 0);
+         fill(p, size, char(blocks.size()));
+         blocks.emplace_back(p, size);
+      }
+      for (size_t i = 0; i < blocks.size(); ++i)
+         CHECK(holds(blocks[i].first, blocks[i].second, char(i)));
+      for (auto [p, size] : blocks)
+         heap.deallocate(p);
+   }
+
+   SECTION("freed blocks are reused")
+   {
+      auto small = heap.allocate(40);
+      heap.deallocate(small);
+      CHECK(heap.allocate(40) == small);
+
+      // Neighbouring large blocks coalesce
+      auto a = heap.allocate(1000);
+      auto b = heap.allocate(1000);
+      auto guard = heap.allocate(1000);
+      heap.deallocate(a);
+      heap.deallocate(b);
+      CHECK(heap.allocate(1900) == a);
+
+      // Small free blocks are merged before the heap grows
+      auto footprint = heap.footprint();
+      std::vector<void*> smalls;
+      while (heap.footprint() == footprint)
+         smalls.push_back(heap.allocate(64));
+      heap.deallocate(smalls.back());
+      smalls.pop_back();
+      footprint = heap.footprint();
+      for (auto p : smalls)
+         heap.deallocate(p);
+      CHECK(heap.allocate(16 * 1024) != nullptr);
+      CHECK(heap.footprint() == footprint);
+      heap.deallocate(guard);
+   }
+
+   SECTION("churn doesn't grow the heap")
+   {
+      std::vector<void*> live;
+      auto cycle = [&] {
+         for (size_t i = 0; i < 200; ++i)
+            live.push_back(heap.allocate(32 + (i * 37) % 3000));
+         for (auto p : live)
+            heap.deallocate(p);
+         live.clear();
+      };
+      cycle();
+      auto footprint = heap.footprint();
+      for (int i = 0; i < 50; ++i)
+         cycle();
+      CHECK(heap.footprint() == footprint);
+   }
+
+   SECTION("reallocate keeps the contents")
+   {
+      auto p = heap.allocate(100);
+      fill(p, 100, 'x');
+      p = heap.reallocate(p, 50);
+      CHECK(holds(p, 50, 'x'));
+      for (size_t size : {300, 4000, 100000})
+      {
+         p = heap.reallocate(p, size);
+         REQUIRE(p);
+         CHECK(holds(p, 50, 'x'));
+      }
+      heap.deallocate(p);
+   }
+
+   SECTION("aligned allocation")
+   {
+      for (size_t align : {32, 64, 4096})
+      {
+         auto p = heap.allocate_aligned(100, align);
+         REQUIRE(p);
+         CHECK(uintptr_t(p) % align == 0);
+         fill(p, 100, 'a');
+         heap.deallocate(p);
+      }
+   }
+
+   SECTION("running out of memory")
+   {
+      CHECK(heap.allocate(buffer.size()) == nullptr);
+      auto p = heap.allocate(1 << 20);
+      CHECK(p != nullptr);
+      heap.deallocate(p);
+      CHECK(heap.allocate(1 << 20) == p);
+   }
+}
+
+TEST_CASE("multi_index item cache")
+{
+   test_chain chain;
+   for (auto [account, wasm] : {std::pair{"linear"_n, "test-contracts/item-cache.wasm"},
+                                std::pair{"hashed"_n, "test-contracts/item-cache-hashed.wasm"}})
+   {
+      chain.create_code_account(account);
+      chain.set_code(account, wasm);
+      for (uint32_t count : {1, 10, 300})
+         chain.as(account).with_code(account).act<item_cache::actions::verify>(count);
+   }
+}
+
+TEST_CASE("fork")
+{
+   test_chain chain;
+   chain.create_account("alice"_n);
+   auto fork = chain.fork();
+
+   // fork() finished the pending block, so both chains have alice and share a head
+   CHECK(fork.get_head_block_info().block_id == chain.get_head_block_info().block_id);
+   fork.create_account("alice"_n, "already taken");
+
+   chain.create_account("bob"_n);
+   fork.create_account("carol"_n);
+   chain.finish_block();
+   fork.finish_block();
+   CHECK(fork.get_head_block_info().block_num == chain.get_head_block_info().block_num);
+   CHECK(fork.get_head_block_info().block_id != chain.get_head_block_info().block_id);
+
+   // Each chain has only its own account
+   chain.create_account("bob"_n, "already taken");
+   fork.create_account("carol"_n, "already taken");
+   chain.create_account("carol"_n);
+   fork.create_account("bob"_n);
+
+   // Forking again after the head moved copies the new state
+   chain.finish_block();
+   auto second = chain.fork();
+   second.create_account("carol"_n, "already taken");
+   CHECK(second.get_head_block_info().block_id == chain.get_head_block_info().block_id);
+}
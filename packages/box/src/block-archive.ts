@@ -0,0 +1,133 @@
+import { BlockArchive } from "@edenos/eden-subchain-client/dist/BlockArchive";
+import * as fs from "fs";
+import * as path from "path";
+
+const indexMagic = 0x314c4243; // "CBL1"
+const indexHeaderSize = 8;
+
+// BlockArchive in two files, in the same format as clchain's block_log_file:
+//
+// blocks.log:    records of [uint32 size][serialized block]
+// blocks.index:  [uint32 magic][uint32 beginNum] followed by one uint64
+//                offset into blocks.log per block
+//
+// Records which were only partly written (e.g. the process was killed) are
+// discarded on open.
+export class FileBlockArchive implements BlockArchive {
+    logFd: number;
+    indexFd: number;
+    first = 1;
+    numBlocks = 0;
+    logSize = 0;
+
+    constructor(dir: string, truncate = false) {
+        fs.mkdirSync(dir, { recursive: true });
+        const open = (name: string) => {
+            const file = path.join(dir, name);
+            // not "a+": positioned writes must not be forced to the end
+            return fs.openSync(file, truncate || !fs.existsSync(file) ? "w+" : "r+");
+        };
+        this.logFd = open("blocks.log");
+        this.indexFd = open("blocks.index");
+        this.logSize = fs.fstatSync(this.logFd).size;
+
+        const indexSize = fs.fstatSync(this.indexFd).size;
+        if (indexSize < indexHeaderSize) {
+            fs.ftruncateSync(this.indexFd, 0);
+            this.writeHeader();
+            return;
+        }
+        const header = this.read(this.indexFd, 0, indexHeaderSize);
+        if (header.getUint32(0, true) !== indexMagic)
+            throw new Error("blocks.index has an unknown format");
+        this.first = header.getUint32(4, true);
+
+        const maxBlocks = Math.floor((indexSize - indexHeaderSize) / 8);
+        let validLogSize = 0;
+        while (this.numBlocks < maxBlocks) {
+            const offset = this.offset(this.numBlocks);
+            if (offset !== validLogSize || offset + 4 > this.logSize) break;
+            const size = this.read(this.logFd, offset, 4).getUint32(0, true);
+            if (offset + 4 + size > this.logSize) break;
+            validLogSize = offset + 4 + size;
+            ++this.numBlocks;
+        }
+        if (this.numBlocks !== maxBlocks)
+            fs.ftruncateSync(this.indexFd, indexHeaderSize + this.numBlocks * 8);
+        if (validLogSize !== this.logSize) {
+            this.logSize = validLogSize;
+            fs.ftruncateSync(this.logFd, validLogSize);
+        }
+    }
+
+    close() {
+        fs.closeSync(this.logFd);
+        fs.closeSync(this.indexFd);
+    }
+
+    beginNum() {
+        return this.first;
+    }
+
+    endNum() {
+        return this.first + this.numBlocks;
+    }
+
+    get(num: number) {
+        if (num < this.first || num >= this.endNum())
+            throw new Error(`block ${num} is not in blocks.log`);
+        const offset = this.offset(num - this.first);
+        const size = this.read(this.logFd, offset, 4).getUint32(0, true);
+        const block = new Uint8Array(size);
+        fs.readSync(this.logFd, block, 0, size, offset + 4);
+        return block;
+    }
+
+    append(num: number, block: Uint8Array) {
+        if (!this.numBlocks && num !== this.first) {
+            this.first = num;
+            this.writeHeader();
+        }
+        if (num !== this.endNum())
+            throw new Error(`blocks.log: block ${num} is not the next block`);
+
+        // The log record goes first; the index entry makes it visible
+        const record = new Uint8Array(4 + block.length);
+        new DataView(record.buffer).setUint32(0, block.length, true);
+        record.set(block, 4);
+        fs.writeSync(this.logFd, record, 0, record.length, this.logSize);
+        const entry = new DataView(new ArrayBuffer(8));
+        entry.setBigUint64(0, BigInt(this.logSize), true);
+        fs.writeSync(
+            this.indexFd,
+            new Uint8Array(entry.buffer),
+            0,
+            8,
+            indexHeaderSize + this.numBlocks * 8
+        );
+        this.logSize += record.length;
+        ++this.numBlocks;
+    }
+
+    writeHeader() {
+        const header = new DataView(new ArrayBuffer(indexHeaderSize));
+        header.setUint32(0, indexMagic, true);
+        header.setUint32(4, this.first, true);
+        fs.writeSync(this.indexFd, new Uint8Array(header.buffer), 0, 8, 0);
+    }
+
+    read(fd: number, pos: number, size: number) {
+        const buf = new Uint8Array(size);
+        fs.readSync(fd, buf, 0, size, pos);
+        return new DataView(buf.buffer);
+    }
+
+    offset(i: number) {
+        return Number(
+            this.read(this.indexFd, indexHeaderSize + i * 8, 8).getBigUint64(
+                0,
+                true
+            )
+        );
+    }
+}
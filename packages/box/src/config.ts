@@ -95,6 +95,11 @@ export const subchainConfig = {
     atomicMarket: process.env.SUBCHAIN_AA_MARKET_CONTRACT || "atomicmarket",
     wasmFile: process.env.SUBCHAIN_WASM || "../../build/eden-micro-chain.wasm",
     stateFile: process.env.SUBCHAIN_STATE || "state",
+    blocksDir: process.env.SUBCHAIN_BLOCKS_DIR || "blocks",
+    queryChunkSize: +(process.env.SUBCHAIN_QUERY_CHUNK_SIZE || 64 * 1024),
+    resultCacheSize: +(
+        process.env.SUBCHAIN_RESULT_CACHE_SIZE || 16 * 1024 * 1024
+    ),
     receiver:
         SubchainReceivers[
             (process.env.SUBCHAIN_RECEIVER ||
@@ -23,6 +23,56 @@ subchainHandler.get("/state", (req, res) => {
     res.sendFile(path.resolve("./state"));
 });
 
+// Binary responses for server-to-server consumers; see
+// EdenSubchain.queryBin. Scalar types are given by GET /bin-schema.
+subchainHandler.get("/bin-schema", (req, res) => {
+    res.type("text").send(storage.getBinSchema());
+});
+
+// Streams the response as the micro-chain produces it, so large results
+// don't need to be held in wasm memory. The response is compact JSON unless
+// the request has ?pretty=true, or binary if it has ?encoding=bin.
+subchainHandler.post("/graphql", (req, res) => {
+    const { query, variables } = req.body || {};
+    const pretty = req.query.pretty === "true";
+    if (typeof query !== "string") {
+        res.status(400).send({ errors: { message: "missing query" } });
+        return;
+    }
+    if (req.query.encoding === "bin") {
+        try {
+            res.type("application/octet-stream").send(
+                Buffer.from(storage.queryBin(query, variables))
+            );
+        } catch (e) {
+            logger.error(e);
+            res.status(500).send({ errors: { message: "internal error" } });
+        }
+        return;
+    }
+    try {
+        res.type("json");
+        const ok = storage.queryChunked(
+            query,
+            variables,
+            subchainConfig.queryChunkSize,
+            (chunk) => res.write(chunk),
+            pretty
+        );
+        if (!ok) {
+            // Part of the response is already sent
+            logger.error("graphql query failed after streaming started");
+            res.destroy();
+            return;
+        }
+        res.end();
+    } catch (e) {
+        logger.error(e);
+        if (res.headersSent) res.destroy();
+        else res.status(500).send({ errors: { message: "internal error" } });
+    }
+});
+
 subchainHandler.use((req, res, next) => {
     res.status(404).send("404");
 });
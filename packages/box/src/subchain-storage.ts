@@ -1,4 +1,5 @@
 import { EdenSubchain } from "@edenos/eden-subchain-client/dist/EdenSubchain";
+import { FileBlockArchive } from "./block-archive";
 import * as config from "./config";
 import * as fs from "fs";
 import logger from "./logger";
@@ -26,6 +27,13 @@ export class Storage {
                 atomicAccount,
                 atomicmarketAccount
             );
+            this.blocksWasm.setResultCacheSize(
+                config.subchainConfig.resultCacheSize
+            );
+            // History is replayed on startup, so the archive starts empty
+            this.blocksWasm.openBlockArchive(
+                new FileBlockArchive(config.subchainConfig.blocksDir, true)
+            );
 
             this.stateWasm = new EdenSubchain();
             await this.stateWasm.instantiate(
@@ -37,6 +45,8 @@ export class Storage {
                 atomicAccount,
                 atomicmarketAccount
             );
+            // Its memory is saved as the state file; keep responses out of it
+            this.stateWasm.setResultCacheSize(0);
         } catch (e) {
             this.blocksWasm = null;
             this.stateWasm = null;
@@ -76,6 +86,37 @@ export class Storage {
         });
     }
 
+    queryBin(
+        q: string,
+        variables: Record<string, unknown> | undefined
+    ): Uint8Array {
+        return this.protect(() => {
+            return this.blocksWasm!.queryBin(q, variables);
+        });
+    }
+
+    getBinSchema(): string {
+        return this.protect(() => this.blocksWasm!.getBinSchema());
+    }
+
+    queryChunked(
+        q: string,
+        variables: Record<string, unknown> | undefined,
+        chunkSize: number,
+        onChunk: (chunk: Uint8Array) => void,
+        pretty = false
+    ): boolean {
+        return this.protect(() => {
+            return this.blocksWasm!.queryChunked(
+                q,
+                variables,
+                chunkSize,
+                onChunk,
+                pretty
+            );
+        });
+    }
+
     getBlock(num: number): Uint8Array {
         return this.protect(() => this.blocksWasm!.getBlock(num))!;
     }
@@ -113,6 +154,7 @@ export class Storage {
                 jsonBlock,
                 irreversible
             );
+            this.blocksWasm!.trimBlocks();
             this.stateWasm!.pushJsonBlock(jsonBlock, irreversible);
             this.stateWasm!.trimBlocks();
             return result;
@@ -130,6 +172,7 @@ export class Storage {
     pushShipMessage(shipMessage: Uint8Array) {
         const result = this.protect(() => {
             const result = this.blocksWasm!.pushShipMessage(shipMessage);
+            this.blocksWasm!.trimBlocks();
             this.stateWasm!.pushShipMessage(shipMessage);
             this.stateWasm!.trimBlocks();
             return result;
@@ -0,0 +1,79 @@
+// Compares ingestion throughput of pushBlock (one block per call) against
+// pushBlocks (one batch per call).
+//
+// usage: node bench/add-blocks.js [wasm file] [num blocks] [batch size] [reversible blocks]
+
+const fs = require("fs");
+const { EdenSubchain } = require("../dist/EdenSubchain");
+
+const wasmFile = process.argv[2] || "../../build/eden-micro-chain.wasm";
+const numBlocks = +(process.argv[3] || 100000);
+const batchSize = +(process.argv[4] || 1000);
+const numReversible = +(process.argv[5] || 0);
+const irreversible = numBlocks - numReversible;
+
+const wasm = new Uint8Array(fs.readFileSync(wasmFile));
+
+async function create() {
+    const subchain = new EdenSubchain();
+    await subchain.instantiate(wasm);
+    subchain.initializeMemory(
+        "genesis.eden",
+        "eosio.token",
+        "atomicassets",
+        "atomicmarket"
+    );
+    return subchain;
+}
+
+function id(num) {
+    return num.toString(16).padStart(64, "0");
+}
+
+async function generate() {
+    const subchain = await create();
+    const blocks = [];
+    const start = Date.parse("2022-01-01T00:00:00.000Z");
+    for (let num = 1; num <= numBlocks; ++num) {
+        const result = subchain.pushJsonBlock(
+            JSON.stringify({
+                num,
+                id: id(num),
+                previous: id(num - 1),
+                timestamp: new Date(start + num * 500)
+                    .toISOString()
+                    .slice(0, -1),
+                transactions: [],
+            }),
+            irreversible
+        );
+        blocks.push(result.block);
+    }
+    return blocks;
+}
+
+function report(name, begin) {
+    const seconds = Number(process.hrtime.bigint() - begin) / 1e9;
+    console.log(
+        `${name}: ${numBlocks} blocks in ${seconds.toFixed(3)}s, ` +
+            `${Math.round(numBlocks / seconds)} blocks/s`
+    );
+}
+
+(async () => {
+    const blocks = await generate();
+
+    const single = await create();
+    let begin = process.hrtime.bigint();
+    for (const block of blocks) single.pushBlock(block, irreversible);
+    report("pushBlock", begin);
+
+    const batched = await create();
+    begin = process.hrtime.bigint();
+    for (let i = 0; i < blocks.length; i += batchSize)
+        batched.pushBlocks(blocks.slice(i, i + batchSize), irreversible);
+    report(`pushBlocks (batch size ${batchSize})`, begin);
+
+    if (single.getIrreversible() !== batched.getIrreversible())
+        throw new Error("results differ");
+})();
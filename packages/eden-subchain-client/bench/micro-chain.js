@@ -0,0 +1,135 @@
+// Feeds a synthetic Eden history through the micro-chain and reports ingestion
+// throughput, wasm memory, and query latency. Generate the history with:
+//
+//   cltester bench-history.wasm [--inductions n] [--elections n] [-o file]
+//
+// usage: node bench/micro-chain.js [wasm file] [history file] [query iterations]
+
+const fs = require("fs");
+const { EdenSubchain } = require("../dist/EdenSubchain");
+
+const wasmFile = process.argv[2] || "../../build/eden-micro-chain.wasm";
+const historyFile = process.argv[3] || "../../build/eden-bench-history.bin";
+const iterations = +(process.argv[4] || 200);
+
+const queries = {
+    status: `{
+        status { active community numElectionParticipants nextElection }
+    }`,
+    members: `{
+        members(first: 500) {
+            edges { node { account inviter participating createdAt
+                profile { name img bio social }
+                balance { amount } } }
+        }
+    }`,
+    membersByCreatedAt: `{
+        membersByCreatedAt(last: 100) {
+            edges { node { account createdAt inductionWitnesses { account } } }
+        }
+    }`,
+    // Dominated by point lookups of members, balances, and encryption keys by account
+    lookups: `{
+        balances(first: 500) {
+            edges { node { amount account { account participating
+                balance { amount } encryptionKey { encryptionKey } } } }
+        }
+    }`,
+    inductions: `{
+        inductions(first: 100) {
+            edges { node { id inviteeAccount createdAt
+                inviter { member { account } endorsed } } }
+        }
+    }`,
+    elections: `{
+        elections(last: 1) {
+            edges { node { time numRounds numParticipants
+                rounds { edges { node { round numGroups
+                    groups(first: 50) { edges { node {
+                        winner { account }
+                        votes { voter { account } candidate { account } }
+                    } } }
+                } } }
+            } }
+        }
+    }`,
+    distributions: `{
+        distributions { edges { node { time started targetAmount } } }
+    }`,
+    masterPool: `{
+        masterPool { amount history(last: 100) { edges { node { time delta } } } }
+    }`,
+    blockLog: `{
+        blockLog { head { num eosioBlock { num timestamp } } irreversible { num } }
+    }`,
+};
+
+function readHistory() {
+    const data = fs.readFileSync(historyFile);
+    const messages = [];
+    for (let pos = 0; pos < data.length; ) {
+        const size = data.readUInt32LE(pos);
+        messages.push(
+            new Uint8Array(data.buffer, data.byteOffset + pos + 4, size)
+        );
+        pos += 4 + size;
+    }
+    return messages;
+}
+
+function percentile(sorted, p) {
+    return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+(async () => {
+    const messages = readHistory();
+    const subchain = new EdenSubchain();
+    await subchain.instantiate(new Uint8Array(fs.readFileSync(wasmFile)));
+    subchain.initializeMemory(
+        "eden.gm",
+        "eosio.token",
+        "atomicassets",
+        "atomicmarket"
+    );
+
+    let numAppended = 0;
+    const begin = process.hrtime.bigint();
+    for (const message of messages)
+        if (subchain.pushShipMessage(message)) ++numAppended;
+    const seconds = Number(process.hrtime.bigint() - begin) / 1e9;
+    console.log(
+        `ingest: ${messages.length} eosio blocks (${numAppended} appended) ` +
+            `in ${seconds.toFixed(3)}s, ` +
+            `${Math.round(messages.length / seconds)} blocks/s`
+    );
+    console.log(
+        `wasm memory: ${(subchain.memory.buffer.byteLength / 2 ** 20).toFixed(
+            1
+        )} MiB`
+    );
+
+    // Measure query execution rather than the response cache
+    subchain.setResultCacheSize(0);
+    for (const [name, query] of Object.entries(queries)) {
+        const result = subchain.query(query);
+        if (result.errors)
+            throw new Error(`${name}: ${JSON.stringify(result.errors)}`);
+        const times = [];
+        for (let i = 0; i < iterations; ++i) {
+            const start = process.hrtime.bigint();
+            subchain.query(query);
+            times.push(Number(process.hrtime.bigint() - start) / 1e6);
+        }
+        times.sort((a, b) => a - b);
+        console.log(
+            `${name.padEnd(20)} p50 ${percentile(times, 0.5).toFixed(3)} ms` +
+                `  p99 ${percentile(times, 0.99).toFixed(3)} ms`
+        );
+    }
+    console.log(
+        `wasm memory after queries: ${(
+            subchain.memory.buffer.byteLength /
+            2 ** 20
+        ).toFixed(1)} MiB`
+    );
+})();
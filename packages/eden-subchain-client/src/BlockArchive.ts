@@ -0,0 +1,38 @@
+// Storage for the serialized blocks which the micro-chain trims out of its
+// memory; see EdenSubchain.openBlockArchive. Block numbers in an archive are
+// contiguous: [beginNum(), endNum()).
+export interface BlockArchive {
+    beginNum(): number;
+    endNum(): number;
+    get(num: number): Uint8Array;
+
+    // num must be endNum(), or any number if the archive is empty
+    append(num: number, block: Uint8Array): void;
+}
+
+// Keeps archived blocks in JS memory instead of wasm memory
+export class MemoryBlockArchive implements BlockArchive {
+    first = 0;
+    blocks: Uint8Array[] = [];
+
+    beginNum() {
+        return this.first;
+    }
+
+    endNum() {
+        return this.first + this.blocks.length;
+    }
+
+    get(num: number) {
+        if (num < this.first || num >= this.endNum())
+            throw new Error(`block ${num} is not in the archive`);
+        return this.blocks[num - this.first];
+    }
+
+    append(num: number, block: Uint8Array) {
+        if (!this.blocks.length) this.first = num;
+        else if (num !== this.endNum())
+            throw new Error(`block ${num} is not the next block`);
+        this.blocks.push(block);
+    }
+}
@@ -1,4 +1,20 @@
 import { Serialize } from "eosjs";
+import { BlockArchive } from "./BlockArchive";
+
+// Concatenates messages, each prefixed by its 32-bit little-endian size
+function encodeBatch(messages: Uint8Array[]) {
+    let size = 0;
+    for (const m of messages) size += 4 + m.length;
+    const batch = new Uint8Array(size);
+    const view = new DataView(batch.buffer);
+    let pos = 0;
+    for (const m of messages) {
+        view.setUint32(pos, m.length, true);
+        batch.set(m, pos + 4);
+        pos += 4 + m.length;
+    }
+    return batch;
+}
 
 export class EdenSubchain {
     module?: WebAssembly.Module;
@@ -9,6 +25,9 @@ export class EdenSubchain {
     initialized = false;
     corrupt = false;
     schema = "";
+    onQueryChunk?: (chunk: Uint8Array) => void;
+    blockArchive?: BlockArchive;
+    archivedBlock?: Uint8Array;
 
     uint8Array(pos?: number, len?: number) {
         if (this.corrupt) throw new Error("wasm state is corrupt");
@@ -44,6 +63,27 @@ export class EdenSubchain {
                 for (let i = 0; i < l.length - 1; ++i) console.log(l[i]);
                 this.consoleBuf = l[l.length - 1];
             },
+            query_chunk: (pos: number, len: number) => {
+                this.onQueryChunk!(this.uint8Array(pos, len).slice());
+            },
+            block_archive_begin_num: () => this.blockArchive?.beginNum() || 0,
+            block_archive_end_num: () => this.blockArchive?.endNum() || 0,
+            block_archive_get_size: (num: number) => {
+                // block_archive_get follows with the same num
+                this.archivedBlock = this.blockArchive!.get(num);
+                return this.archivedBlock.length;
+            },
+            block_archive_get: (num: number, dest: number) => {
+                const block = this.archivedBlock!;
+                this.archivedBlock = undefined;
+                this.uint8Array(dest, block.length).set(block);
+            },
+            block_archive_append: (num: number, pos: number, len: number) => {
+                this.blockArchive!.append(
+                    num,
+                    this.uint8Array(pos, len).slice()
+                );
+            },
         },
     };
 
@@ -186,6 +226,20 @@ export class EdenSubchain {
         });
     }
 
+    // Returns the number of blocks appended
+    pushBlocks(blocks: Uint8Array[], eosioIrreversible: number): number {
+        return this.protect(() => {
+            const batch = encodeBatch(blocks);
+            return this.withData(batch, (addr) => {
+                return this.exports.addBlocks(
+                    addr,
+                    batch.length,
+                    eosioIrreversible
+                );
+            });
+        });
+    }
+
     getShipBlocksRequest(blockNum: number) {
         return this.protect(() => {
             if (!this.exports.getShipBlocksRequest(blockNum)) return null;
@@ -201,6 +255,27 @@ export class EdenSubchain {
         });
     }
 
+    // Returns the number of blocks appended
+    pushShipMessages(messages: Uint8Array[]): number {
+        return this.protect(() => {
+            const batch = encodeBatch(messages);
+            return this.withData(batch, (addr) => {
+                return this.exports.pushShipMessages(addr, batch.length);
+            });
+        });
+    }
+
+    // trimBlocks() then moves irreversible blocks to archive instead of
+    // dropping them; getBlock and queries still read them. If no blocks have
+    // been pushed, resumes from the archive's last block, so the state must
+    // be restored to that block first (e.g. with loadSnapshot).
+    openBlockArchive(archive: BlockArchive) {
+        this.protect(() => {
+            this.blockArchive = archive;
+            this.exports.openBlockArchive();
+        });
+    }
+
     trimBlocks() {
         this.protect(() => {
             this.exports.trimBlocks();
@@ -226,6 +301,23 @@ export class EdenSubchain {
         });
     }
 
+    // Returns a snapshot of the irreversible state. If delta is true and a
+    // snapshot was previously saved, then it only contains changes since then.
+    saveSnapshot(delta: boolean) {
+        return this.protect(() => {
+            this.exports.saveSnapshot(delta);
+            return new Uint8Array(this.resultAsUint8Array());
+        });
+    }
+
+    loadSnapshot(snapshot: Uint8Array) {
+        this.protect(() => {
+            this.withData(snapshot, (addr) => {
+                this.exports.loadSnapshot(addr, snapshot.length);
+            });
+        });
+    }
+
     getSchema() {
         if (!this.schema.length)
             this.schema = this.decodeStr(
@@ -235,16 +327,102 @@ export class EdenSubchain {
         return this.schema;
     }
 
-    query(q: string) {
+    // Like getSchema, but each scalar field has an @bin directive giving its
+    // binary type in queryBin responses
+    getBinSchema() {
+        return this.decodeStr(
+            this.exports.getBinSchema(),
+            this.exports.getBinSchemaSize()
+        );
+    }
+
+    // Compact query responses are cached until the state changes, within a
+    // budget of maxBytes. 0 disables the cache.
+    setResultCacheSize(maxBytes: number) {
+        this.protect(() => {
+            this.exports.setResultCacheSize(maxBytes);
+        });
+    }
+
+    // Queries are parsed once and cached, so prefer passing values through
+    // variables over formatting them into the query text
+    query(q: string, variables?: Record<string, unknown>) {
         const utf8 = new TextEncoder().encode(q);
+        const vars = new TextEncoder().encode(JSON.stringify(variables ?? {}));
         return this.protect(() => {
             return this.withData(utf8, (addr) => {
-                this.exports.query(addr, utf8.length, 0, 0);
-                return JSON.parse(this.resultAsString());
+                return this.withData(vars, (varsAddr) => {
+                    this.exports.query(
+                        addr,
+                        utf8.length,
+                        varsAddr,
+                        vars.length,
+                        false
+                    );
+                    return JSON.parse(this.resultAsString());
+                });
             });
         });
     }
 
+    // Like query, but returns the response in binary: a 0 byte followed by
+    // the selected fields, or a 1 byte followed by the error message. Objects
+    // are their selected fields in order, nullable values are prefixed by a
+    // bool, lists by a varuint32 count, and scalars use the eosio binary
+    // format of the type given in getBinSchema().
+    queryBin(q: string, variables?: Record<string, unknown>) {
+        const utf8 = new TextEncoder().encode(q);
+        const vars = new TextEncoder().encode(JSON.stringify(variables ?? {}));
+        return this.protect(() => {
+            return this.withData(utf8, (addr) => {
+                return this.withData(vars, (varsAddr) => {
+                    this.exports.queryBin(
+                        addr,
+                        utf8.length,
+                        varsAddr,
+                        vars.length
+                    );
+                    return new Uint8Array(this.resultAsUint8Array());
+                });
+            });
+        });
+    }
+
+    // Like query, but passes the JSON response to onChunk in pieces of up to
+    // chunkSize bytes instead of parsing it. Returns false if the query failed
+    // after part of the response was passed; the response is then incomplete.
+    // The response is compact JSON unless pretty is set. Only small responses
+    // (up to 64 KiB) are added to the result cache.
+    queryChunked(
+        q: string,
+        variables: Record<string, unknown> | undefined,
+        chunkSize: number,
+        onChunk: (chunk: Uint8Array) => void,
+        pretty = false
+    ): boolean {
+        const utf8 = new TextEncoder().encode(q);
+        const vars = new TextEncoder().encode(JSON.stringify(variables ?? {}));
+        return this.protect(() => {
+            this.onQueryChunk = onChunk;
+            try {
+                return this.withData(utf8, (addr) =>
+                    this.withData(vars, (varsAddr) =>
+                        this.exports.queryChunked(
+                            addr,
+                            utf8.length,
+                            varsAddr,
+                            vars.length,
+                            chunkSize,
+                            pretty
+                        )
+                    )
+                );
+            } finally {
+                this.onQueryChunk = undefined;
+            }
+        });
+    }
+
     getIrreversible(): number {
         const q = this.query(`{
             blockLog{
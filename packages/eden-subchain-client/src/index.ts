@@ -1,3 +1,4 @@
+export * from "./BlockArchive";
 export * from "./EdenSubchain";
 export * from "./ReactSubchain";
 export * from "./SubchainClient";
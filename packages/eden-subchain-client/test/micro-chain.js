@@ -0,0 +1,332 @@
+// Replays histories which test-eden writes (dfuse-*.json) through the
+// micro-chain and checks the results. Run from the build directory after
+// test-eden:
+//
+// usage: node test/micro-chain.js [wasm file] [history dir]
+
+const assert = require("assert");
+const fs = require("fs");
+const path = require("path");
+const { EdenSubchain } = require("../dist/EdenSubchain");
+
+const wasmFile = process.argv[2] || "eden-micro-chain.wasm";
+const historyDir = process.argv[3] || ".";
+
+const stateQuery = `{
+    status { active community numElectionParticipants nextElection }
+    members(first: 10000) {
+        edges { node { account inviter participating createdAt
+            profile { name img bio social } balance { amount } } }
+    }
+    balances(first: 10000) { edges { node { amount account { account } } } }
+    inductions(first: 10000) { edges { node { id inviteeAccount createdAt } } }
+    elections(first: 100) { edges { node { time numRounds numParticipants } } }
+    distributions(first: 100) { edges { node { time started targetAmount } } }
+}`;
+
+// Groups a dfuse transaction history into JSON blocks, the same way as
+// box's dfuse receiver
+function readBlocks(name) {
+    const transactions = JSON.parse(
+        fs.readFileSync(path.join(historyDir, name), "utf8")
+    );
+    const blocks = [];
+    let block = null;
+    for (const trx of transactions) {
+        if (!trx.trace.matchingActions.length) continue;
+        if (!block || block.id !== trx.block.id) {
+            block = { ...trx.block, transactions: [] };
+            blocks.push({ block, irreversible: trx.irreversibleBlockNum });
+        }
+        block.transactions.push({
+            id: trx.trace.id,
+            actions: trx.trace.matchingActions.map((a) => ({
+                seq: a.seq,
+                firstReceiver: a.account,
+                receiver: a.receiver,
+                name: a.name,
+                creatorAction: a.creatorAction,
+                hexData: a.hexData,
+            })),
+        });
+    }
+    return blocks.map(({ block, irreversible }) => ({
+        json: JSON.stringify(block),
+        irreversible,
+    }));
+}
+
+async function create() {
+    const subchain = new EdenSubchain();
+    await subchain.instantiate(new Uint8Array(fs.readFileSync(wasmFile)));
+    subchain.initializeMemory(
+        "eden.gm",
+        "eosio.token",
+        "atomicassets",
+        "atomicmarket"
+    );
+    return subchain;
+}
+
+function push(subchain, blocks) {
+    for (const { json, irreversible } of blocks)
+        subchain.pushJsonBlock(json, irreversible);
+}
+
+function query(subchain, q) {
+    const result = subchain.query(q);
+    assert(!result.errors, JSON.stringify(result.errors));
+    return result.data;
+}
+
+function blockNums(subchain) {
+    const { head, irreversible } = query(
+        subchain,
+        "{blockLog{head{num} irreversible{num}}}"
+    ).blockLog;
+    return { head: head?.num || 0, irreversible: irreversible?.num || 0 };
+}
+
+// State after replaying blocks until the head reaches num
+async function stateAt(blocks, num) {
+    const subchain = await create();
+    for (const { json, irreversible } of blocks) {
+        if (blockNums(subchain).head >= num) break;
+        subchain.pushJsonBlock(json, irreversible);
+    }
+    assert.strictEqual(blockNums(subchain).head, num);
+    return query(subchain, stateQuery);
+}
+
+const tests = {
+    async "snapshot round trip"() {
+        const blocks = readBlocks("dfuse-test-election.json");
+        const half = Math.floor(blocks.length / 2);
+        const source = await create();
+        push(source, blocks.slice(0, half));
+        const full = source.saveSnapshot(false);
+        const fullNum = blockNums(source).irreversible;
+        push(source, blocks.slice(half));
+        const delta = source.saveSnapshot(true);
+        const deltaNum = blockNums(source).irreversible;
+        assert(fullNum < deltaNum);
+
+        const dest = await create();
+        dest.loadSnapshot(full);
+        assert.deepStrictEqual(blockNums(dest), {
+            head: fullNum,
+            irreversible: fullNum,
+        });
+        assert.deepStrictEqual(
+            query(dest, stateQuery),
+            await stateAt(blocks, fullNum)
+        );
+        dest.loadSnapshot(delta);
+        assert.deepStrictEqual(blockNums(dest), {
+            head: deltaNum,
+            irreversible: deltaNum,
+        });
+        assert.deepStrictEqual(
+            query(dest, stateQuery),
+            await stateAt(blocks, deltaNum)
+        );
+
+        // Going back to an older snapshot also moves irreversible back, so
+        // the following blocks link again
+        dest.loadSnapshot(full);
+        assert.deepStrictEqual(blockNums(dest), {
+            head: fullNum,
+            irreversible: fullNum,
+        });
+        push(dest, blocks);
+        assert.deepStrictEqual(blockNums(dest), blockNums(source));
+        assert.deepStrictEqual(
+            query(dest, stateQuery),
+            query(source, stateQuery)
+        );
+    },
+
+    async "pushBlocks matches pushing one at a time"() {
+        const blocks = readBlocks("dfuse-test-election.json");
+        const source = await create();
+        const bins = [];
+        for (const { json, irreversible } of blocks) {
+            const pushed = source.pushJsonBlock(json, irreversible);
+            if (pushed) bins.push(pushed.block);
+        }
+        const { irreversible } = blocks[blocks.length - 1];
+
+        const dest = await create();
+        const half = Math.floor(bins.length / 2);
+        const first = dest.pushBlocks(bins.slice(0, half), irreversible);
+        assert.strictEqual(first, half);
+        // Blocks which are already present don't count
+        const rest = dest.pushBlocks(bins, irreversible);
+        assert.strictEqual(rest, bins.length - half);
+        assert.strictEqual(blockNums(dest).head, blockNums(source).head);
+        assert.deepStrictEqual(
+            query(dest, stateQuery),
+            query(source, stateQuery)
+        );
+    },
+
+    async "queryBin matches query"() {
+        const subchain = await create();
+        push(subchain, readBlocks("dfuse-test-election.json"));
+        const { head } = blockNums(subchain);
+
+        // 0 (success), head is nullable (bool), then num (uint32)
+        const q =
+            "query ($num: Int!) { blockLog { head { num } " +
+            "blockByNum(num: $num) { num } } }";
+        const bin = subchain.queryBin(q, { num: head - 1 });
+        assert.strictEqual(bin.length, 11);
+        const view = new DataView(bin.buffer, bin.byteOffset, bin.length);
+        assert.deepStrictEqual(
+            [view.getUint8(0), view.getUint8(1), view.getUint32(2, true)],
+            [0, 1, head]
+        );
+        assert.deepStrictEqual(
+            [view.getUint8(6), view.getUint32(7, true)],
+            [1, head - 1]
+        );
+
+        // 1 (error), then the message
+        assert.strictEqual(subchain.queryBin("{nope}")[0], 1);
+        assert(subchain.getBinSchema().includes('@bin(type: "uint32")'));
+    },
+
+    async "changes cursor doesn't survive a fork"() {
+        const blocks = readBlocks("dfuse-test-election.json");
+        // Keep every block reversible so the change feed covers them
+        const reversible = blocks.map(({ json }) => ({
+            json,
+            irreversible: 0,
+        }));
+        const last = reversible[reversible.length - 1];
+        const subchain = await create();
+        const changes = (since) =>
+            query(
+                subchain,
+                `{changes(since: "${since}") ` +
+                    "{revision complete cursor tables { table }}}"
+            ).changes;
+
+        assert(!changes("").complete);
+        push(subchain, reversible.slice(0, -1));
+        const before = changes("");
+        assert.strictEqual(before.revision, blockNums(subchain).head);
+
+        push(subchain, [last]);
+        const next = changes(before.cursor);
+        assert(next.complete);
+        assert.strictEqual(next.revision, before.revision + 1);
+        assert(next.tables.length);
+
+        // Replace the last block with a fork at the same revision
+        const block = JSON.parse(last.json);
+        subchain.undoEosioNum(block.num);
+        assert.strictEqual(blockNums(subchain).head, before.revision);
+        const fork = {
+            ...block,
+            id: block.id.replace(/.$/, (c) => (c === "0" ? "1" : "0")),
+        };
+        push(subchain, [{ json: JSON.stringify(fork), irreversible: 0 }]);
+        const forked = changes(before.cursor);
+        assert.strictEqual(forked.revision, next.revision);
+        assert.notStrictEqual(forked.cursor, next.cursor);
+
+        // The old head's cursor names a state which no longer exists
+        const stale = changes(next.cursor);
+        assert(!stale.complete);
+        assert.deepStrictEqual(stale.tables, []);
+        assert(forked.complete);
+    },
+
+    async "rename after clearall"() {
+        const subchain = await create();
+        push(subchain, readBlocks("dfuse-test-clearall.json"));
+        const accounts = query(subchain, stateQuery).members.edges.map(
+            ({ node }) => node.account
+        );
+        assert.deepStrictEqual(accounts.sort(), ["ahab", "egeon", "pip"]);
+    },
+
+    async "inductions by invitee match a scan"() {
+        const subchain = await create();
+        const ids = (args) =>
+            query(
+                subchain,
+                `{inductions(${args}) {
+                    edges { node { id } }
+                    pageInfo { hasNextPage hasPreviousPage startCursor endCursor }
+                }}`
+            ).inductions;
+        let checked = 0;
+        for (const { json, irreversible } of readBlocks(
+            "dfuse-test-election.json"
+        )) {
+            subchain.pushJsonBlock(json, irreversible);
+            const all = query(
+                subchain,
+                "{inductions(first: 10000) { edges { node { id inviteeAccount } } }}"
+            ).inductions.edges.map(({ node }) => node);
+            const invitees = [...new Set(all.map((i) => i.inviteeAccount))];
+            for (const invitee of [...invitees, "nobody"]) {
+                const expected = all
+                    .filter((i) => i.inviteeAccount === invitee)
+                    .map((i) => i.id);
+                const found = ids(`invitee: "${invitee}", first: 10000`);
+                assert.deepStrictEqual(
+                    found.edges.map(({ node }) => node.id),
+                    expected,
+                    invitee
+                );
+                assert(!found.pageInfo.hasNextPage);
+                assert(!found.pageInfo.hasPreviousPage);
+
+                // Paging one at a time in each direction stays within the
+                // invitee's range
+                const forward = [];
+                let after = "";
+                for (;;) {
+                    const page = ids(
+                        `invitee: "${invitee}", first: 1, after: "${after}"`
+                    );
+                    forward.push(...page.edges.map(({ node }) => node.id));
+                    if (!page.pageInfo.hasNextPage) break;
+                    after = page.pageInfo.endCursor;
+                }
+                assert.deepStrictEqual(forward, expected, invitee);
+                const backward = [];
+                let before = "";
+                for (;;) {
+                    const page = ids(
+                        `invitee: "${invitee}", last: 1, before: "${before}"`
+                    );
+                    backward.unshift(...page.edges.map(({ node }) => node.id));
+                    if (!page.pageInfo.hasPreviousPage) break;
+                    before = page.pageInfo.startCursor;
+                }
+                assert.deepStrictEqual(backward, expected, invitee);
+                checked += expected.length;
+            }
+        }
+        assert(checked > 0);
+    },
+};
+
+(async () => {
+    let failed = 0;
+    for (const [name, test] of Object.entries(tests)) {
+        try {
+            await test();
+            console.log(`passed ${name}`);
+        } catch (e) {
+            ++failed;
+            console.log(`FAILED ${name}`);
+            console.log(e);
+        }
+    }
+    process.exit(failed ? 1 : 0);
+})();
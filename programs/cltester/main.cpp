@@ -21,9 +21,15 @@
 #include <eosio/ship_protocol.hpp>
 #include <eosio/to_bin.hpp>
 
+#include <ctype.h>
 #include <stdio.h>
 #include <chrono>
 #include <optional>
+#include <sstream>
+#include <thread>
+
+#include <sys/wait.h>
+#include <unistd.h>
 
 using namespace std::literals;
 
@@ -259,7 +265,39 @@ struct test_chain
    std::unique_ptr<intrinsic_context> intr_ctx;
    std::set<test_chain_ref*> refs;
 
+   // The state as of fork_snapshot_id, kept so repeated forks of a fixture only write one
+   // snapshot
+   eosio::chain::block_id_type fork_snapshot_id;
+   std::shared_ptr<const std::string> fork_snapshot;
+
    test_chain(::state& state, const char* snapshot, uint64_t state_size) : state{state}
+   {
+      if (snapshot && *snapshot)
+      {
+         std::ifstream snapshot_file(snapshot, std::ios::in | std::ios::binary);
+         if (!snapshot_file.is_open())
+            throw std::runtime_error("can not open " + std::string{snapshot});
+         init(&snapshot_file, state_size);
+      }
+      else
+      {
+         init(nullptr, state_size);
+      }
+   }
+
+   // Starts a new chain from src's fork snapshot
+   test_chain(test_chain& src) : producer_key{src.producer_key}, state{src.state}
+   {
+      auto snapshot = src.get_fork_snapshot();
+      std::istringstream snapshot_stream(*snapshot);
+      init(&snapshot_stream, src.cfg->state_size);
+      prev_block = src.prev_block;
+      history = src.history;
+      fork_snapshot_id = src.fork_snapshot_id;
+      fork_snapshot = std::move(snapshot);
+   }
+
+   void init(std::istream* snapshot, uint64_t state_size)
    {
       eosio::chain::genesis_state genesis;
       genesis.initial_timestamp = fc::time_point::from_iso_string("2020-01-01T00:00:00.000");
@@ -270,21 +308,18 @@ struct test_chain
       cfg->wasm_runtime = eosio::chain::wasm_interface::vm_type::eos_vm_jit;
       cfg->state_size = state_size;
 
-      std::optional<std::ifstream> snapshot_file;
       std::shared_ptr<eosio::chain::istream_snapshot_reader> snapshot_reader;
-      if (snapshot && *snapshot)
+      if (snapshot)
       {
          std::optional<eosio::chain::chain_id_type> chain_id;
          {
-            std::ifstream temp_file(snapshot, (std::ios::in | std::ios::binary));
-            if (!temp_file.is_open())
-               throw std::runtime_error("can not open " + std::string{snapshot});
-            eosio::chain::istream_snapshot_reader tmp_reader(temp_file);
+            eosio::chain::istream_snapshot_reader tmp_reader(*snapshot);
             tmp_reader.validate();
             chain_id = eosio::chain::controller::extract_chain_id(tmp_reader);
          }
-         snapshot_file.emplace(snapshot, std::ios::in | std::ios::binary);
-         snapshot_reader = std::make_shared<eosio::chain::istream_snapshot_reader>(*snapshot_file);
+         snapshot->clear();
+         snapshot->seekg(0);
+         snapshot_reader = std::make_shared<eosio::chain::istream_snapshot_reader>(*snapshot);
          control = std::make_unique<eosio::chain::controller>(*cfg, make_protocol_feature_set(),
                                                               *chain_id);
       }
@@ -395,6 +430,24 @@ struct test_chain
           [&](eosio::chain::digest_type d) { return std::vector{producer_key.sign(d)}; });
       control->commit_block();
    }
+
+   // A snapshot can't include a pending block, so this finishes it first. This changes the
+   // source chain; test_chain::fork documents it.
+   std::shared_ptr<const std::string> get_fork_snapshot()
+   {
+      if (control->is_building_block())
+         finish_block();
+      if (!fork_snapshot || fork_snapshot_id != control->head_block_id())
+      {
+         std::ostringstream stream;
+         auto writer = std::make_shared<eosio::chain::ostream_snapshot_writer>(stream);
+         control->write_snapshot(writer);
+         writer->finalize();
+         fork_snapshot = std::make_shared<const std::string>(stream.str());
+         fork_snapshot_id = control->head_block_id();
+      }
+      return fork_snapshot;
+   }
 };  // test_chain
 
 test_chain_ref::test_chain_ref(test_chain& chain)
@@ -1072,6 +1125,13 @@ struct callbacks
       return state.chains.size() - 1;
    }
 
+   uint32_t tester_fork_chain(uint32_t chain)
+   {
+      auto& src = assert_chain(chain);
+      state.chains.push_back(std::make_unique<test_chain>(src));
+      return state.chains.size() - 1;
+   }
+
    void tester_destroy_chain(uint32_t chain)
    {
       assert_chain(chain, false);
@@ -1102,6 +1162,7 @@ struct callbacks
    {
       auto& chain = assert_chain(chain_index);
       auto k = unpack<eosio::chain::public_key_type>(key);
+      chain.fork_snapshot.reset();
       chain.control->replace_producer_keys(k);
    }
 
@@ -1112,6 +1173,7 @@ struct callbacks
    {
       auto& chain = assert_chain(chain_index);
       auto k = unpack<eosio::chain::public_key_type>(key);
+      chain.fork_snapshot.reset();
       chain.control->replace_account_keys(eosio::chain::name{account},
                                           eosio::chain::name{permission}, k);
    }
@@ -1353,6 +1415,7 @@ void register_callbacks()
    rhf_t::add<&callbacks::tester_execute>("env", "tester_execute");
    rhf_t::add<&callbacks::tester_create_chain>("env", "tester_create_chain");
    rhf_t::add<&callbacks::tester_create_chain2>("env", "tester_create_chain2");
+   rhf_t::add<&callbacks::tester_fork_chain>("env", "tester_fork_chain");
    rhf_t::add<&callbacks::tester_destroy_chain>("env", "tester_destroy_chain");
    rhf_t::add<&callbacks::tester_shutdown_chain>("env", "tester_shutdown_chain");
    rhf_t::add<&callbacks::tester_get_chain_path>("env", "tester_get_chain_path");
@@ -1440,6 +1503,241 @@ static void run(const char* wasm,
    backend(cb, "env", "_start");
 }
 
+static int run_and_report(const char* wasm,
+                          const std::vector<std::string>& args,
+                          const std::map<std::string, std::string>& substitutions)
+{
+   try
+   {
+      register_callbacks();
+      run(wasm, args, substitutions);
+      return 0;
+   }
+   catch (::assert_exception& e)
+   {
+      std::cerr << "tester wasm asserted: " << e.what() << "\n";
+   }
+   catch (eosio::vm::exception& e)
+   {
+      std::cerr << "vm::exception: " << e.detail() << "\n";
+   }
+   catch (fc::exception& e)
+   {
+      std::cerr << "fc::exception: " << e.to_string() << "\n";
+   }
+   catch (std::exception& e)
+   {
+      std::cerr << "std::exception: " << e.what() << "\n";
+   }
+   return 1;
+}
+
+// Runs wasm in a child process which writes its stdout to out and its stderr to err. The parent
+// never loads the wasm, so it's safe to fork.
+static pid_t spawn_run(const char* wasm,
+                       const std::vector<std::string>& args,
+                       const std::map<std::string, std::string>& substitutions,
+                       FILE* out,
+                       FILE* err)
+{
+   fflush(nullptr);
+   pid_t pid = fork();
+   if (pid < 0)
+      throw std::runtime_error("fork failed: "s + strerror(errno));
+   if (pid)
+      return pid;
+   dup2(fileno(out), STDOUT_FILENO);
+   dup2(fileno(err), STDERR_FILENO);
+   setvbuf(stdout, nullptr, _IOLBF, 0);
+   int result = run_and_report(wasm, args, substitutions);
+   fflush(nullptr);
+   _exit(result);
+}
+
+static std::string read_tmpfile(FILE* f)
+{
+   std::string result;
+   rewind(f);
+   char buf[4096];
+   while (auto n = fread(buf, 1, sizeof(buf), f))
+      result.append(buf, n);
+   return result;
+}
+
+static std::string describe_status(int status)
+{
+   if (WIFSIGNALED(status))
+      return "killed by signal " + std::to_string(WTERMSIG(status));
+   return "exited with " + std::to_string(WEXITSTATUS(status));
+}
+
+// Lists the Catch test cases which args select. Catch exits with the number of tests it listed,
+// so the exit status isn't an error.
+static std::vector<std::string> list_tests(const char* wasm,
+                                           std::vector<std::string> args,
+                                           const std::map<std::string, std::string>& substitutions)
+{
+   args.push_back("--list-test-names-only");
+   std::unique_ptr<FILE, decltype(&fclose)> out{tmpfile(), &fclose};
+   std::unique_ptr<FILE, decltype(&fclose)> err{tmpfile(), &fclose};
+   if (!out || !err)
+      throw std::runtime_error("can not create temporary file");
+   int status;
+   waitpid(spawn_run(wasm, args, substitutions, out.get(), err.get()), &status, 0);
+
+   std::vector<std::string> names;
+   std::istringstream lines{read_tmpfile(out.get())};
+   for (std::string line; std::getline(lines, line);)
+   {
+      if (!line.empty() && line.back() == '\r')
+         line.pop_back();
+      // Catch quotes names which start with #
+      if (line.size() >= 2 && line.front() == '"' && line.back() == '"')
+         line = line.substr(1, line.size() - 2);
+      if (!line.empty())
+         names.push_back(std::move(line));
+   }
+   if (names.empty())
+   {
+      std::cerr << read_tmpfile(err.get());
+      if (WIFSIGNALED(status))
+         throw std::runtime_error("listing tests " + describe_status(status));
+   }
+   return names;
+}
+
+// A Catch test spec which matches only name
+static std::string test_spec(const std::string& name)
+{
+   std::string result = "\"";
+   for (auto ch : name)
+   {
+      if (ch && strchr("\\,[]*\"~", ch))
+         result.push_back('\\');
+      result.push_back(ch);
+   }
+   return result + "\"";
+}
+
+// Runs each test case in its own process, up to jobs at a time. Each test's output and result
+// are reported in listing order as soon as it and the tests before it finish, so the report
+// doesn't depend on scheduling. Returns the number of failed tests, clamped like Catch's.
+static int run_jobs(uint32_t jobs,
+                    const char* wasm,
+                    const std::vector<std::string>& args,
+                    const std::map<std::string, std::string>& substitutions,
+                    bool verbose)
+{
+   try
+   {
+      struct test
+      {
+         std::string name;
+         std::unique_ptr<FILE, decltype(&fclose)> output{nullptr, &fclose};
+         std::chrono::steady_clock::time_point start = {};
+         std::chrono::duration<double> elapsed = {};
+         std::optional<int> status = {};
+      };
+
+      std::vector<test> tests;
+      for (auto& name : list_tests(wasm, args, substitutions))
+         tests.push_back({std::move(name)});
+      if (tests.empty())
+      {
+         std::cerr << "no test cases matched\n";
+         return 1;
+      }
+      if (!jobs)
+         jobs = std::max(std::thread::hardware_concurrency(), 1u);
+      std::cerr << "running " << tests.size() << " test cases with " << jobs << " jobs\n";
+
+      auto start = std::chrono::steady_clock::now();
+      std::map<pid_t, size_t> running;
+      size_t next_test = 0;
+      size_t next_report = 0;
+      uint32_t failed = 0;
+      while (next_report < tests.size())
+      {
+         while (running.size() < jobs && next_test < tests.size())
+         {
+            auto& t = tests[next_test];
+            t.output.reset(tmpfile());
+            if (!t.output)
+               throw std::runtime_error("can not create temporary file");
+            auto test_args = args;
+            test_args.push_back(test_spec(t.name));
+            t.start = std::chrono::steady_clock::now();
+            running[spawn_run(wasm, test_args, substitutions, t.output.get(), t.output.get())] =
+                next_test++;
+         }
+
+         int status;
+         pid_t pid = waitpid(-1, &status, 0);
+         if (pid < 0)
+            throw std::runtime_error("waitpid failed: "s + strerror(errno));
+         auto it = running.find(pid);
+         if (it == running.end())
+            continue;
+         auto& t = tests[it->second];
+         t.elapsed = std::chrono::steady_clock::now() - t.start;
+         t.status = status;
+         running.erase(it);
+
+         for (; next_report < tests.size() && tests[next_report].status; ++next_report)
+         {
+            auto& r = tests[next_report];
+            bool ok = WIFEXITED(*r.status) && !WEXITSTATUS(*r.status);
+            if (!ok || verbose)
+               std::cout << read_tmpfile(r.output.get());
+            r.output.reset();
+            if (!ok)
+               ++failed;
+            printf("%s %9.3f s  %s%s\n", ok ? "passed" : "FAILED", r.elapsed.count(),
+                   r.name.c_str(), ok ? "" : ("  (" + describe_status(*r.status) + ")").c_str());
+            fflush(stdout);
+         }
+      }
+
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      printf("%u of %zu test cases failed, %.3f s\n", failed, tests.size(), elapsed.count());
+      return std::min(failed, 255u);
+   }
+   catch (std::exception& e)
+   {
+      std::cerr << "std::exception: " << e.what() << "\n";
+      return 1;
+   }
+}
+
+// Catch's options which take their value from the next arg
+static bool catch_option_has_value(const std::string& arg)
+{
+   static const char* const options[] = {
+       "-x", "--abortx", "-w", "--warn", "-d", "--durations", "-D", "--min-duration", "-f",
+       "--input-file", "-o", "--out", "-r", "--reporter", "-n", "--name", "-c", "--section",
+       "-v", "--verbosity", "--order", "--rng-seed", "--use-colour", "--wait-for-keypress",
+       "--benchmark-samples", "--benchmark-resamples", "--benchmark-confidence-interval",
+       "--benchmark-warmup-time"};
+   return std::find(std::begin(options), std::end(options), arg) != std::end(options);
+}
+
+// Returns a test filter in args (the wasm's args) which has a comma. Catch treats a comma as
+// "or", so such a filter would escape the test name run_jobs adds to select each test case.
+static std::optional<std::string> find_filter_with_comma(const std::vector<std::string>& args)
+{
+   for (size_t i = 1; i < args.size(); ++i)
+   {
+      if (args[i][0] == '-')
+      {
+         if (catch_option_has_value(args[i]))
+            ++i;
+      }
+      else if (args[i].find(',') != std::string::npos)
+         return args[i];
+   }
+   return std::nullopt;
+}
+
 const char usage[] = "USAGE: cltester [OPTIONS] file.wasm [args for wasm]...\n";
 const char help[] = R"(
 OPTIONS:
@@ -1458,6 +1756,15 @@ OPTIONS:
             place and enable debugging support. This bypasses size limits and
             other constraints on debug.wasm. eosiolib still enforces
             constraints on contract.wasm. (repeatable)
+
+      -j N
+      --jobs N
+
+            Run each Catch test case in file.wasm in its own process, N at a
+            time (0: one per cpu). args for wasm go to every process; test
+            filters in them select which test cases run, but must not use
+            commas. Reports each test case's result and wall time in listing
+            order.
 )";
 
 int main(int argc, char* argv[])
@@ -1466,6 +1773,8 @@ int main(int argc, char* argv[])
 
    bool show_usage = false;
    bool error = false;
+   bool verbose = false;
+   std::optional<uint32_t> jobs;
    std::map<std::string, std::string> substitutions;
    int next_arg = 1;
    while (next_arg < argc && argv[next_arg][0] == '-')
@@ -1473,7 +1782,32 @@ int main(int argc, char* argv[])
       if (!strcmp(argv[next_arg], "-h") || !strcmp(argv[next_arg], "--help"))
          show_usage = true;
       else if (!strcmp(argv[next_arg], "-v") || !strcmp(argv[next_arg], "--verbose"))
+      {
          fc::logger::get(DEFAULT_LOGGER).set_log_level(fc::log_level::debug);
+         verbose = true;
+      }
+      else if (!strcmp(argv[next_arg], "-j") || !strcmp(argv[next_arg], "--jobs"))
+      {
+         if (++next_arg >= argc)
+         {
+            std::cerr << argv[next_arg - 1] << " needs 1 arg\n";
+            error = true;
+         }
+         else
+         {
+            const char* arg = argv[next_arg];
+            char* end;
+            errno = 0;
+            auto n = strtoul(arg, &end, 10);
+            if (!isdigit((unsigned char)*arg) || *end || errno || n > UINT32_MAX)
+            {
+               std::cerr << argv[next_arg - 1] << " needs a number, not \"" << arg << "\"\n";
+               error = true;
+            }
+            else
+               jobs = n;
+         }
+      }
       else if (!strcmp(argv[next_arg], "-s") || !strcmp(argv[next_arg], "--subst"))
       {
          next_arg += 2;
@@ -1503,28 +1837,15 @@ int main(int argc, char* argv[])
          std::cerr << help;
       return error;
    }
-   try
-   {
-      std::vector<std::string> args{argv + next_arg, argv + argc};
-      register_callbacks();
-      run(argv[next_arg], args, substitutions);
-      return 0;
-   }
-   catch (::assert_exception& e)
-   {
-      std::cerr << "tester wasm asserted: " << e.what() << "\n";
-   }
-   catch (eosio::vm::exception& e)
-   {
-      std::cerr << "vm::exception: " << e.detail() << "\n";
-   }
-   catch (fc::exception& e)
+   std::vector<std::string> args{argv + next_arg, argv + argc};
+   if (jobs)
    {
-      std::cerr << "fc::exception: " << e.to_string() << "\n";
-   }
-   catch (std::exception& e)
-   {
-      std::cerr << "std::exception: " << e.what() << "\n";
+      if (auto filter = find_filter_with_comma(args))
+      {
+         std::cerr << "test filters can't use commas with --jobs: " << *filter << "\n";
+         return 1;
+      }
+      return run_jobs(*jobs, argv[next_arg], args, substitutions, verbose);
    }
-   return 1;
+   return run_and_report(argv[next_arg], args, substitutions);
 }